@@ -0,0 +1,272 @@
+#ifndef CARD_MASK_H
+#define CARD_MASK_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+
+#include "cards.h"
+#include "cards.pb.h"
+#include "poker.pb.h"
+
+namespace poker {
+
+// Compact card representations for hot loops.
+//
+// A card index is a dense number in [0, kCardCount): (suit - 1) * 13 +
+// (rank - 2).  A card mask is a 64-bit set of cards with one 16-bit lane per
+// suit, where the bit for a card is its Rank enum value within its suit's lane
+// (bits 2..14).  A suit's lane is therefore directly a 13-bit rank mask.
+
+constexpr int kCardCount = 52;
+constexpr int kRankCount = 13;
+constexpr int kSuitCount = 4;
+
+inline int CardToIndex(const Card& card) {
+  return (static_cast<int>(card.suit()) - 1) * kRankCount +
+         (static_cast<int>(card.rank()) - 2);
+}
+
+inline Card IndexToCard(int index) {
+  Card card;
+  card.set_suit(static_cast<Suit>(index / kRankCount + 1));
+  card.set_rank(static_cast<Rank>(index % kRankCount + 2));
+  return card;
+}
+
+inline uint64_t IndexToCardMask(int index) {
+  return uint64_t{1} << ((index / kRankCount) * 16 + index % kRankCount + 2);
+}
+
+inline uint64_t CardToMask(const Card& card) {
+  return uint64_t{1} << ((static_cast<int>(card.suit()) - 1) * 16 +
+                         static_cast<int>(card.rank()));
+}
+
+// Returns the card of bit number bit (e.g. from __builtin_ctzll()) of a card
+// mask.
+inline Card CardMaskBitToCard(int bit) {
+  Card card;
+  card.set_suit(static_cast<Suit>(bit / 16 + 1));
+  card.set_rank(static_cast<Rank>(bit % 16));
+  return card;
+}
+
+// Returns the 16-bit rank mask of suit (0-based) in mask.
+inline uint32_t SuitRanks(uint64_t mask, int suit) {
+  return static_cast<uint32_t>(mask >> (suit * 16)) & 0xFFFF;
+}
+
+// Every card of the deck as a card mask.
+constexpr uint64_t kFullDeckMask = 0x7FFC7FFC7FFC7FFCull;
+
+// Relabels the suits of hole and board so that any two (hole, board) pairs
+// that differ only by a permutation of suits come out identical.  Suits are
+// ordered by their board ranks and then their hole ranks, highest first;
+// anything that depends only on the cards up to suit symmetry (hand
+// strength, equity) can use the result as a cache key.
+inline void CanonicalizeSuits(uint64_t* hole, uint64_t* board) {
+  std::array<uint32_t, kSuitCount> lanes;
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    lanes[suit] = (SuitRanks(*board, suit) << 16) | SuitRanks(*hole, suit);
+  }
+  std::sort(lanes.begin(), lanes.end(), std::greater<uint32_t>());
+  *hole = 0;
+  *board = 0;
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    *hole |= static_cast<uint64_t>(lanes[suit] & 0xFFFF) << (suit * 16);
+    *board |= static_cast<uint64_t>(lanes[suit] >> 16) << (suit * 16);
+  }
+}
+
+// Hand ranking policies for EvaluateCardMask(), fixed at compile time.
+// kLowRank is the lowest rank in the deck, which the ace plays just below in
+// the lowest straight (the wheel).  kCategory[type] is the value a HandType
+// takes in the category bits of a sort code, so sort codes order hands by
+// the game's ranking of categories.  kHandValueCount is the number of
+// distinct sort codes (see HandValueIndex()).
+struct StandardRanking {
+  static constexpr int kLowRank = static_cast<int>(Rank::TWO);
+  static constexpr int kHandValueCount = 7462;
+  static constexpr std::array<int, HandType::MAX> kCategory = {
+      0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+};
+
+// Short-deck (6+) hold'em: 36 cards, the wheel is A-6-7-8-9 and, being the
+// rarer hand with only nine cards of a suit, a flush beats a full house.
+struct ShortDeckRanking {
+  static constexpr int kLowRank = static_cast<int>(Rank::SIX);
+  static constexpr int kHandValueCount = 1404;
+  static constexpr std::array<int, HandType::MAX> kCategory = {
+      0, 1, 2, 3, 4, 5, 7, 6, 8, 9};
+};
+
+// Returns the HandType of a sort code from EvaluateCardMask<RANKING>().
+template <typename RANKING>
+constexpr HandType SortCodeHandType(int32_t sort_code) {
+  int category = (sort_code >> 20) & 0xF;
+  for (int type = 0; type < HandType::MAX; type++) {
+    if (RANKING::kCategory[type] == category) {
+      return static_cast<HandType>(type);
+    }
+  }
+  return HandType::HANDTYPE_UNSPECIFIED;
+}
+
+// Returns sort_code, from EvaluateCardMask<RANKING>(), with its category
+// bits holding its HandType as in a standard sort code (e.g. for
+// SortCodeToHand()).
+template <typename RANKING>
+constexpr int32_t StandardSortCode(int32_t sort_code) {
+  return (sort_code & 0xFFFFF) |
+         (static_cast<int32_t>(SortCodeHandType<RANKING>(sort_code)) << 20);
+}
+
+namespace card_mask_internal {
+
+inline int HighBit(uint32_t bits) {
+  assert(bits != 0);
+  return 31 - __builtin_clz(bits);
+}
+
+// Returns the high rank of the best straight in a rank mask, or 0.
+template <typename RANKING = StandardRanking>
+inline int StraightHigh(uint32_t ranks) {
+  // The ace also plays low, in the (otherwise unused) bit below the lowest
+  // rank
+  ranks |= ((ranks >> static_cast<int>(Rank::ACE)) & 1)
+           << (RANKING::kLowRank - 1);
+  uint32_t runs = ranks & (ranks << 1) & (ranks << 2) & (ranks << 3) &
+                  (ranks << 4);
+  return runs == 0 ? 0 : HighBit(runs);
+}
+
+template <typename RANKING = StandardRanking>
+inline int32_t SortCode(HandType type, int r0, int r1, int r2, int r3,
+                        int r4) {
+  return (static_cast<int32_t>(RANKING::kCategory[type]) << 20) | (r0 << 16) |
+         (r1 << 12) | (r2 << 8) | (r3 << 4) | r4;
+}
+
+template <typename RANKING = StandardRanking>
+inline int32_t StraightSortCode(HandType type, int high) {
+  return SortCode<RANKING>(type, high, high - 1, high - 2, high - 3,
+                           high == RANKING::kLowRank + 3
+                               ? static_cast<int>(Rank::ACE) : high - 4);
+}
+
+// Appends the top count ranks of mask to sort_code, from the given shift down.
+inline int32_t Kickers(int32_t sort_code, uint32_t ranks, int count,
+                       int shift) {
+  for (int i = 0; i < count; i++, shift -= 4) {
+    int rank = HighBit(ranks);
+    sort_code |= rank << shift;
+    ranks &= ~(1u << rank);
+  }
+  return sort_code;
+}
+
+// Evaluates the flush made by the rank mask of its suit (five to seven
+// ranks).
+template <typename RANKING = StandardRanking>
+inline int32_t EvaluateFlush(uint32_t flush) {
+  int high = StraightHigh<RANKING>(flush);
+  if (high != 0) {
+    return StraightSortCode<RANKING>(HandType::STRAIGHT_FLUSH, high);
+  }
+  return Kickers(SortCode<RANKING>(HandType::FLUSH, 0, 0, 0, 0, 0), flush, 5,
+                 16);
+}
+
+// Evaluates five to seven cards, given as their suits' rank masks, that
+// hold no flush.
+template <typename RANKING = StandardRanking>
+inline int32_t EvaluateNoFlush(uint32_t s0, uint32_t s1, uint32_t s2,
+                               uint32_t s3) {
+  uint32_t ranks = s0 | s1 | s2 | s3;
+
+  // Rank multiplicities as bit sets
+  uint32_t odd = s0 ^ s1 ^ s2 ^ s3;
+  uint32_t quads = s0 & s1 & s2 & s3;
+  uint32_t two_or_more =
+      (s0 & s1) | (s0 & s2) | (s0 & s3) | (s1 & s2) | (s1 & s3) | (s2 & s3);
+  uint32_t trips = two_or_more & odd;
+  uint32_t pairs = two_or_more & ~odd & ~quads;
+
+  if (quads != 0) {
+    int quad = HighBit(quads);
+    return Kickers(SortCode<RANKING>(HandType::FOUR_OF_A_KIND, quad, quad,
+                                     quad, quad, 0),
+                   ranks & ~(1u << quad), 1, 0);
+  }
+  if (trips != 0) {
+    int trip = HighBit(trips);
+    uint32_t rest = (trips & ~(1u << trip)) | pairs;
+    if (rest != 0) {
+      int pair = HighBit(rest);
+      return SortCode<RANKING>(HandType::FULL_HOUSE, trip, trip, trip, pair,
+                               pair);
+    }
+  }
+  int straight = StraightHigh<RANKING>(ranks);
+  if (straight != 0) {
+    return StraightSortCode<RANKING>(HandType::STRAIGHT, straight);
+  }
+  if (trips != 0) {
+    int trip = HighBit(trips);
+    return Kickers(SortCode<RANKING>(HandType::THREE_OF_A_KIND, trip, trip,
+                                     trip, 0, 0),
+                   ranks & ~(1u << trip), 2, 4);
+  }
+  if (pairs != 0) {
+    int high = HighBit(pairs);
+    uint32_t low_pairs = pairs & ~(1u << high);
+    if (low_pairs != 0) {
+      int low = HighBit(low_pairs);
+      return Kickers(SortCode<RANKING>(HandType::TWO_PAIR, high, high, low,
+                                       low, 0),
+                     ranks & ~(1u << high) & ~(1u << low), 1, 0);
+    }
+    return Kickers(SortCode<RANKING>(HandType::ONE_PAIR, high, high, 0, 0, 0),
+                   ranks & ~(1u << high), 3, 8);
+  }
+  return Kickers(SortCode<RANKING>(HandType::HIGH_CARD, 0, 0, 0, 0, 0), ranks,
+                 5, 16);
+}
+
+} // namespace card_mask_internal
+
+// Evaluates the best five-card hand in a mask of five to seven cards and
+// returns its sort code, identical to HandEvaluator's Hand::sort_code() for
+// the same cards under the standard ranking.  Branches only on hand
+// category, never per rank or card; the ranking only changes constants.
+template <typename RANKING = StandardRanking>
+inline int32_t EvaluateCardMask(uint64_t mask) {
+  using namespace card_mask_internal;
+  uint32_t s0 = SuitRanks(mask, 0);
+  uint32_t s1 = SuitRanks(mask, 1);
+  uint32_t s2 = SuitRanks(mask, 2);
+  uint32_t s3 = SuitRanks(mask, 3);
+
+  // With at most seven cards a flush excludes quads and full houses
+  uint32_t flush = 0;
+  if (__builtin_popcount(s0) >= 5) {
+    flush = s0;
+  } else if (__builtin_popcount(s1) >= 5) {
+    flush = s1;
+  } else if (__builtin_popcount(s2) >= 5) {
+    flush = s2;
+  } else if (__builtin_popcount(s3) >= 5) {
+    flush = s3;
+  }
+  if (flush != 0) {
+    return EvaluateFlush<RANKING>(flush);
+  }
+  return EvaluateNoFlush<RANKING>(s0, s1, s2, s3);
+}
+
+} // namespace poker
+
+#endif // CARD_MASK_H
@@ -84,16 +84,3 @@ std::wostream& operator<<(std::wostream& os, const Card& card) {
   os << card.rank() << card.suit();
   return os;
 }
-
-std::wostream& operator<<(std::wostream& os, const Deck& deck) {
-  bool after_first{};
-  for (Card card : deck.Cards()) {
-    if (after_first) {
-      os << L" " << card;
-    } else {
-      os << card;
-      after_first = true;
-    }
-  }
-  return os;
-}
@@ -2,8 +2,12 @@
 #define CARDS_H
 
 #include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <random>
 #include <vector>
 
 #include "cards.pb.h"
@@ -52,37 +56,108 @@ inline int BySuitAceLowSortFn(Card lhs, Card rhs) {
   return lhs.suit() < rhs.suit();
 }
 
-class Deck {
+// Returns a uniformly distributed integer in [0, range).  Uses Lemire's
+// multiply-and-reject method, which needs a division only on the rare
+// rejection path, unlike std::uniform_int_distribution.  RNG must produce 32
+// random bits per call (e.g. std::mt19937).
+template <typename RNG>
+uint32_t UniformBelow(RNG& rng, uint32_t range) {
+  static_assert(RNG::min() == 0 && RNG::max() == UINT32_MAX,
+                "RNG must produce 32-bit values");
+  uint64_t product = static_cast<uint64_t>(rng()) * range;
+  uint32_t low = static_cast<uint32_t>(product);
+  if (low < range) {
+    uint32_t threshold = -range % range;
+    while (low < threshold) {
+      product = static_cast<uint64_t>(rng()) * range;
+      low = static_cast<uint32_t>(product);
+    }
+  }
+  return static_cast<uint32_t>(product >> 32);
+}
+
+// A deck of the cards of rank kLowRank through the ace in every suit, dealt
+// in shuffled order.  The deck's makeup is fixed at compile time so the
+// dealing loops see a constant size; Deck is the standard 52 cards and
+// ShortDeck the 36 of short-deck (6+) hold'em.
+template <Rank kLowRank>
+class BasicDeck {
 public:
-  Deck() : next_(0) {
+  static constexpr int kRankCount =
+      static_cast<int>(Rank::ACE) - static_cast<int>(kLowRank) + 1;
+  static constexpr int kDeckSize = 4 * kRankCount;
+
+  BasicDeck() : next_(0) {
     for (Suit suit : {Suit::SPADES, Suit::CLUBS, Suit::HEARTS, Suit::DIAMONDS}) {
-      for (Rank rank : {Rank::ACE, Rank::TWO, Rank::THREE, Rank::FOUR,
-                        Rank::FIVE, Rank::SIX, Rank::SEVEN, Rank::EIGHT,
-			Rank::NINE, Rank::TEN, Rank::JACK, Rank::QUEEN,
-			Rank::KING}) {
-        Card card;
+      Card card;
+      card.set_suit(suit);
+      card.set_rank(Rank::ACE);
+      cards_.push_back(card);
+      for (Rank rank = kLowRank; rank < Rank::ACE; rank = OffsetRank(rank, 1)) {
         card.set_rank(rank);
-        card.set_suit(suit);
         cards_.push_back(card);
       }
     }
+    for (int i = 0; i < kDeckSize; i++) {
+      order_[i] = static_cast<uint8_t>(i);
+    }
   }
+  // Shuffles the deck.  If count is given only the first count cards are
+  // drawn (a partial Fisher-Yates shuffle), which is all a hand that deals
+  // at most count cards needs; those cards are as random as with a full
+  // shuffle.  Only the card order (one byte per card) is permuted.
   template <typename RNG>
-  void Shuffle(RNG& rng) {
-    std::shuffle(cards_.begin(), cards_.end(), rng);
+  void Shuffle(RNG& rng, int count = kDeckSize) {
+    assert(count <= kDeckSize);
+    for (int i = 0; i < count && i < kDeckSize - 1; i++) {
+      int j = i + UniformBelow(rng, kDeckSize - i);
+      std::swap(order_[i], order_[j]);
+    }
     next_ = 0;
+    dealable_ = count;
   }
   void Sort(std::function<bool(Card,Card)> sort_fn) {
-    std::sort(cards_.begin(), cards_.end(), sort_fn);
+    std::sort(order_.begin(), order_.end(), [&](uint8_t lhs, uint8_t rhs) {
+      return sort_fn(cards_[lhs], cards_[rhs]);
+    });
     next_ = 0;
+    dealable_ = kDeckSize;
   }
-  const std::vector<Card>& Cards() const { return cards_; }
-  Card DealCard() { return cards_[next_++]; }
+  // Returns the cards in deal order.
+  std::vector<Card> Cards() const {
+    std::vector<Card> cards;
+    for (uint8_t i : order_) {
+      cards.push_back(cards_[i]);
+    }
+    return cards;
+  }
+  const Card& DealCard() {
+    assert(next_ < dealable_);
+    return cards_[order_[next_++]];
+  }
+
 private:
   std::vector<Card> cards_;
+  std::array<uint8_t, kDeckSize> order_;
   int next_;
+  int dealable_ = kDeckSize;
 };
 
-std::wostream& operator<<(std::wostream& os, const Deck& deck);
+using Deck = BasicDeck<Rank::TWO>;
+using ShortDeck = BasicDeck<Rank::SIX>;
+
+template <Rank kLowRank>
+std::wostream& operator<<(std::wostream& os, const BasicDeck<kLowRank>& deck) {
+  bool after_first{};
+  for (Card card : deck.Cards()) {
+    if (after_first) {
+      os << L" " << card;
+    } else {
+      os << card;
+      after_first = true;
+    }
+  }
+  return os;
+}
 
 #endif // CARDS_H
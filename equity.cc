@@ -0,0 +1,92 @@
+#include "equity.h"
+
+namespace poker::holdem {
+
+namespace {
+
+// Deals the rest of the board in every way, left cards from unseen[first..)
+// at a time, keeping each player's cards with the board dealt so far per
+// level.
+class Enumeration {
+public:
+  Enumeration(const uint64_t* unseen, int count, int players, double* share)
+    : unseen_(unseen), count_(count), players_(players), share_(share) {}
+
+  void Deal(int level, int left, int first) {
+    const std::array<uint64_t, kMaxPlayers>& hands = hands_[level];
+    if (left == 0) {
+      std::array<int32_t, kMaxPlayers> strength;
+      for (int p = 0; p < players_; p++) {
+        strength[p] = EvaluateCardMask(hands[p]);
+      }
+      equity_internal::AddShowdown(strength.data(), players_, share_);
+      runouts_++;
+      return;
+    }
+    std::array<uint64_t, kMaxPlayers>& next = hands_[level + 1];
+    for (int c = first; c <= count_ - left; c++) {
+      for (int p = 0; p < players_; p++) {
+        next[p] = hands[p] | unseen_[c];
+      }
+      Deal(level + 1, left - 1, c + 1);
+    }
+  }
+
+  std::array<uint64_t, kMaxPlayers>& hands() { return hands_[0]; }
+  uint64_t runouts() const { return runouts_; }
+
+private:
+  const uint64_t* unseen_;
+  int count_;
+  int players_;
+  double* share_;
+  std::array<std::array<uint64_t, kMaxPlayers>, kMaxCommunityCards + 1>
+      hands_;
+  uint64_t runouts_{};
+};
+
+} // namespace
+
+uint64_t RunoutCount(uint64_t known, uint64_t board) {
+  uint64_t unseen = kCardCount - __builtin_popcountll(known);
+  int to_deal = kMaxCommunityCards - __builtin_popcountll(board);
+  uint64_t count = 1;
+  for (int i = 0; i < to_deal; i++) {
+    count = count * (unseen - i) / (i + 1);
+  }
+  return count;
+}
+
+Equity EnumerateEquity(const uint64_t* hole, int players, uint64_t board,
+                       uint64_t dead) {
+  uint64_t known = board | dead;
+  for (int i = 0; i < players; i++) {
+    known |= hole[i];
+  }
+  std::array<uint64_t, kCardCount> unseen;
+  int count = 0;
+  for (uint64_t cards = kFullDeckMask & ~known; cards != 0;
+       cards &= cards - 1) {
+    unseen[count++] = cards & -cards;
+  }
+
+  Equity equity;
+  Enumeration enumeration(unseen.data(), count, players,
+                          equity.share.data());
+  for (int p = 0; p < players; p++) {
+    enumeration.hands()[p] = board | hole[p];
+  }
+  enumeration.Deal(0, kMaxCommunityCards - __builtin_popcountll(board), 0);
+  if (enumeration.runouts() == 0) {
+    // Too few unseen cards to complete the board
+    return equity;
+  }
+  for (int p = 0; p < players; p++) {
+    equity.share[p] /= enumeration.runouts();
+  }
+  equity.runouts = enumeration.runouts();
+  equity.exact = true;
+  return equity;
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,188 @@
+#ifndef EQUITY_H
+#define EQUITY_H
+
+#include <array>
+#include <cstdint>
+
+#include "card_mask.h"
+#include "cards.h"
+#include "holdem_state.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// Showdown equity of known hole cards: each player's expected share of the
+// pot over the runouts of the rest of the board, ties split evenly.  Side
+// pots and any further betting are not taken into account.
+struct Equity {
+  std::array<double, kMaxPlayers> share{};
+  // Runouts enumerated or sampled
+  uint64_t runouts{};
+  // True if every runout was enumerated
+  bool exact{};
+};
+
+// ShowdownEquity() enumerates every runout when there are at most this many
+// and samples this many otherwise.  Heads up that is exact from the flop on
+// (990 runouts) and sampled preflop (1.7 million).
+constexpr uint64_t kDefaultMaxRunouts = 100000;
+
+// Returns the number of ways to complete board from the cards not in known
+// (which includes the board).
+uint64_t RunoutCount(uint64_t known, uint64_t board);
+
+// Equity of hole[0..players) on board over every runout, with any other
+// known cards in dead.  The board is completed card by card in nested loops,
+// so each player's cards with the board so far are combined once per prefix
+// and only the final card is added per runout.  If too few cards are left to
+// complete the board, returns no runouts and no shares.
+Equity EnumerateEquity(const uint64_t* hole, int players, uint64_t board,
+                       uint64_t dead = 0);
+
+// Equity of hole[0..players) on board over samples random runouts, with
+// any other known cards in dead.  Players whose hole is 0 hold a random hand:
+// each sample deals them two of the unseen cards along with the runout.
+// Like EnumerateEquity(), returns no runouts if too few cards are left to
+// deal.
+template <typename RNG>
+Equity SampleEquity(const uint64_t* hole, int players, uint64_t board,
+                    uint64_t dead, RNG& rng, uint64_t samples);
+
+// Enumerates when there are at most max_runouts runouts and samples
+// max_runouts of them otherwise.  Random hands (hole 0, see SampleEquity())
+// are always sampled.
+template <typename RNG>
+Equity ShowdownEquity(const uint64_t* hole, int players, uint64_t board,
+                      uint64_t dead, RNG& rng,
+                      uint64_t max_runouts = kDefaultMaxRunouts) {
+  uint64_t known = board | dead;
+  bool random_hands = false;
+  for (int i = 0; i < players; i++) {
+    known |= hole[i];
+    random_hands |= hole[i] == 0;
+  }
+  if (!random_hands && RunoutCount(known, board) <= max_runouts) {
+    return EnumerateEquity(hole, players, board, dead);
+  }
+  return SampleEquity(hole, players, board, dead, rng, max_runouts);
+}
+
+// Equity of the players still in the hand at state, by position; folded
+// players get none.  Every dealt card, folded hands included, is dead.
+template <typename RNG>
+Equity ShowdownEquity(const HoldemState& state, RNG& rng,
+                      uint64_t max_runouts = kDefaultMaxRunouts);
+
+namespace equity_internal {
+
+// Adds the pot share of each player with the best of strength to share.
+inline void AddShowdown(const int32_t* strength, int players,
+                        double* share) {
+  int32_t best = strength[0];
+  int winners = 1;
+  for (int i = 1; i < players; i++) {
+    if (strength[i] > best) {
+      best = strength[i];
+      winners = 1;
+    } else if (strength[i] == best) {
+      winners++;
+    }
+  }
+  double split = 1.0 / winners;
+  for (int i = 0; i < players; i++) {
+    if (strength[i] == best) {
+      share[i] += split;
+    }
+  }
+}
+
+} // namespace equity_internal
+
+template <typename RNG>
+Equity SampleEquity(const uint64_t* hole, int players, uint64_t board,
+                    uint64_t dead, RNG& rng, uint64_t samples) {
+  uint64_t known = board | dead;
+  for (int i = 0; i < players; i++) {
+    known |= hole[i];
+  }
+  std::array<uint64_t, kCardCount> unseen;
+  int count = 0;
+  for (uint64_t cards = kFullDeckMask & ~known; cards != 0;
+       cards &= cards - 1) {
+    unseen[count++] = cards & -cards;
+  }
+  const int board_cards = kMaxCommunityCards - __builtin_popcountll(board);
+  int to_deal = board_cards;
+  for (int i = 0; i < players; i++) {
+    to_deal += hole[i] == 0 ? 2 : 0;
+  }
+
+  Equity equity;
+  if (to_deal > count || samples == 0) {
+    return equity;
+  }
+  std::array<int32_t, kMaxPlayers> strength;
+  for (uint64_t n = 0; n < samples; n++) {
+    // A partial Fisher-Yates shuffle of the unseen cards, as Deck::Shuffle():
+    // the runout, then the random hands
+    for (int i = 0; i < to_deal; i++) {
+      std::swap(unseen[i], unseen[i + UniformBelow(rng, count - i)]);
+    }
+    uint64_t runout = board;
+    for (int i = 0; i < board_cards; i++) {
+      runout |= unseen[i];
+    }
+    for (int p = 0, next = board_cards; p < players; p++) {
+      uint64_t cards = hole[p];
+      if (cards == 0) {
+        cards = unseen[next] | unseen[next + 1];
+        next += 2;
+      }
+      strength[p] = EvaluateCardMask(runout | cards);
+    }
+    equity_internal::AddShowdown(strength.data(), players,
+                                 equity.share.data());
+  }
+  for (int p = 0; p < players; p++) {
+    equity.share[p] /= samples;
+  }
+  equity.runouts = samples;
+  return equity;
+}
+
+template <typename RNG>
+Equity ShowdownEquity(const HoldemState& state, RNG& rng,
+                      uint64_t max_runouts) {
+  std::array<uint64_t, kMaxPlayers> hole;
+  std::array<int, kMaxPlayers> position;
+  uint64_t folded = 0;
+  int players = 0;
+  for (int i = 0; i < state.players; i++) {
+    if (state.is_folded(i)) {
+      folded |= state.hole[i];
+    } else {
+      position[players] = i;
+      hole[players++] = state.hole[i];
+    }
+  }
+  Equity live;
+  if (players == 1) {
+    live.share[0] = 1;
+    live.runouts = 1;
+    live.exact = true;
+  } else {
+    live = ShowdownEquity(hole.data(), players, state.board, folded, rng,
+                          max_runouts);
+  }
+  Equity equity;
+  equity.runouts = live.runouts;
+  equity.exact = live.exact;
+  for (int i = 0; i < players; i++) {
+    equity.share[position[i]] = live.share[i];
+  }
+  return equity;
+}
+
+} // namespace poker::holdem
+
+#endif // EQUITY_H
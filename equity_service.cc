@@ -0,0 +1,203 @@
+#include "equity_service.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include "card_mask.h"
+
+namespace poker::holdem {
+
+namespace {
+
+constexpr std::string_view kRanks = "23456789TJQKA";
+constexpr std::string_view kSuits = "schd";
+
+[[noreturn]] void BadQuery(const std::string& message) {
+  throw std::invalid_argument(message);
+}
+
+// Parses the concatenated cards of word into *cards, checking each against
+// *known (every card parsed so far) and adding it.  Returns the number of
+// cards.
+int ParseCards(std::string_view word, uint64_t* cards, uint64_t* known) {
+  if (word.size() % 2 != 0) {
+    BadQuery("Bad cards: " + std::string(word));
+  }
+  for (size_t i = 0; i < word.size(); i += 2) {
+    size_t rank = kRanks.find(word[i]);
+    size_t suit = kSuits.find(word[i + 1]);
+    if (rank == std::string_view::npos || suit == std::string_view::npos) {
+      BadQuery("Bad card: " + std::string(word.substr(i, 2)));
+    }
+    uint64_t card = IndexToCardMask(suit * kRankCount + rank);
+    if (*known & card) {
+      BadQuery("Card dealt twice: " + std::string(word.substr(i, 2)));
+    }
+    *known |= card;
+    *cards |= card;
+  }
+  return word.size() / 2;
+}
+
+} // namespace
+
+EquityQuery ParseEquityQuery(std::string_view args) {
+  EquityQuery query;
+  uint64_t known = 0;
+  // Which list words go to: hands, the board or the dead cards
+  enum { HANDS, BOARD, DEAD } section = HANDS;
+  int board_cards = 0;
+  int random_hands = 0;
+  size_t pos = 0;
+  while (pos < args.size()) {
+    size_t end = std::min(args.find(' ', pos), args.size());
+    std::string_view word = args.substr(pos, end - pos);
+    pos = end + 1;
+    if (word.empty()) {
+      continue;
+    }
+    if (word == "BOARD") {
+      section = BOARD;
+    } else if (word == "DEAD") {
+      section = DEAD;
+    } else if (section == BOARD) {
+      board_cards += ParseCards(word, &query.board, &known);
+    } else if (section == DEAD) {
+      ParseCards(word, &query.dead, &known);
+    } else {
+      if (query.players == kMaxPlayers) {
+        BadQuery("More than 10 hands");
+      }
+      uint64_t& hole = query.hole[query.players++];
+      if (word == "??") {
+        random_hands++;
+      } else if (ParseCards(word, &hole, &known) != kHoleCards) {
+        BadQuery("Bad hand: " + std::string(word));
+      }
+    }
+  }
+  if (query.players < 2) {
+    BadQuery("Fewer than 2 hands");
+  }
+  if (board_cards == 1 || board_cards == 2 ||
+      board_cards > kMaxCommunityCards) {
+    BadQuery("A board has 0, 3, 4 or 5 cards");
+  }
+  if (kHoleCards * random_hands + kMaxCommunityCards - board_cards >
+      kCardCount - __builtin_popcountll(known)) {
+    BadQuery("Too few cards left to deal");
+  }
+  return query;
+}
+
+std::string EquityCacheKey(const EquityQuery& query) {
+  // Each suit's ranks on the board, in each hand and among the dead cards.
+  // Sorting the suits by them makes the key the same under any permutation
+  // of suits, like CanonicalizeSuits() for one hand.
+  constexpr int kLanes = kMaxPlayers + 2;
+  std::array<std::array<uint16_t, kLanes>, kSuitCount> suits{};
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    suits[suit][0] = SuitRanks(query.board, suit);
+    for (int p = 0; p < query.players; p++) {
+      suits[suit][1 + p] = SuitRanks(query.hole[p], suit);
+    }
+    suits[suit][kLanes - 1] = SuitRanks(query.dead, suit);
+  }
+  std::sort(suits.begin(), suits.end());
+
+  std::string key(1, static_cast<char>(query.players));
+  // Random hands are 0 in every suit, so the key also tells them apart
+  for (const auto& lanes : suits) {
+    key.append(reinterpret_cast<const char*>(lanes.data()),
+               sizeof(uint16_t) * kLanes);
+  }
+  return key;
+}
+
+std::string FormatEquity(const Equity& equity, int players, bool cached) {
+  std::string out = "OK";
+  char share[16];
+  for (int p = 0; p < players; p++) {
+    std::snprintf(share, sizeof(share), " %.6f", equity.share[p]);
+    out += share;
+  }
+  out += " runouts=" + std::to_string(equity.runouts);
+  out += equity.exact ? " exact=1" : " exact=0";
+  out += cached ? " cached=1" : " cached=0";
+  return out;
+}
+
+EquityCache::EquityCache(size_t capacity) : capacity_(capacity) {
+  map_.reserve(capacity);
+}
+
+const Equity* EquityCache::Find(const std::string& key) {
+  auto iter = map_.find(key);
+  if (iter == map_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, iter->second);
+  return &iter->second->equity;
+}
+
+void EquityCache::Insert(const std::string& key, const Equity& equity) {
+  if (capacity_ == 0) {
+    return;
+  }
+  auto iter = map_.find(key);
+  if (iter != map_.end()) {
+    iter->second->equity = equity;
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return;
+  }
+  if (map_.size() == capacity_) {
+    map_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+  entries_.push_front({key, equity});
+  map_.emplace(key, entries_.begin());
+}
+
+int LatencyHistogram::Bucket(uint64_t micros) {
+  if (micros < kExact) {
+    return micros;
+  }
+  // Highest bit at least 4: eight sub-buckets per power of two
+  int high = 63 - __builtin_clzll(micros);
+  int sub = (micros >> (high - 3)) & (kSubBuckets - 1);
+  return kExact + (high - 4) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::BucketLimit(int bucket) {
+  if (bucket < kExact) {
+    return bucket;
+  }
+  int high = (bucket - kExact) / kSubBuckets + 4;
+  uint64_t sub = (bucket - kExact) % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << (high - 3)) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+  buckets_[Bucket(micros)]++;
+  count_++;
+  max_ = std::max(max_, micros);
+}
+
+uint64_t LatencyHistogram::Percentile(double quantile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  // Rank of the quantile among the recorded latencies, from 1
+  uint64_t rank = std::max<uint64_t>(1, quantile * count_ + 0.5);
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < kBucketCount; bucket++) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      return std::min(BucketLimit(bucket), max_);
+    }
+  }
+  return max_;
+}
+
+} // namespace poker::holdem
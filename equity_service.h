@@ -0,0 +1,105 @@
+#ifndef EQUITY_SERVICE_H
+#define EQUITY_SERVICE_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "equity.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// The request side of poker_equityd's line protocol.  A request is one line:
+//
+//   EQUITY <hand> <hand>... [BOARD <cards>] [DEAD <cards>]
+//   STATS
+//
+// where each hand is two cards such as "AhKh", or "??" for a random hand,
+// and cards are concatenated ("Js9s2c").  EQUITY is answered with
+//
+//   OK <share> <share>... runouts=<n> exact=<0|1> cached=<0|1>
+//
+// (each player's share of the pot, in the order given) and STATS with the
+// daemon's counters and latency percentiles.  Errors are answered with
+// "ERROR <message>".
+struct EquityQuery {
+  int players{};
+  // Card masks, 0 for a random hand
+  std::array<uint64_t, kMaxPlayers> hole{};
+  uint64_t board{};
+  uint64_t dead{};
+};
+
+// Parses the arguments of an EQUITY request (the line after "EQUITY ").
+// Throws std::invalid_argument if they aren't 2 to kMaxPlayers hands and a
+// board of 0, 3, 4 or 5 cards, a card is dealt twice, or too few cards are
+// left to deal the random hands and the rest of the board.
+EquityQuery ParseEquityQuery(std::string_view args);
+
+// Returns the key of query's equity that is the same for every query that
+// differs from it only by a permutation of suits (see CanonicalizeSuits()),
+// as every player's equity is.
+std::string EquityCacheKey(const EquityQuery& query);
+
+// Formats the answer to an EQUITY request with players.
+std::string FormatEquity(const Equity& equity, int players, bool cached);
+
+// Least recently used cache of equities by EquityCacheKey().  Not thread
+// safe.
+class EquityCache {
+public:
+  explicit EquityCache(size_t capacity);
+
+  // Returns the equity of key and marks it most recently used, or nullptr.
+  const Equity* Find(const std::string& key);
+  // Adds the equity of key, evicting the least recently used entry if the
+  // cache is full.
+  void Insert(const std::string& key, const Equity& equity);
+
+  size_t size() const { return map_.size(); }
+
+private:
+  struct Entry {
+    std::string key;
+    Equity equity;
+  };
+
+  size_t capacity_;
+  // Most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> map_;
+};
+
+// Histogram of latencies in microseconds with a resolution of 1/8 of a
+// power of two (exact below 16 us), cheap enough to record every request.
+class LatencyHistogram {
+public:
+  void Record(uint64_t micros);
+  // Returns the upper bound of the bucket holding the fraction quantile of
+  // the recorded latencies (e.g. 0.99), or 0 if there are none.
+  uint64_t Percentile(double quantile) const;
+
+  uint64_t count() const { return count_; }
+  uint64_t max() const { return max_; }
+
+private:
+  static constexpr int kExact = 16;
+  static constexpr int kSubBuckets = 8;
+  static constexpr int kBucketCount = kExact + (64 - 4) * kSubBuckets;
+
+  static int Bucket(uint64_t micros);
+  static uint64_t BucketLimit(int bucket);
+
+  std::array<uint64_t, kBucketCount> buckets_{};
+  uint64_t count_{};
+  uint64_t max_{};
+};
+
+} // namespace poker::holdem
+
+#endif // EQUITY_SERVICE_H
@@ -0,0 +1,47 @@
+#ifndef FIXED_VECTOR_H
+#define FIXED_VECTOR_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+namespace poker {
+
+// A vector with inline storage for at most N elements.  Used for per-hand
+// state whose size is bounded by the game rules (hole cards, board, seats) so
+// that resetting and refilling it never touches the allocator.
+template <typename T, int N>
+class FixedVector {
+public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  static constexpr size_t capacity() { return N; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  T& operator[](size_t i) { assert(i < size_); return items_[i]; }
+  const T& operator[](size_t i) const { assert(i < size_); return items_[i]; }
+
+  T* data() { return items_.data(); }
+  const T* data() const { return items_.data(); }
+  iterator begin() { return items_.data(); }
+  iterator end() { return items_.data() + size_; }
+  const_iterator begin() const { return items_.data(); }
+  const_iterator end() const { return items_.data() + size_; }
+
+  void push_back(const T& item) {
+    assert(size_ < N);
+    items_[size_++] = item;
+  }
+  void clear() { size_ = 0; }
+
+private:
+  std::array<T, N> items_{};
+  size_t size_{};
+};
+
+} // namespace poker
+
+#endif // FIXED_VECTOR_H
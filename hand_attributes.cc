@@ -0,0 +1,142 @@
+#include "hand_attributes.h"
+
+#include <array>
+
+#include "card_mask.h"
+
+namespace poker {
+
+namespace {
+
+// Rank masks here have rank two at bit 0 and the ace at bit 12.
+constexpr int kRankMasks = 1 << kRankCount;
+
+bool HasStraight(uint32_t ranks) {
+  return card_mask_internal::StraightHigh(ranks << 2) != 0;
+}
+
+// Straight draw attributes and completing ranks of every rank mask
+struct StraightDraws {
+  std::array<uint8_t, kRankMasks> attributes;
+  std::array<uint16_t, kRankMasks> outs;
+};
+
+StraightDraws BuildStraightDraws() {
+  StraightDraws draws{};
+  for (uint32_t ranks = 0; ranks < kRankMasks; ranks++) {
+    if (HasStraight(ranks)) {
+      continue;
+    }
+    uint32_t outs = 0;
+    for (int rank = 0; rank < kRankCount; rank++) {
+      if (HasStraight(ranks | (1u << rank))) {
+        outs |= 1u << rank;
+      }
+    }
+    draws.outs[ranks] = outs;
+    int count = __builtin_popcount(outs);
+    if (count == 0) {
+      continue;
+    }
+    if (count == 1) {
+      draws.attributes[ranks] = HAND_ATTR_INSIDE_STRAIGHT_DRAW;
+      continue;
+    }
+    // With the ace also below the two (bit 0), look for four in a row with a
+    // completing rank at both ends.
+    uint32_t low_ranks = (ranks << 1) | (ranks >> 12);
+    uint32_t low_outs = (outs << 1) | (outs >> 12);
+    uint32_t runs = low_ranks & (low_ranks >> 1) & (low_ranks >> 2) &
+                    (low_ranks >> 3);
+    bool open = (runs & (low_outs << 1) & (low_outs >> 4)) != 0;
+    draws.attributes[ranks] = open ? HAND_ATTR_OUTSIDE_STRAIGHT_DRAW
+                                   : HAND_ATTR_DOUBLE_INSIDE_STRAIGHT_DRAW;
+  }
+  return draws;
+}
+
+const StraightDraws& SharedStraightDraws() {
+  static const StraightDraws draws = BuildStraightDraws();
+  return draws;
+}
+
+// Attribute of hole cards ranks apart by distance, with the ace high or low
+constexpr uint8_t kGapConnector[kRankCount + 1] = {
+  0, 0,
+  HAND_ATTR_ONE_GAP_CONNECTOR,
+  HAND_ATTR_TWO_GAP_CONNECTOR,
+  HAND_ATTR_THREE_GAP_CONNECTOR,
+};
+
+uint32_t RankMask(uint64_t cards) {
+  return ((SuitRanks(cards, 0) | SuitRanks(cards, 1) | SuitRanks(cards, 2) |
+           SuitRanks(cards, 3)) >> 2);
+}
+
+} // namespace
+
+uint32_t HandAttributes(uint64_t hole, uint64_t board) {
+  const StraightDraws& draws = SharedStraightDraws();
+  uint32_t hole_ranks = RankMask(hole);
+  uint32_t attributes = 0;
+  if (__builtin_popcount(hole_ranks) == 2) {
+    int high = 31 - __builtin_clz(hole_ranks);
+    int low = __builtin_ctz(hole_ranks);
+    int distance = high - low;
+    // The ace (12) plays one below the two (0)
+    if (high == kRankCount - 1 && low + 1 < distance) {
+      distance = low + 1;
+    }
+    attributes |= kGapConnector[distance];
+  }
+
+  int board_cards = __builtin_popcountll(board);
+  if (board_cards < 3 || board_cards >= 5) {
+    return attributes;
+  }
+
+  uint64_t cards = hole | board;
+  bool flush = false;
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    int count = __builtin_popcount(SuitRanks(cards, suit));
+    bool hole_suit = SuitRanks(hole, suit) != 0;
+    flush |= count >= 5;
+    if (hole_suit && count == 4) {
+      attributes |= HAND_ATTR_FLUSH_DRAW;
+    }
+    if (hole_suit && count == 3 && board_cards == 3) {
+      attributes |= HAND_ATTR_BACKDOOR_FLUSH_DRAW;
+    }
+  }
+  if (flush) {
+    attributes &= ~(HAND_ATTR_FLUSH_DRAW | HAND_ATTR_BACKDOOR_FLUSH_DRAW);
+  }
+
+  // Straight draws count only if the hole cards add a completing rank
+  uint32_t ranks = RankMask(cards);
+  uint32_t board_ranks = RankMask(board);
+  if ((draws.outs[ranks] & ~draws.outs[board_ranks]) != 0) {
+    attributes |= draws.attributes[ranks];
+  }
+  return attributes;
+}
+
+HandAttribute HandAttributeAt(int i) {
+  return static_cast<HandAttribute>(1 << i);
+}
+
+const char* HandAttributeName(int i) {
+  static constexpr const char* kNames[kHandAttributeCount] = {
+    "One Gap Connector",
+    "Two Gap Connector",
+    "Three Gap Connector",
+    "Flush Draw",
+    "Backdoor Flush Draw",
+    "Outside Straight Draw",
+    "Inside Straight Draw",
+    "Double Inside Straight Draw",
+  };
+  return kNames[i];
+}
+
+} // namespace poker
@@ -0,0 +1,36 @@
+#ifndef HAND_ATTRIBUTES_H
+#define HAND_ATTRIBUTES_H
+
+#include <cstdint>
+
+#include "poker.pb.h"
+
+namespace poker {
+
+// Returns the HandAttribute bits of two hole cards on a board of zero to five
+// cards (card masks, see card_mask.h):
+//
+//  - gap connectors: hole cards of different ranks one, two or three ranks
+//    apart (an ace also plays low), on any street;
+//  - flush draw: four cards of a suit, at least one of them a hole card, and
+//    no flush yet;
+//  - backdoor flush draw: on the flop, three cards of a suit including a
+//    hole card;
+//  - straight draws: no straight yet, and the hole cards add a rank that
+//    would complete one.  Two ranks completing four in a row is an outside
+//    (open-ended) draw, two otherwise a double inside draw, and one an
+//    inside draw (gutshot, or a one-ended draw such as A-K-Q-J).
+//
+// Draws are only reported with cards to come, i.e. on the flop and turn.
+// Straight draws are looked up by rank mask in tables built once, and suits
+// are counted with popcounts, so nothing branches per rank.
+uint32_t HandAttributes(uint64_t hole, uint64_t board);
+
+constexpr int kHandAttributeCount = 8;
+// HandAttribute of bit i, and its name for output.
+HandAttribute HandAttributeAt(int i);
+const char* HandAttributeName(int i);
+
+} // namespace poker
+
+#endif // HAND_ATTRIBUTES_H
@@ -0,0 +1,327 @@
+#include "hand_history.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include "card_mask.h"
+
+namespace poker::holdem {
+
+namespace {
+
+// Largest encoding of a hand: two count bytes and a varint per round, the
+// cards, and each action with a five byte varint
+constexpr size_t kMaxHandSize = 2 + kRoundMax * 5 +
+                                kMaxPlayers * kMaxHoleCards +
+                                kMaxCommunityCards + kMaxActions * (1 + 5);
+
+void PutVarint(uint32_t value, uint8_t*& p) {
+  while (value >= 0x80) {
+    *p++ = static_cast<uint8_t>(value) | 0x80;
+    value >>= 7;
+  }
+  *p++ = static_cast<uint8_t>(value);
+}
+
+uint32_t GetVarint(const uint8_t*& p) {
+  uint32_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t byte = *p++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if (byte < 0x80) {
+      return value;
+    }
+  }
+}
+
+// Cards by card index, built once so replay doesn't construct protos per card
+const Card& CardAt(int index) {
+  static const std::array<Card, kCardCount>* const kCards = [] {
+    auto* cards = new std::array<Card, kCardCount>;
+    for (int i = 0; i < kCardCount; i++) {
+      (*cards)[i] = IndexToCard(i);
+    }
+    return cards;
+  }();
+  return (*kCards)[index];
+}
+
+} // namespace
+
+void RecordHand(const Table& table, const std::vector<Player>& players,
+                HandRecord* hand) {
+  hand->button = table.button();
+  size_t i = 0;
+  for (const Player& player : players) {
+    for (const Card& card : player.cards()) {
+      hand->hole[i++] = CardToIndex(card);
+    }
+  }
+  hand->board.clear();
+  for (const Card& card : table.community_cards()) {
+    hand->board.push_back(CardToIndex(card));
+  }
+  hand->actions = table.action_log();
+}
+
+HandHistoryWriter::HandHistoryWriter(const std::string& path,
+                                     const HandHistoryHeader& header)
+  : out_(path, std::ios::binary | std::ios::trunc), header_(header),
+    block_(kHistoryBlockSize) {
+  if (!out_) {
+    throw std::runtime_error("Can't open hand history " + path);
+  }
+  out_.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+}
+
+HandHistoryWriter::~HandHistoryWriter() {
+  // A destructor can't throw; callers that need to know the history was
+  // written call Flush() first
+  try {
+    Flush();
+  } catch (const std::runtime_error& err) {
+    std::cerr << "Error: " << err.what() << std::endl;
+  }
+}
+
+void HandHistoryWriter::Write(const Table& table,
+                              const std::vector<Player>& players) {
+  assert(players.size() == header_.players);
+  if (block_size_ + kMaxHandSize > kHistoryBlockSize) {
+    Flush();
+  }
+  const Table::ActionLog& actions = table.action_log();
+  uint8_t* p = block_.data() + block_size_;
+  *p++ = static_cast<uint8_t>(table.button());
+  *p++ = static_cast<uint8_t>(table.community_cards().size());
+  std::array<uint32_t, kRoundMax> round_actions{};
+  for (const ActionLogEntry& entry : actions) {
+    round_actions[entry.round]++;
+  }
+  for (uint32_t count : round_actions) {
+    PutVarint(count, p);
+  }
+  for (const Player& player : players) {
+    assert(player.cards().size() == header_.hole_cards);
+    for (const Card& card : player.cards()) {
+      *p++ = static_cast<uint8_t>(CardToIndex(card));
+    }
+  }
+  for (const Card& card : table.community_cards()) {
+    *p++ = static_cast<uint8_t>(CardToIndex(card));
+  }
+  for (const ActionLogEntry& entry : actions) {
+    *p++ = static_cast<uint8_t>(entry.position << 4 |
+                                static_cast<int>(entry.action));
+    PutVarint(static_cast<uint32_t>(entry.amount), p);
+  }
+  block_size_ = p - block_.data();
+  block_hands_++;
+  hands_++;
+}
+
+void HandHistoryWriter::Flush() {
+  if (block_hands_ == 0) {
+    return;
+  }
+  HandHistoryBlockHeader block{block_size_, block_size_, block_hands_};
+  const uint8_t* data = block_.data();
+  if (header_.flags & kHistoryCompressed) {
+    uLongf size = compressBound(block_size_);
+    compressed_.resize(size);
+    if (compress2(compressed_.data(), &size, block_.data(), block_size_,
+                  Z_BEST_SPEED) != Z_OK) {
+      throw std::runtime_error("Hand history compression failed");
+    }
+    block.stored_size = static_cast<uint32_t>(size);
+    data = compressed_.data();
+  }
+  out_.write(reinterpret_cast<const char*>(&block), sizeof(block));
+  out_.write(reinterpret_cast<const char*>(data), block.stored_size);
+  if (!out_) {
+    throw std::runtime_error("Error writing hand history");
+  }
+  block_size_ = 0;
+  block_hands_ = 0;
+}
+
+HandHistoryReader::HandHistoryReader(const std::string& path)
+  : in_(path, std::ios::binary) {
+  if (!in_.read(reinterpret_cast<char*>(&header_), sizeof(header_))) {
+    throw std::runtime_error("Can't read hand history " + path);
+  }
+  if (!std::equal(std::begin(kHistoryMagic), std::end(kHistoryMagic),
+                  header_.magic) ||
+      header_.version != kHistoryVersion) {
+    throw std::runtime_error(path + " isn't a version " +
+                             std::to_string(kHistoryVersion) +
+                             " hand history");
+  }
+  if (header_.players < 2 || header_.players > kMaxPlayers ||
+      header_.hole_cards < 1 || header_.hole_cards > kMaxHoleCards) {
+    throw std::runtime_error("Invalid hand history header in " + path);
+  }
+}
+
+bool HandHistoryReader::ReadBlock() {
+  HandHistoryBlockHeader block;
+  if (!in_.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+    return false;
+  }
+  if (block.size > kHistoryBlockSize) {
+    throw std::runtime_error("Corrupt hand history block");
+  }
+  // Padded so a corrupt hand can't decode past the end of the buffer
+  block_.resize(block.size + kMaxHandSize);
+  if (header_.flags & kHistoryCompressed) {
+    if (block.stored_size > compressBound(kHistoryBlockSize)) {
+      throw std::runtime_error("Corrupt hand history block");
+    }
+    stored_.resize(block.stored_size);
+    in_.read(reinterpret_cast<char*>(stored_.data()), block.stored_size);
+    uLongf size = block.size;
+    if (!in_ || uncompress(block_.data(), &size, stored_.data(),
+                           block.stored_size) != Z_OK ||
+        size != block.size) {
+      throw std::runtime_error("Corrupt hand history block");
+    }
+  } else if (!in_.read(reinterpret_cast<char*>(block_.data()), block.size)) {
+    throw std::runtime_error("Truncated hand history block");
+  }
+  next_ = block_.data();
+  end_ = next_ + block.size;
+  return true;
+}
+
+bool HandHistoryReader::Next(HandRecord* hand) {
+  while (next_ == end_) {
+    if (!ReadBlock()) {
+      return false;
+    }
+  }
+  const uint8_t* p = next_;
+  hand->button = *p++;
+  int board_count = *p++;
+  std::array<uint32_t, kRoundMax> round_actions;
+  uint64_t action_count = 0;
+  for (uint32_t& count : round_actions) {
+    count = GetVarint(p);
+    action_count += count;
+  }
+  if (hand->button >= header_.players || board_count > kMaxCommunityCards ||
+      action_count > kMaxActions) {
+    throw std::runtime_error("Corrupt hand history block");
+  }
+  const int hole_count = header_.players * header_.hole_cards;
+  std::copy(p, p + hole_count, hand->hole.begin());
+  p += hole_count;
+  hand->board.clear();
+  for (int i = 0; i < board_count; i++) {
+    hand->board.push_back(*p++);
+  }
+  hand->actions.clear();
+  for (int round = 0; round < kRoundMax; round++) {
+    for (uint32_t i = 0; i < round_actions[round]; i++) {
+      uint8_t byte = *p++;
+      int32_t amount = static_cast<int32_t>(GetVarint(p));
+      int position = byte >> 4;
+      int action = byte & 0xF;
+      if (position >= header_.players ||
+          action < static_cast<int>(PlayerAction::FOLD) ||
+          action > static_cast<int>(PlayerAction::RAISE_ALL_IN)) {
+        throw std::runtime_error("Corrupt hand history block");
+      }
+      hand->actions.push_back({static_cast<int8_t>(round),
+                               static_cast<int8_t>(position),
+                               static_cast<PlayerAction>(action), amount});
+    }
+  }
+  uint8_t highest_card = 0;
+  for (int i = 0; i < hole_count; i++) {
+    highest_card = std::max(highest_card, hand->hole[i]);
+  }
+  for (uint8_t card : hand->board) {
+    highest_card = std::max(highest_card, card);
+  }
+  if (p > end_ || highest_card >= kCardCount) {
+    throw std::runtime_error("Corrupt hand history block");
+  }
+  next_ = p;
+  return true;
+}
+
+HandReplay::HandReplay(const HandHistoryHeader& header)
+  : hole_cards_(header.hole_cards), players_(header.players) {
+  Stakes stakes;
+  stakes.small_blind = header.small_blind;
+  stakes.big_blind = header.big_blind;
+  stakes.stack = header.stack;
+  table_.set_stakes(stakes);
+  table_.set_players(players_);
+}
+
+void HandReplay::Begin(const HandRecord& hand) {
+  const Stakes& stakes = table_.stakes();
+  const int count = players_.size();
+  table_.clear_community_cards();
+  table_.clear_betting();
+  table_.set_button(hand.button);
+  for (int i = 0; i < count; i++) {
+    players_[i].reset(stakes.StackAt(i));
+  }
+  // As Game: heads up the button posts the small blind
+  int small_blind = count == 2 ? hand.button
+                               : (hand.button + count - 1) % count;
+  int big_blind = (small_blind + count - 1) % count;
+  table_.add_to_pot(players_[small_blind].Bet(stakes.small_blind));
+  table_.add_to_pot(players_[big_blind].Bet(stakes.big_blind));
+  table_.set_bet(stakes.big_blind, stakes.big_blind);
+  in_hand_ = count;
+  next_action_ = 0;
+}
+
+bool HandReplay::PlayRound(const HandRecord& hand, Round round) {
+  static constexpr size_t kBoardCards[] = {0, 3, 4, 5};
+  const int round_index = static_cast<int>(round);
+  if (round == Round::PREFLOP) {
+    for (size_t i = 0; i < players_.size(); i++) {
+      for (int c = 0; c < hole_cards_; c++) {
+        players_[i].add_card(CardAt(hand.hole[i * hole_cards_ + c]));
+      }
+    }
+  } else {
+    for (size_t i = table_.community_cards().size();
+         i < kBoardCards[round_index] && i < hand.board.size(); i++) {
+      table_.add_community_card(CardAt(hand.board[i]));
+    }
+    for (Player& player : players_) {
+      player.clear_bet();
+    }
+    table_.set_bet(0, table_.stakes().big_blind);
+  }
+  for (; next_action_ < hand.actions.size() &&
+         hand.actions[next_action_].round == round_index;
+       next_action_++) {
+    const ActionLogEntry& entry = hand.actions[next_action_];
+    Player& player = players_[entry.position];
+    if (entry.action == PlayerAction::FOLD) {
+      player.fold();
+      in_hand_--;
+    } else if (entry.amount > player.bet()) {
+      table_.add_to_pot(player.Bet(entry.amount - player.bet()));
+      if (player.bet() > table_.bet()) {
+        table_.set_bet(player.bet(), std::max(table_.min_raise(),
+                                              player.bet() - table_.bet()));
+      }
+    }
+    table_.log_action(entry);
+  }
+  return in_hand_ > 1;
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,237 @@
+#ifndef HAND_HISTORY_H
+#define HAND_HISTORY_H
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fixed_vector.h"
+#include "holdem.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// A compact binary record of simulated hands: the cards dealt and every
+// action, so the hands can be replayed into statistics collectors that didn't
+// exist when they were played, without simulating them again.
+//
+// A file is a HandHistoryHeader followed by blocks.  Each block is a
+// HandHistoryBlockHeader and up to kHistoryBlockSize bytes of hands
+// (compressed with zlib when the header says so), and no hand spans two
+// blocks, so blocks can be decoded independently.  A hand is
+//
+//   button and board card count (1 byte each), actions in each of the four
+//   rounds (base 128 varint each); hole cards seat by seat, then the board (1
+//   byte card index each, see card_mask.h); each action as position << 4 |
+//   PlayerAction (1 byte) followed by its amount as a base 128 varint
+//
+// which is about 30 bytes for a six player hand between tight players, and
+// about 70 when all six check it down to the showdown.  Integers in headers
+// are little-endian.
+constexpr char kHistoryMagic[4] = {'P', 'K', 'H', 'H'};
+// Version 2 stores the per round action counts as varints, since a round
+// between deep stacks can have more than 255 actions.
+constexpr uint16_t kHistoryVersion = 2;
+constexpr uint32_t kHistoryBlockSize = 1 << 20;
+
+constexpr uint16_t kHistoryCompressed = 0x1;
+
+struct HandHistoryHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t flags;
+  // Game the hands were played in: the hole cards per player and the lowest
+  // rank in the deck (see HoldemRules)
+  uint8_t hole_cards;
+  uint8_t low_rank;
+  uint8_t players;
+  uint8_t reserved;
+  int32_t small_blind;
+  int32_t big_blind;
+  int32_t stack;
+};
+static_assert(sizeof(HandHistoryHeader) == 24, "Header layout is on disk");
+
+struct HandHistoryBlockHeader {
+  // Bytes of hands, and of the block as stored (the same if uncompressed)
+  uint32_t size;
+  uint32_t stored_size;
+  uint32_t hands;
+};
+static_assert(sizeof(HandHistoryBlockHeader) == 12,
+              "Block header layout is on disk");
+
+// One recorded hand.  Cards are card indices (see card_mask.h).
+struct HandRecord {
+  uint8_t button;
+  // header.hole_cards per seat, seat by seat
+  std::array<uint8_t, kMaxPlayers * kMaxHoleCards> hole;
+  FixedVector<uint8_t, kMaxCommunityCards> board;
+  // The table's action log, which doesn't include the blinds
+  Table::ActionLog actions;
+};
+
+// Sets hand to the hand at table as dealt to players: the hole cards, the
+// community cards so far and the action log.
+void RecordHand(const Table& table, const std::vector<Player>& players,
+                HandRecord* hand);
+
+// Appends hands to a history file, buffering a block at a time so the file
+// sees only large sequential writes.  Throws std::runtime_error if the file
+// can't be written.
+class HandHistoryWriter {
+public:
+  HandHistoryWriter(const std::string& path, const HandHistoryHeader& header);
+  ~HandHistoryWriter();
+
+  // Records the hand at table as dealt to players: the hole cards, the
+  // community cards so far and the action log.
+  void Write(const Table& table, const std::vector<Player>& players);
+  // Writes out the buffered block.  Also called by the destructor, which
+  // reports errors on std::cerr instead of throwing; call it first to get
+  // them as exceptions.
+  void Flush();
+
+  uint64_t hands() const { return hands_; }
+
+private:
+  std::ofstream out_;
+  HandHistoryHeader header_;
+  std::vector<uint8_t> block_;
+  std::vector<uint8_t> compressed_;
+  uint32_t block_size_{};
+  uint32_t block_hands_{};
+  uint64_t hands_{};
+};
+
+// Reads the hands of a history file in order, a block at a time.  Throws
+// std::runtime_error if the file can't be read, isn't a hand history or is
+// corrupt (e.g. a seat or action out of range).
+class HandHistoryReader {
+public:
+  explicit HandHistoryReader(const std::string& path);
+
+  const HandHistoryHeader& header() const { return header_; }
+
+  // Reads the next hand into hand, or returns false at the end of the file.
+  bool Next(HandRecord* hand);
+
+private:
+  bool ReadBlock();
+
+  std::ifstream in_;
+  HandHistoryHeader header_;
+  std::vector<uint8_t> block_;
+  std::vector<uint8_t> stored_;
+  const uint8_t* next_{};
+  const uint8_t* end_{};
+};
+
+// Returns a header for hands of the game RULES dealt to players with stakes.
+template <typename RULES>
+HandHistoryHeader MakeHandHistoryHeader(int players, const Stakes& stakes,
+                                        bool compressed) {
+  HandHistoryHeader header{};
+  std::copy(std::begin(kHistoryMagic), std::end(kHistoryMagic),
+            header.magic);
+  header.version = kHistoryVersion;
+  header.flags = compressed ? kHistoryCompressed : 0;
+  header.hole_cards = RULES::kHoleCards;
+  header.low_rank = RULES::Ranking::kLowRank;
+  header.players = players;
+  header.small_blind = stakes.small_blind;
+  header.big_blind = stakes.big_blind;
+  header.stack = stakes.stack;
+  return header;
+}
+
+// Statistics collector that records every hand to a HandHistoryWriter as
+// well as passing it on to STATS.  Game calls it in STATS' place.
+template <typename STATS>
+class HandHistoryRecorder {
+public:
+  HandHistoryRecorder(STATS& stats, HandHistoryWriter& writer)
+    : stats_(stats), writer_(writer) {}
+
+  void NewGame(const Table& table, std::vector<Player>& players) {
+    table_ = &table;
+    players_ = &players;
+    stats_.NewGame(table, players);
+  }
+  void Collect(Round round) {
+    stats_.Collect(round);
+    if (round == Round::RIVER) {
+      writer_.Write(*table_, *players_);
+    }
+  }
+  void CollectUncontested(Round round) {
+    stats_.CollectUncontested(round);
+    writer_.Write(*table_, *players_);
+  }
+
+private:
+  STATS& stats_;
+  HandHistoryWriter& writer_;
+  const Table* table_{};
+  const std::vector<Player>* players_{};
+};
+
+// Replays recorded hands on its own table: deals each hand's cards and plays
+// its actions in the same order as Game, so collectors see the table and
+// players as they were.
+class HandReplay {
+public:
+  explicit HandReplay(const HandHistoryHeader& header);
+
+  Table& table() { return table_; }
+  std::vector<Player>& players() { return players_; }
+
+  // Starts hand: resets the players and posts the blinds.
+  void Begin(const HandRecord& hand);
+  // Deals round's cards (the hole cards preflop) and plays its actions.
+  // Returns false if everyone but one player has folded.
+  bool PlayRound(const HandRecord& hand, Round round);
+
+private:
+  int hole_cards_;
+  Table table_;
+  std::vector<Player> players_;
+  int in_hand_{};
+  size_t next_action_{};
+};
+
+// Feeds hand to stats through the collector interface Game uses (NewGame(),
+// Collect() and CollectUncontested()), played out on replay.
+template <typename STATS>
+void ReplayHand(const HandRecord& hand, HandReplay& replay, STATS& stats) {
+  replay.Begin(hand);
+  stats.NewGame(replay.table(), replay.players());
+  for (Round round : {Round::PREFLOP, Round::FLOP, Round::TURN,
+                      Round::RIVER}) {
+    if (!replay.PlayRound(hand, round)) {
+      stats.CollectUncontested(round);
+      break;
+    }
+    stats.Collect(round);
+  }
+}
+
+// Replays every hand of reader into stats (see ReplayHand()) and returns the
+// number of hands replayed.
+template <typename STATS>
+uint64_t ReplayHandHistory(HandHistoryReader& reader, STATS& stats) {
+  HandReplay replay(reader.header());
+  HandRecord hand;
+  uint64_t hands = 0;
+  while (reader.Next(&hand)) {
+    ReplayHand(hand, replay, stats);
+    hands++;
+  }
+  return hands;
+}
+
+} // namespace poker::holdem
+
+#endif // HAND_HISTORY_H
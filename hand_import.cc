@@ -0,0 +1,318 @@
+#include "hand_import.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "card_mask.h"
+
+namespace poker::holdem {
+
+namespace {
+
+constexpr std::string_view kStatePrefix = "STATE:";
+
+// Card index offsets by character: ranks '2'..'A' to 0..12 and suits to
+// their Suit less one times 13 (see card_mask.h), -1 for anything else
+constexpr std::array<int8_t, 256> MakeCharTable(bool suits) {
+  std::array<int8_t, 256> table{};
+  for (size_t i = 0; i < table.size(); i++) {
+    table[i] = -1;
+  }
+  if (suits) {
+    table['s'] = 0 * kRankCount;
+    table['c'] = 1 * kRankCount;
+    table['h'] = 2 * kRankCount;
+    table['d'] = 3 * kRankCount;
+  } else {
+    const char ranks[] = "23456789TJQKA";
+    for (int r = 0; r < kRankCount; r++) {
+      table[static_cast<uint8_t>(ranks[r])] = r;
+    }
+  }
+  return table;
+}
+
+constexpr std::array<int8_t, 256> kRankOffset = MakeCharTable(false);
+constexpr std::array<int8_t, 256> kSuitOffset = MakeCharTable(true);
+
+[[noreturn]] void Malformed(std::string_view line) {
+  constexpr size_t kMaxQuoted = 100;
+  throw std::invalid_argument("Malformed ACPC hand: " +
+                              std::string(line.substr(0, kMaxQuoted)));
+}
+
+[[noreturn]] void StakeMismatch(std::string_view line, int64_t raise_to,
+                                int32_t stack) {
+  constexpr size_t kMaxQuoted = 100;
+  throw std::invalid_argument(
+      "ACPC hand raises to " + std::to_string(raise_to) + " chips with a " +
+      std::to_string(stack) + " chip stack, so the import stakes don't " +
+      "match the log's: " + std::string(line.substr(0, kMaxQuoted)));
+}
+
+// Returns the start of the field after the next ':' at or after p, or
+// nullptr if there's none before end.
+const char* SkipField(const char* p, const char* end) {
+  const void* colon = std::memchr(p, ':', end - p);
+  return colon == nullptr ? nullptr : static_cast<const char*>(colon) + 1;
+}
+
+// Parses the card at p, such as "Ah", into its card index and moves p past
+// it.  Returns -1 if there's no card at p.
+int ParseCard(const char*& p, const char* end) {
+  if (end - p < 2) {
+    return -1;
+  }
+  int rank = kRankOffset[static_cast<uint8_t>(p[0])];
+  int suit = kSuitOffset[static_cast<uint8_t>(p[1])];
+  p += 2;
+  return rank < 0 || suit < 0 ? -1 : suit + rank;
+}
+
+} // namespace
+
+AcpcHandParser::AcpcHandParser(int players, const Stakes& stakes)
+  : players_(players), stakes_(stakes) {
+  if (players < 2 || players > kMaxPlayers) {
+    throw std::invalid_argument("ACPC hands need 2 to 10 players");
+  }
+}
+
+bool AcpcHandParser::Parse(std::string_view line, HandRecord* hand) {
+  if (line.substr(0, kStatePrefix.size()) != kStatePrefix) {
+    return false;
+  }
+  const char* end = line.data() + line.size();
+  const char* betting = SkipField(line.data() + kStatePrefix.size(), end);
+  const char* p = betting == nullptr ? nullptr : SkipField(betting, end);
+  if (p == nullptr) {
+    Malformed(line);
+  }
+  const char* betting_end = p - 1;
+
+  // Cards: hole cards of each seat, then the board by round
+  hand->button = 0;
+  for (int s = 0; s < players_; s++) {
+    if (s > 0 && (p == end || *p++ != '|')) {
+      Malformed(line);
+    }
+    for (int c = 0; c < kHoleCards; c++) {
+      int card = ParseCard(p, end);
+      if (card < 0) {
+        Malformed(line);
+      }
+      hand->hole[Seat(s) * kHoleCards + c] = card;
+    }
+  }
+  hand->board.clear();
+  while (p != end && *p == '/') {
+    p++;
+    while (p != end && *p != '/' && *p != ':') {
+      int card = ParseCard(p, end);
+      if (card < 0 || hand->board.size() == kMaxCommunityCards) {
+        Malformed(line);
+      }
+      hand->board.push_back(card);
+    }
+  }
+  if (p == end || *p != ':') {
+    Malformed(line);
+  }
+
+  // Betting.  ACPC seats act in ascending order; heads up seat 0 posts the
+  // big blind and seat 1 (the button) the small blind and acts first
+  // preflop, otherwise seats 0 and 1 post the blinds and seat 2 acts first.
+  // Chips each seat has, has put in the hand, and had put in by the start
+  // of the round
+  std::array<int32_t, kMaxPlayers> stack;
+  std::array<int32_t, kMaxPlayers> committed{};
+  std::array<int32_t, kMaxPlayers> round_start{};
+  for (int s = 0; s < players_; s++) {
+    stack[s] = stakes_.StackAt(Seat(s));
+  }
+  const int small_blind = players_ == 2 ? 1 : 0;
+  const int big_blind = players_ == 2 ? 0 : 1;
+  committed[small_blind] = std::min(stakes_.small_blind, stack[small_blind]);
+  committed[big_blind] = std::min(stakes_.big_blind, stack[big_blind]);
+  int32_t bet = stakes_.big_blind;
+  uint32_t inactive = 0;
+  int round = 0;
+  int actor = players_ == 2 ? 1 : 2;
+  hand->actions.clear();
+  for (const char* q = betting; q != betting_end;) {
+    char c = *q++;
+    if (c == '/') {
+      if (++round == kRoundMax) {
+        Malformed(line);
+      }
+      round_start = committed;
+      actor = 0;
+      continue;
+    }
+    for (int i = 0; (inactive >> actor) & 1; i++) {
+      if (i == players_) {
+        Malformed(line);
+      }
+      actor = actor + 1 == players_ ? 0 : actor + 1;
+    }
+    PlayerAction action;
+    if (c == 'f') {
+      action = PlayerAction::FOLD;
+      inactive |= 1u << actor;
+    } else if (c == 'c') {
+      action = PlayerAction::CHECK;
+      committed[actor] = std::min(bet, stack[actor]);
+    } else if (c == 'r') {
+      int64_t raise_to = 0;
+      for (; q != betting_end && *q >= '0' && *q <= '9'; q++) {
+        raise_to = std::min<int64_t>(raise_to * 10 + (*q - '0'), INT32_MAX);
+      }
+      if (raise_to <= bet) {
+        Malformed(line);
+      }
+      if (raise_to > stack[actor]) {
+        StakeMismatch(line, raise_to, stack[actor]);
+      }
+      action = raise_to == stack[actor] ? PlayerAction::RAISE_ALL_IN
+                                        : PlayerAction::RAISE;
+      committed[actor] = static_cast<int32_t>(raise_to);
+      bet = committed[actor];
+    } else {
+      Malformed(line);
+    }
+    if (committed[actor] == stack[actor]) {
+      inactive |= 1u << actor;
+    }
+    if (hand->actions.size() == Table::ActionLog::capacity()) {
+      Malformed(line);
+    }
+    hand->actions.push_back({static_cast<int8_t>(round),
+                             static_cast<int8_t>(Seat(actor)), action,
+                             committed[actor] - round_start[actor]});
+    actor = actor + 1 == players_ ? 0 : actor + 1;
+  }
+  return true;
+}
+
+std::string FormatAcpcHand(const HandRecord& hand, int players,
+                           const Stakes& stakes, uint64_t hand_number) {
+  static constexpr char kRanks[] = "23456789TJQKA";
+  static constexpr char kSuits[] = "schd";
+  auto card = [](std::string& out, int index) {
+    out += kRanks[index % kRankCount];
+    out += kSuits[index / kRankCount];
+  };
+  // Game's seat of each ACPC seat
+  auto seat = [&](int acpc_seat) {
+    return (hand.button - 1 - acpc_seat + 2 * players) % players;
+  };
+
+  std::string line = "STATE:" + std::to_string(hand_number) + ":";
+  // Chips each seat had put in the hand by the start of the round, and the
+  // hand's highest total bet
+  std::array<int32_t, kMaxPlayers> round_start{};
+  std::array<int32_t, kMaxPlayers> committed{};
+  const int small_blind = players == 2 ? 1 : 0;
+  committed[seat(small_blind)] =
+      std::min(stakes.small_blind, stakes.StackAt(seat(small_blind)));
+  committed[seat(small_blind ^ 1)] =
+      std::min(stakes.big_blind, stakes.StackAt(seat(small_blind ^ 1)));
+  int32_t bet = stakes.big_blind;
+  // Rounds played: preflop, and one more per street dealt
+  const int rounds = hand.board.empty() ? 1 : hand.board.size() - 1;
+  size_t next = 0;
+  for (int round = 0; round < rounds; round++) {
+    if (round > 0) {
+      line += '/';
+      round_start = committed;
+    }
+    for (; next < hand.actions.size() && hand.actions[next].round == round;
+         next++) {
+      const ActionLogEntry& entry = hand.actions[next];
+      int32_t total = round_start[entry.position] + entry.amount;
+      committed[entry.position] = total;
+      if (entry.action == PlayerAction::FOLD) {
+        line += 'f';
+      } else if (total > bet) {
+        line += 'r';
+        line += std::to_string(total);
+        bet = total;
+      } else {
+        line += 'c';
+      }
+    }
+  }
+  line += ':';
+  for (int s = 0; s < players; s++) {
+    if (s > 0) {
+      line += '|';
+    }
+    for (int c = 0; c < kHoleCards; c++) {
+      card(line, hand.hole[seat(s) * kHoleCards + c]);
+    }
+  }
+  static constexpr size_t kRoundBoardEnd[] = {3, 4, 5};
+  size_t b = 0;
+  for (size_t end : kRoundBoardEnd) {
+    if (b == hand.board.size()) {
+      break;
+    }
+    line += '/';
+    for (; b < end; b++) {
+      card(line, hand.board[b]);
+    }
+  }
+  line += "::";
+  return line;
+}
+
+int AcpcPlayerCount(std::string_view text) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    std::string_view line = text.substr(
+        pos, eol == std::string_view::npos ? std::string_view::npos
+                                           : eol - pos);
+    if (line.substr(0, kStatePrefix.size()) == kStatePrefix) {
+      // The cards are the fourth field
+      size_t cards = 0;
+      for (int i = 0; i < 3 && cards != std::string_view::npos; i++) {
+        cards = line.find(':', cards + (i > 0));
+      }
+      if (cards == std::string_view::npos) {
+        return 0;
+      }
+      size_t cards_end = line.find_first_of("/:", cards + 1);
+      std::string_view hole = line.substr(cards + 1, cards_end - cards - 1);
+      return std::count(hole.begin(), hole.end(), '|') + 1;
+    }
+    if (eol == std::string_view::npos) {
+      break;
+    }
+    pos = eol + 1;
+  }
+  return 0;
+}
+
+std::vector<std::string_view> SplitAtLines(std::string_view text,
+                                           size_t chunk_size) {
+  std::vector<std::string_view> chunks;
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = begin + chunk_size;
+    if (end >= text.size()) {
+      end = text.size();
+    } else {
+      size_t eol = text.find('\n', end);
+      end = eol == std::string_view::npos ? text.size() : eol + 1;
+    }
+    chunks.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+  return chunks;
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,100 @@
+#ifndef HAND_IMPORT_H
+#define HAND_IMPORT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hand_history.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// Parses no-limit hold'em hands in the ACPC log format, one hand per line,
+// which unlike casino hand histories has every player's hole cards:
+//
+//   STATE:<hand>:<betting>:<cards>:<results>:<players>
+//
+// e.g. "STATE:7:r300c/cr900f:9hQc|5dQd/8dAs8s:-300|300:Alice|Bob".  Betting
+// rounds are separated by '/', and each action is 'f' (fold), 'c' (check or
+// call) or 'r' followed by the player's total bet in the hand after the raise.
+// Cards are the hole cards of each seat separated by '|', then '/' and the
+// community cards dealt in each round.  Other lines (comments, SCORE lines)
+// aren't hands.
+//
+// ACPC seat 0 is the first to act after the flop, so the seats come out in
+// Game's order reversed with the button at seat 0 (see HandReplay).  Parse()
+// only touches each byte once and doesn't allocate, so it runs at several
+// hundred megabytes per second on one core.
+class AcpcHandParser {
+public:
+  AcpcHandParser(int players, const Stakes& stakes);
+
+  // Parses line (without its newline) into hand.  Returns false if line
+  // isn't a hand, and throws std::invalid_argument if it's a malformed one,
+  // one for a different number of players, or one that raises past the
+  // stakes' stacks (played with other stakes).
+  bool Parse(std::string_view line, HandRecord* hand);
+
+private:
+  // Seat of ACPC seat, as HandReplay numbers them
+  int Seat(int acpc_seat) const { return players_ - 1 - acpc_seat; }
+
+  int players_;
+  Stakes stakes_;
+};
+
+// Stakes of the ACPC competition's no-limit logs: 50/100 blinds and 20000
+// chip stacks.
+inline Stakes AcpcStakes() {
+  Stakes stakes;
+  stakes.small_blind = 50;
+  stakes.big_blind = 100;
+  stakes.stack = 20000;
+  return stakes;
+}
+
+// Formats hand, dealt to players with stakes, as an ACPC log line (without a
+// newline) numbered hand_number: the inverse of AcpcHandParser::Parse(), up
+// to the seats being renumbered from the button.  The results and player
+// names are left blank.
+std::string FormatAcpcHand(const HandRecord& hand, int players,
+                           const Stakes& stakes, uint64_t hand_number);
+
+// Returns the number of players in the first hand of text, or 0 if there is
+// none.
+int AcpcPlayerCount(std::string_view text);
+
+// Splits text into consecutive chunks of about chunk_size bytes that each end
+// at the end of a line, so the chunks can be parsed independently.
+std::vector<std::string_view> SplitAtLines(std::string_view text,
+                                           size_t chunk_size);
+
+// Parses every hand of text with parser and replays it into stats (see
+// ReplayHand()).  Returns the number of hands.
+template <typename STATS>
+uint64_t ImportAcpcHands(std::string_view text, AcpcHandParser& parser,
+                         HandReplay& replay, STATS& stats) {
+  HandRecord hand;
+  uint64_t hands = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    if (parser.Parse(text.substr(pos, eol - pos), &hand)) {
+      ReplayHand(hand, replay, stats);
+      hands++;
+    }
+    pos = eol + 1;
+  }
+  return hands;
+}
+
+} // namespace poker::holdem
+
+#endif // HAND_IMPORT_H
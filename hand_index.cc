@@ -0,0 +1,335 @@
+#include "hand_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <stdexcept>
+
+namespace poker {
+
+namespace {
+
+uint64_t Choose(uint64_t n, int k) {
+  if (k < 0 || n < static_cast<uint64_t>(k)) {
+    return 0;
+  }
+  uint64_t result = 1;
+  for (int i = 0; i < k; i++) {
+    result = result * (n - i) / (i + 1);
+  }
+  return result;
+}
+
+int ShapeCount(uint32_t shape, int round, int rounds) {
+  return (shape >> (4 * (rounds - 1 - round))) & 0xF;
+}
+
+// Colexicographic index of a set of ranks (bits 0..12) within the free ranks
+uint64_t RankSetIndex(uint32_t ranks, uint32_t free) {
+  uint64_t index = 0;
+  int i = 1;
+  for (; ranks != 0; ranks &= ranks - 1, i++) {
+    int rank = __builtin_ctz(ranks);
+    // Position of rank among the free ranks
+    int position = __builtin_popcount(free & ((1u << rank) - 1));
+    index += Choose(position, i);
+  }
+  return index;
+}
+
+uint32_t RankSetUnindex(uint64_t index, int count, uint32_t free) {
+  uint32_t ranks = 0;
+  int positions = __builtin_popcount(free);
+  for (int i = count; i > 0; i--) {
+    int position = positions - 1;
+    while (Choose(position, i) > index) {
+      position--;
+    }
+    index -= Choose(position, i);
+    positions = position;
+    // The position-th free rank
+    uint32_t bits = free;
+    for (int p = 0; p < position; p++) {
+      bits &= bits - 1;
+    }
+    ranks |= bits & -bits;
+  }
+  return ranks;
+}
+
+// Index of the multiset of values (sorted from the highest) each below n
+uint64_t MultisetIndex(const uint64_t* values, int count) {
+  uint64_t index = 0;
+  for (int i = 0; i < count; i++) {
+    index += Choose(values[i] + (count - 1 - i), count - i);
+  }
+  return index;
+}
+
+void MultisetUnindex(uint64_t index, int count, uint64_t n, uint64_t* values) {
+  uint64_t high = n + count - 1;
+  for (int i = 0; i < count; i++) {
+    int k = count - i;
+    // Largest b with Choose(b, k) <= index
+    uint64_t low = k - 1;
+    while (low + 1 < high) {
+      uint64_t mid = low + (high - low) / 2;
+      if (Choose(mid, k) <= index) {
+        low = mid;
+      } else {
+        high = mid;
+      }
+    }
+    index -= Choose(low, k);
+    values[i] = low - (k - 1);
+    high = low;
+  }
+}
+
+} // namespace
+
+HandIndexer::HandIndexer(std::vector<int> cards_per_round)
+  : cards_per_round_(std::move(cards_per_round)) {
+  int total = 0;
+  for (int cards : cards_per_round_) {
+    if (cards < 0 || cards > kRankCount) {
+      throw std::invalid_argument("Too many cards in a round");
+    }
+    total += cards;
+  }
+  if (cards_per_round_.empty() || cards_per_round_.size() > kMaxIndexRounds ||
+      total > kCardCount) {
+    throw std::invalid_argument("Unsupported rounds for a hand indexer");
+  }
+
+  // Every way of dealing each round's cards to the suits, with suit shapes
+  // sorted so each arrangement appears once.
+  std::array<uint32_t, kSuitCount> shapes{};
+  std::array<int, kSuitCount> suit_total{};
+  const int rounds = cards_per_round_.size();
+  std::function<void(int, int, int)> deal = [&](int round, int suit,
+                                                int left) {
+    if (suit == kSuitCount - 1) {
+      if (suit_total[suit] + left > kRankCount) {
+        return;
+      }
+      shapes[suit] = (shapes[suit] << 4) | left;
+      suit_total[suit] += left;
+      if (round + 1 < rounds) {
+        deal(round + 1, 0, cards_per_round_[round + 1]);
+      } else {
+        std::array<uint32_t, kSuitCount> sorted = shapes;
+        std::sort(sorted.begin(), sorted.end(), std::greater<uint32_t>());
+        uint64_t key = BlockKey(sorted);
+        if (block_by_key_.count(key) == 0) {
+          block_by_key_[key] = blocks_.size();
+          blocks_.push_back(Block{sorted, 0, 0});
+        }
+      }
+      suit_total[suit] -= left;
+      shapes[suit] >>= 4;
+      return;
+    }
+    for (int count = 0; count <= left; count++) {
+      if (suit_total[suit] + count > kRankCount) {
+        break;
+      }
+      shapes[suit] = (shapes[suit] << 4) | count;
+      suit_total[suit] += count;
+      deal(round, suit + 1, left - count);
+      suit_total[suit] -= count;
+      shapes[suit] >>= 4;
+    }
+  };
+  deal(0, 0, cards_per_round_[0]);
+
+  // Blocks in descending order of shapes, so Decode() can binary search
+  std::sort(blocks_.begin(), blocks_.end(),
+            [](const Block& lhs, const Block& rhs) {
+              return lhs.shapes > rhs.shapes;
+            });
+  for (size_t b = 0; b < blocks_.size(); b++) {
+    Block& block = blocks_[b];
+    block_by_key_[BlockKey(block.shapes)] = b;
+    block.offset = size_;
+    block.size = 1;
+    for (int i = 0; i < kSuitCount;) {
+      int j = i;
+      while (j < kSuitCount && block.shapes[j] == block.shapes[i]) {
+        j++;
+      }
+      block.size *= Choose(ShapeSize(block.shapes[i]) + (j - i) - 1, j - i);
+      i = j;
+    }
+    size_ += block.size;
+  }
+}
+
+uint64_t HandIndexer::BlockKey(const std::array<uint32_t, kSuitCount>& shapes) {
+  uint64_t key = 0;
+  for (uint32_t shape : shapes) {
+    key = (key << 16) | shape;
+  }
+  return key;
+}
+
+uint64_t HandIndexer::ShapeSize(uint32_t shape) const {
+  uint64_t size = 1;
+  int free = kRankCount;
+  for (int r = 0; r < rounds(); r++) {
+    int count = ShapeCount(shape, r, rounds());
+    size *= Choose(free, count);
+    free -= count;
+  }
+  return size;
+}
+
+uint64_t HandIndexer::SuitRanksIndex(uint32_t shape,
+                                     const uint32_t* ranks) const {
+  uint64_t index = 0;
+  uint64_t scale = 1;
+  uint32_t free = (1u << kRankCount) - 1;
+  for (int r = 0; r < rounds(); r++) {
+    int count = ShapeCount(shape, r, rounds());
+    index += scale * RankSetIndex(ranks[r], free);
+    scale *= Choose(__builtin_popcount(free), count);
+    free &= ~ranks[r];
+  }
+  return index;
+}
+
+void HandIndexer::SuitRanksUnindex(uint32_t shape, uint64_t index,
+                                   uint32_t* ranks) const {
+  uint32_t free = (1u << kRankCount) - 1;
+  for (int r = 0; r < rounds(); r++) {
+    int count = ShapeCount(shape, r, rounds());
+    uint64_t size = Choose(__builtin_popcount(free), count);
+    ranks[r] = RankSetUnindex(index % size, count, free);
+    index /= size;
+    free &= ~ranks[r];
+  }
+}
+
+uint64_t HandIndexer::Index(const uint64_t* rounds_cards) const {
+  Suits suits;
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    std::array<uint32_t, kMaxIndexRounds> ranks;
+    uint32_t shape = 0;
+    for (int r = 0; r < rounds(); r++) {
+      // Rank bits 2..14 of the suit's lane down to 0..12
+      ranks[r] = SuitRanks(rounds_cards[r], suit) >> 2;
+      shape = (shape << 4) | __builtin_popcount(ranks[r]);
+    }
+    suits[suit] = SuitCards{shape, SuitRanksIndex(shape, ranks.data())};
+  }
+  std::sort(suits.begin(), suits.end(),
+            [](const SuitCards& lhs, const SuitCards& rhs) {
+              return lhs.shape != rhs.shape ? lhs.shape > rhs.shape
+                                            : lhs.ranks > rhs.ranks;
+            });
+
+  std::array<uint32_t, kSuitCount> shapes;
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    shapes[suit] = suits[suit].shape;
+  }
+  auto it = block_by_key_.find(BlockKey(shapes));
+  if (it == block_by_key_.end()) {
+    throw std::invalid_argument("Hand doesn't match the indexer's rounds");
+  }
+  const Block& block = blocks_[it->second];
+
+  // Mixed radix over the groups of suits of equal shape
+  uint64_t index = 0;
+  for (int i = 0; i < kSuitCount;) {
+    int j = i;
+    std::array<uint64_t, kSuitCount> values;
+    while (j < kSuitCount && suits[j].shape == suits[i].shape) {
+      values[j - i] = suits[j].ranks;
+      j++;
+    }
+    uint64_t group_size =
+        Choose(ShapeSize(suits[i].shape) + (j - i) - 1, j - i);
+    index = index * group_size + MultisetIndex(values.data(), j - i);
+    i = j;
+  }
+  return block.offset + index;
+}
+
+void HandIndexer::Decode(uint64_t index, Suits* suits) const {
+  if (index >= size_) {
+    throw std::out_of_range("Hand index out of range");
+  }
+  auto block = std::upper_bound(
+      blocks_.begin(), blocks_.end(), index,
+      [](uint64_t index, const Block& block) { return index < block.offset; });
+  --block;
+  index -= block->offset;
+
+  // Groups were combined first to last, so come apart last to first
+  for (int j = kSuitCount; j > 0;) {
+    int i = j - 1;
+    while (i > 0 && block->shapes[i - 1] == block->shapes[j - 1]) {
+      i--;
+    }
+    uint64_t shape_size = ShapeSize(block->shapes[i]);
+    uint64_t group_size = Choose(shape_size + (j - i) - 1, j - i);
+    std::array<uint64_t, kSuitCount> values;
+    MultisetUnindex(index % group_size, j - i, shape_size, values.data());
+    index /= group_size;
+    for (int k = i; k < j; k++) {
+      (*suits)[k] = SuitCards{block->shapes[k], values[k - i]};
+    }
+    j = i;
+  }
+}
+
+void HandIndexer::Unindex(uint64_t index, uint64_t* rounds_cards) const {
+  Suits suits;
+  Decode(index, &suits);
+  for (int r = 0; r < rounds(); r++) {
+    rounds_cards[r] = 0;
+  }
+  for (int suit = 0; suit < kSuitCount; suit++) {
+    std::array<uint32_t, kMaxIndexRounds> ranks;
+    SuitRanksUnindex(suits[suit].shape, suits[suit].ranks, ranks.data());
+    for (int r = 0; r < rounds(); r++) {
+      rounds_cards[r] |= static_cast<uint64_t>(ranks[r]) << (suit * 16 + 2);
+    }
+  }
+}
+
+int HandIndexer::Weight(uint64_t index) const {
+  Suits suits;
+  Decode(index, &suits);
+  // 4! relabellings, less those that swap identical suits
+  int weight = 24;
+  for (int i = 0; i < kSuitCount;) {
+    int j = i;
+    while (j < kSuitCount && suits[j].shape == suits[i].shape &&
+           suits[j].ranks == suits[i].ranks) {
+      j++;
+    }
+    for (int n = 2; n <= j - i; n++) {
+      weight /= n;
+    }
+    i = j;
+  }
+  return weight;
+}
+
+namespace holdem {
+
+const HandIndexer& StreetIndexer(Round round) {
+  static const HandIndexer* const kIndexers[] = {
+    new HandIndexer({kHoleCards}),
+    new HandIndexer({kHoleCards, 3}),
+    new HandIndexer({kHoleCards, 4}),
+    new HandIndexer({kHoleCards, kMaxCommunityCards}),
+  };
+  assert(round < Round::COUNT);
+  return *kIndexers[static_cast<int>(round)];
+}
+
+} // namespace holdem
+
+} // namespace poker
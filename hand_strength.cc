@@ -0,0 +1,142 @@
+#include "hand_strength.h"
+
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+#include "card_mask.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+namespace {
+
+enum Standing { kAhead, kTied, kBehind, kStandingMax };
+
+Standing Compare(int32_t ours, int32_t theirs) {
+  return ours > theirs ? kAhead : ours == theirs ? kTied : kBehind;
+}
+
+// Packs the cards of the canonical (hole, board) into a key of 6 bits per
+// card: the hole cards then the board cards, each as its mask bit number.  No
+// valid key is zero.
+uint64_t CanonicalKey(uint64_t hole, uint64_t board) {
+  CanonicalizeSuits(&hole, &board);
+  uint64_t key = 0;
+  for (uint64_t cards : {hole, board}) {
+    for (; cards != 0; cards &= cards - 1) {
+      key = (key << 6) | __builtin_ctzll(cards);
+    }
+  }
+  return key;
+}
+
+uint16_t ToFixed(float p) {
+  return static_cast<uint16_t>(std::lround(p * 65535.0f));
+}
+
+float FromFixed(uint16_t p) {
+  return p / 65535.0f;
+}
+
+} // namespace
+
+double HandStrength::Effective(int opponents) const {
+  double strength_all = std::pow(static_cast<double>(strength), opponents);
+  return strength_all * (1.0 - negative_potential) +
+         (1.0 - strength_all) * positive_potential;
+}
+
+HandStrength ComputeHandStrength(uint64_t hole, uint64_t board) {
+  const int board_cards = __builtin_popcountll(board);
+  if (__builtin_popcountll(hole) != 2 || board_cards < 3 || board_cards > 5 ||
+      (hole & board) != 0 || ((hole | board) & ~kFullDeckMask) != 0) {
+    throw std::invalid_argument(
+        "Hand strength needs two hole cards and a board of three to five");
+  }
+
+  std::array<uint64_t, kCardCount> unseen;
+  int count = 0;
+  for (uint64_t cards = kFullDeckMask & ~(hole | board); cards != 0;
+       cards &= cards - 1) {
+    unseen[count++] = cards & -cards;
+  }
+
+  const bool river = board_cards == kMaxCommunityCards;
+  const int32_t ours = EvaluateCardMask(board | hole);
+  std::array<int32_t, kCardCount> ours_next;
+  if (!river) {
+    for (int k = 0; k < count; k++) {
+      ours_next[k] = EvaluateCardMask(board | unseen[k] | hole);
+    }
+  }
+
+  // now[s] counts opponent hands by standing; next[s][t] counts (opponent
+  // hand, next card) pairs that go from standing s to t.
+  std::array<uint32_t, kStandingMax> now{};
+  std::array<std::array<uint32_t, kStandingMax>, kStandingMax> next{};
+  for (int i = 0; i < count; i++) {
+    for (int j = i + 1; j < count; j++) {
+      uint64_t theirs_hole = unseen[i] | unseen[j];
+      Standing standing = Compare(ours, EvaluateCardMask(board | theirs_hole));
+      now[standing]++;
+      if (river) {
+        continue;
+      }
+      for (int k = 0; k < count; k++) {
+        if (k == i || k == j) {
+          continue;
+        }
+        int32_t theirs = EvaluateCardMask(board | unseen[k] | theirs_hole);
+        next[standing][Compare(ours_next[k], theirs)]++;
+      }
+    }
+  }
+
+  HandStrength result{};
+  double hands = now[kAhead] + now[kTied] + now[kBehind];
+  result.strength = static_cast<float>((now[kAhead] + now[kTied] / 2.0) /
+                                       hands);
+  if (!river) {
+    // Every opponent hand sees the same number of next cards
+    double cards = count - 2;
+    double behind = (now[kBehind] + now[kTied] / 2.0) * cards;
+    double ahead = (now[kAhead] + now[kTied] / 2.0) * cards;
+    if (behind > 0) {
+      result.positive_potential = static_cast<float>(
+          (next[kBehind][kAhead] + next[kBehind][kTied] / 2.0 +
+           next[kTied][kAhead] / 2.0) / behind);
+    }
+    if (ahead > 0) {
+      result.negative_potential = static_cast<float>(
+          (next[kAhead][kBehind] + next[kTied][kBehind] / 2.0 +
+           next[kAhead][kTied] / 2.0) / ahead);
+    }
+  }
+  return result;
+}
+
+HandStrengthCache::HandStrengthCache(int log2_size)
+  : shift_(64 - log2_size), entries_(size_t{1} << log2_size) {}
+
+HandStrength HandStrengthCache::Get(uint64_t hole, uint64_t board) {
+  uint64_t key = CanonicalKey(hole, board);
+  Entry& entry = entries_[(key * 0x9E3779B97F4A7C15ull) >> shift_];
+  if (entry.key == key) {
+    hits_++;
+    return HandStrength{FromFixed(entry.strength),
+                        FromFixed(entry.positive_potential),
+                        FromFixed(entry.negative_potential)};
+  }
+  misses_++;
+  HandStrength result = ComputeHandStrength(hole, board);
+  entry = Entry{key, ToFixed(result.strength),
+                ToFixed(result.positive_potential),
+                ToFixed(result.negative_potential)};
+  // Answer from the entry so a spot reads the same whether it hit or missed
+  return HandStrength{FromFixed(entry.strength),
+                      FromFixed(entry.positive_potential),
+                      FromFixed(entry.negative_potential)};
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,68 @@
+#ifndef HAND_STRENGTH_H
+#define HAND_STRENGTH_H
+
+#include <cstdint>
+#include <vector>
+
+namespace poker::holdem {
+
+// Hand strength and potential of two hole cards on a flop, turn or river
+// board, against a single opponent holding any two of the unseen cards:
+//
+//  strength           - chance of being ahead now, ties counting half (HS)
+//  positive_potential - chance that a hand behind now is ahead after the next
+//                       card (PPot)
+//  negative_potential - chance that a hand ahead now is behind after the next
+//                       card (NPot)
+//
+// Potentials look one card ahead and are zero on the river.
+struct HandStrength {
+  float strength;
+  float positive_potential;
+  float negative_potential;
+
+  // Effective hand strength (EHS) against opponents random hands, taking
+  // the chance of being ahead of all of them as strength^opponents.
+  double Effective(int opponents = 1) const;
+};
+
+// Computes the hand strength of hole on board (card masks, see card_mask.h)
+// by enumerating every opponent hand and next card.  The board is shared by
+// both hands, so the player's own strength is evaluated once per next card
+// rather than once per opponent hand.  About 50,000 evaluations on the flop
+// or turn and 1,000 on the river.  Throws std::invalid_argument unless hole
+// is two cards and board three to five others.
+HandStrength ComputeHandStrength(uint64_t hole, uint64_t board);
+
+// Direct-mapped cache of ComputeHandStrength() results keyed by the suit
+// canonical form of (hole, board) (see CanonicalizeSuits()), so the up to 24
+// suit permutations of a spot share one entry.  A new result replaces
+// whatever was in its slot.  Not thread safe; use one cache per thread.
+class HandStrengthCache {
+public:
+  // Holds up to 1 << log2_size results, 16 bytes each.
+  explicit HandStrengthCache(int log2_size = 20);
+
+  HandStrength Get(uint64_t hole, uint64_t board);
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+private:
+  struct Entry {
+    uint64_t key;
+    // Fixed point in units of 1/65535
+    uint16_t strength;
+    uint16_t positive_potential;
+    uint16_t negative_potential;
+  };
+
+  int shift_;
+  std::vector<Entry> entries_;
+  uint64_t hits_{};
+  uint64_t misses_{};
+};
+
+} // namespace poker::holdem
+
+#endif // HAND_STRENGTH_H
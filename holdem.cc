@@ -1,5 +1,13 @@
 #include "holdem.h"
 
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "card_mask.h"
 #include "cards.pb.h"
 #include "poker.h"
 
@@ -7,22 +15,27 @@ namespace poker::holdem {
 
 Hand HoleHand(const std::vector<Card>& cards) {
   Hand hand;
+  HoleHand(cards.data(), &hand);
+  return hand;
+}
+
+void HoleHand(const Card* cards, Hand* hand) {
+  hand->clear_rank();
   if (cards[0].rank() == cards[1].rank()) {
-    hand.set_type(HandType::ONE_PAIR);
+    hand->set_type(HandType::ONE_PAIR);
   } else if (cards[0].suit() == cards[1].suit()) {
-    hand.set_type(HandType::FLUSH);
+    hand->set_type(HandType::FLUSH);
   } else {
-    hand.set_type(HandType::HIGH_CARD);
+    hand->set_type(HandType::HIGH_CARD);
   }
   if (cards[0].rank() > cards[1].rank()) {
-    hand.add_rank(cards[0].rank());
-    hand.add_rank(cards[1].rank());
+    hand->add_rank(cards[0].rank());
+    hand->add_rank(cards[1].rank());
   } else {
-    hand.add_rank(cards[1].rank());
-    hand.add_rank(cards[0].rank());
+    hand->add_rank(cards[1].rank());
+    hand->add_rank(cards[0].rank());
   }
-  hand.set_sort_code(HandToSortCode(hand));
-  return hand;
+  hand->set_sort_code(HandToSortCode(*hand));
 }
 
 Hand HoleHand(Rank rank1, Rank rank2, HandType hand_type) {
@@ -39,4 +52,126 @@ Hand HoleHand(Rank rank1, Rank rank2, HandType hand_type) {
   return hand;
 }
 
+namespace {
+
+std::array<uint8_t, kCardCount * kCardCount> BuildHoleHandIndexTable() {
+  // Offset of the first hand (the pair) for each high rank
+  int first[kRankCount] = {};
+  int offset = 0;
+  for (int high = kRankCount - 1; high >= 0; high--) {
+    first[high] = offset;
+    offset += 1 + 2 * high;
+  }
+  std::array<uint8_t, kCardCount * kCardCount> table{};
+  for (int card1 = 0; card1 < kCardCount; card1++) {
+    for (int card2 = 0; card2 < kCardCount; card2++) {
+      int rank1 = card1 % kRankCount;
+      int rank2 = card2 % kRankCount;
+      int high = std::max(rank1, rank2);
+      int low = std::min(rank1, rank2);
+      int index = first[high];
+      if (high != low) {
+        bool suited = card1 / kRankCount == card2 / kRankCount;
+        index += 1 + 2 * (high - 1 - low) + (suited ? 0 : 1);
+      }
+      table[card1 * kCardCount + card2] = static_cast<uint8_t>(index);
+    }
+  }
+  return table;
+}
+
+} // namespace
+
+int HoleHandIndex(int card1, int card2) {
+  static const std::array<uint8_t, kCardCount * kCardCount> table =
+      BuildHoleHandIndexTable();
+  return table[card1 * kCardCount + card2];
+}
+
+void SplitPot(int seats, int button, const int32_t* total_bet,
+              const int32_t* strength, int32_t* winnings) {
+  int top = 0;
+  for (int i = 0; i < seats; i++) {
+    if (strength[i] != kFolded) {
+      top = std::max(top, total_bet[i]);
+    }
+  }
+  for (int level = 0; level < top;) {
+    int next = top;
+    for (int i = 0; i < seats; i++) {
+      if (strength[i] != kFolded && total_bet[i] > level) {
+        next = std::min(next, total_bet[i]);
+      }
+    }
+    int pot = 0;
+    int32_t best = kFolded;
+    int winners = 0;
+    for (int i = 0; i < seats; i++) {
+      // The top pot also takes any folded chips above it
+      pot += std::clamp(total_bet[i] - level, 0,
+                        next == top ? INT_MAX : next - level);
+      if (strength[i] != kFolded && total_bet[i] >= next) {
+        if (strength[i] > best) {
+          best = strength[i];
+          winners = 1;
+        } else if (strength[i] == best) {
+          winners++;
+        }
+      }
+    }
+    int share = pot / winners;
+    int odd = pot % winners;
+    for (int i = 0, position = (button + seats - 1) % seats; i < seats;
+         i++, position = (position + seats - 1) % seats) {
+      if (strength[position] == best && total_bet[position] >= next) {
+        winnings[position] += share + (odd-- > 0 ? 1 : 0);
+      }
+    }
+    level = next;
+  }
+}
+
+void PlayerModel::ActMany(const DecisionView& view, PlayerAction* actions) {
+  Table table;
+  std::vector<Player> seats;
+  for (int i = 0; i < view.count; i++) {
+    // Seat the decision at its distance after a button at seat 0
+    int players = view.players[i];
+    int position = (players - view.position[i]) % players;
+    if (seats.size() != static_cast<size_t>(players)) {
+      seats.resize(players);
+      table.set_players(seats);
+    }
+    table.set_button(0);
+    const Stakes& stakes = table.stakes();
+    int blind = view.round == Round::PREFLOP ? stakes.big_blind : 0;
+    table.set_bet(blind + view.raises[i] * stakes.big_blind, stakes.big_blind);
+    table.clear_community_cards();
+    for (uint64_t board = view.board[i]; board != 0; board &= board - 1) {
+      table.add_community_card(CardMaskBitToCard(__builtin_ctzll(board)));
+    }
+    Player& player = seats[position];
+    player.reset(stakes.stack);
+    for (uint64_t hole = view.hole[i]; hole != 0; hole &= hole - 1) {
+      player.add_card(CardMaskBitToCard(__builtin_ctzll(hole)));
+    }
+    actions[i] = Act(table, view.round, position, player);
+  }
+}
+
+std::vector<std::string> PhaseNames() {
+  constexpr const char* const kRoundPhase[] = { "deal", "betting", "collect" };
+  std::vector<std::string> names(kPhaseMax);
+  names[kPhaseNewGame] = "new-game";
+  names[kPhaseShowdown] = "showdown";
+  for (int r = kRoundPreflop; r < kRoundMax; r++) {
+    for (int p = 0; p < kRoundPhaseMax; p++) {
+      std::string name(kRound[r]);
+      name.append("-").append(kRoundPhase[p]);
+      names[RoundPhase(static_cast<Round>(r), p)] = name;
+    }
+  }
+  return names;
+}
+
 } // namespace poker::holdem
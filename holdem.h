@@ -1,16 +1,26 @@
 #ifndef HOLDEM_H
 #define HOLDEM_H
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <climits>
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <utility>
 
+#include "card_mask.h"
 #include "cards.h"
+#include "perf_counters.h"
 #include "player_model.h"
 #include "poker.h"
+#include "sorting_network.h"
 
 namespace poker::holdem {
 
@@ -30,16 +40,158 @@ constexpr int kRoundRiver = static_cast<int>(Round::RIVER);
 constexpr int kRoundMax = static_cast<int>(Round::COUNT);
 constexpr const char* const kRound[] = { "preflop", "flop", "turn", "river" };
 
+// Phases of Game::Play() reported by --perf-counters-phases.  Phase 0 is
+// NewGame(), followed by deal, betting and collect for each round, and last
+// awarding the pot.
+constexpr int kPhaseNewGame = 0;
+constexpr int kRoundPhaseDeal = 0;
+constexpr int kRoundPhaseBetting = 1;
+constexpr int kRoundPhaseCollect = 2;
+constexpr int kRoundPhaseMax = 3;
+constexpr int kPhaseShowdown = 1 + kRoundMax * kRoundPhaseMax;
+constexpr int kPhaseMax = kPhaseShowdown + 1;
+
+inline int RoundPhase(Round round, int phase) {
+  return 1 + static_cast<int>(round) * kRoundPhaseMax + phase;
+}
+
+std::vector<std::string> PhaseNames();
+
+// Hole cards dealt to each player in hold'em
+constexpr int kHoleCards = 2;
+
+// Hand strength (sort code) of a folded player for SplitPot()
+constexpr int32_t kFolded = -1;
+
+// Splits the chips every seat put in the pot (total_bet) between the players
+// still in the hand (strength other than kFolded), adding each one's share to
+// winnings.  Each distinct total bet of a live player caps a side pot,
+// contested by the live players who put in at least that much; uncalled
+// chips come back as a pot with a single player.  Odd chips go to the
+// winners closest to the button's left.
+void SplitPot(int seats, int button, const int32_t* total_bet,
+              const int32_t* strength, int32_t* winnings);
+
+// The players of a showdown ranked by hand strength (see RankShowdown()).
+struct ShowdownRanking {
+  // Seats still in the hand, strongest first and equal strengths by seat
+  std::array<uint8_t, kMaxPlayers> seat;
+  // Groups of equal strength: group g is seat[group_start[g]] up to
+  // seat[group_start[g + 1]], so group 0 won the pot (or split it if it has
+  // more than one seat) and every seat beat the seats of the groups after it
+  std::array<uint8_t, kMaxPlayers + 1> group_start;
+  int groups;
+  // Seats still in the hand, group_start[groups]
+  int live;
+};
+
+// Ranks the seats of a showdown by strength (higher is better, kFolded for a
+// seat out of the hand) into groups of tied players, sorting the seats with
+// a sorting network of size SEATS.
+template <size_t SEATS>
+ShowdownRanking RankShowdown(const std::array<int32_t, SEATS>& strength) {
+  static_assert(SEATS <= kMaxPlayers, "Too many seats");
+  // Strength in the high bits and the complement of the seat in the low
+  // byte, so sorting in descending order puts ties in seat order
+  std::array<int64_t, SEATS> key;
+  for (size_t i = 0; i < SEATS; i++) {
+    key[i] = int64_t{strength[i]} * 256 + (255 - i);
+  }
+  NetworkSort(key, [](int64_t lhs, int64_t rhs) { return lhs > rhs; });
+
+  ShowdownRanking ranking;
+  ranking.groups = 0;
+  ranking.live = 0;
+  for (size_t k = 0; k < SEATS; k++) {
+    int seat = 255 - (key[k] & 255);
+    if (strength[seat] == kFolded) {
+      break;
+    }
+    if (k == 0 || strength[seat] != strength[ranking.seat[k - 1]]) {
+      ranking.group_start[ranking.groups++] = k;
+    }
+    ranking.seat[k] = seat;
+    ranking.live++;
+  }
+  ranking.group_start[ranking.groups] = ranking.live;
+  return ranking;
+}
+
+// Returns how many seats position is after the button (0 for the button,
+// 1 for the small blind, and so on), the seat order Game acts in.
+inline int PositionFromButton(int position, int button, int players) {
+  return (button - position + players) % players;
+}
+
+// Structure-of-arrays view of count decisions, possibly at many seats of
+// many tables, for PlayerModel::ActMany().  Element i of every array
+// describes decision i.
+struct DecisionView {
+  Round round;
+  int count;
+  // Players dealt in at the decision's table
+  const uint8_t* players;
+  // PositionFromButton() of the deciding seat
+  const uint8_t* position;
+  // Raises made so far in the round (the blinds don't count)
+  const uint8_t* raises;
+  // HoleHandIndex() of the seat's hole cards
+  const uint8_t* hole_hand;
+  // Hole cards and community cards as card masks (see card_mask.h)
+  const uint64_t* hole;
+  const uint64_t* board;
+};
+
 class PlayerModel {
  public:
   virtual ~PlayerModel() = default;
   virtual PlayerAction Act(const Table &table, Round round, int position,
                            Player &player) = 0;
+  // Decides every action of view into actions[0, view.count).  Models that
+  // only need what the view carries (e.g. chart lookups) should override
+  // this with a loop over the arrays.  The default adapter rebuilds a Table
+  // seating view.players players for each decision and calls Act() for the
+  // deciding one; the table only has the cards, the button, the stakes'
+  // default stacks and a bet of one big blind per raise, not the rest of the
+  // betting state.
+  virtual void ActMany(const DecisionView& view, PlayerAction* actions);
 };
 
 typedef std::vector<std::unique_ptr<poker::holdem::PlayerModel>>
     PlayerModelVector;
 
+// Player model policies for Game.  A policy decides the action of the player
+// at position with
+//
+//   PlayerAction Act(const Table& table, Round round, int position,
+//                    Player& player);
+//
+// PlayerModels calls a PlayerModel per seat through its vtable, so seats can
+// use different models.  SamePlayerModel<MODEL> plays every seat with a single
+// MODEL and calls MODEL::Act() directly, which lets the compiler inline it.
+class PlayerModels {
+ public:
+  PlayerModels(PlayerModelVector&& models) : models_(std::move(models)) {}
+  PlayerAction Act(const Table& table, Round round, int position,
+                   Player& player) {
+    return models_[position]->Act(table, round, position, player);
+  }
+ private:
+  PlayerModelVector models_;
+};
+
+template <typename MODEL>
+class SamePlayerModel {
+ public:
+  explicit SamePlayerModel(MODEL model = MODEL()) : model_(std::move(model)) {}
+  PlayerAction Act(const Table& table, Round round, int position,
+                   Player& player) {
+    return model_.MODEL::Act(table, round, position, player);
+  }
+ private:
+  MODEL model_;
+};
+
 inline std::ostream& operator<<(std::ostream& os, const Round& round) {
   switch (round) {
   case Round::PREFLOP:
@@ -61,80 +213,168 @@ inline std::ostream& operator<<(std::ostream& os, const Round& round) {
 }
 
 Hand HoleHand(const std::vector<Card>& cards);
+// Sets hand to the hole hand of the two cards, reusing its storage.
+void HoleHand(const Card* cards, Hand* hand);
 Hand HoleHand(Rank rank1, Rank rank2, HandType hand_type);
 
-template <typename RNG, typename STATS>
-class Game : public poker::Game<RNG> {
+constexpr int kHoleHandCount = 169;
+
+// Returns the index in [0, kHoleHandCount) of the hole hand made by two card
+// indices (see card_mask.h).  Hands are ordered by high rank from ace down,
+// each high rank listing its pair and then the suited and offsuit hands with
+// every lower rank (AA, AKs, AKo, AQs, ..., 22).  This is the same order as
+// Statistics uses for its hole hand counters.
+int HoleHandIndex(int card1, int card2);
+
+// Evaluates a showdown: constructed with the board's card mask once per
+// showdown, it returns each player's sort code under RANKING (see
+// EvaluateCardMask()) from their hole card mask.
+template <typename RANKING>
+class CardMaskShowdown {
+public:
+  explicit CardMaskShowdown(uint64_t board) : board_(board) {}
+  int32_t Evaluate(uint64_t hole) const {
+    return EvaluateCardMask<RANKING>(board_ | hole);
+  }
+
+private:
+  uint64_t board_;
+};
+
+// Game rules policy for Game and Statistics, fixed at compile time: the deck
+// and hand ranking, how many hole cards are dealt, whether raises are capped
+// at the size of the pot and how a showdown is evaluated (see
+// CardMaskShowdown).  kHoleHandCount is the number of distinct hole hands
+// (see HoleHand()) Statistics counts, or 0 for a game without hole hand
+// statistics.
+struct HoldemRules {
+  using Deck = ::Deck;
+  using Ranking = StandardRanking;
+  static constexpr int kHoleCards = holdem::kHoleCards;
+  static constexpr int kHoleHandCount = holdem::kHoleHandCount;
+  static constexpr bool kPotLimit = false;
+  using Showdown = CardMaskShowdown<Ranking>;
+};
+
+// Game statistics collector (STATS) that ignores everything, for timing the
+// engine alone and for tests that only look at the table.
+struct NullStatistics {
+  void NewGame(const Table&, std::vector<Player>&) {}
+  void Collect(Round) {}
+  void CollectUncontested(Round) {}
+};
+
+// Plays hands of no-limit hold'em at one table.  MODELS is the player model
+// policy (see PlayerModels) and RULES the game rules policy (see
+// HoldemRules), which can make the game another with the same betting
+// structure, such as pot-limit Omaha (see omaha.h).
+template <typename RNG, typename STATS, typename MODELS = PlayerModels,
+          typename RULES = HoldemRules>
+class Game : public poker::Game<RNG, typename RULES::Deck> {
 public:
-  using Base = poker::Game<RNG>;
-  using poker::Game<RNG>::deck;
-  using poker::Game<RNG>::table;
+  using Base = poker::Game<RNG, typename RULES::Deck>;
+  using Base::deck;
+  using Base::table;
 
-  Game(Table& table, std::vector<Player>& players,
-       poker::holdem::PlayerModelVector&& player_models, STATS& stats, RNG& rng)
+  Game(Table& table, std::vector<Player>& players, MODELS player_models,
+       STATS& stats, RNG& rng)
     : Base(table, players.size(), rng),
       players_(players),
       player_models_(std::move(player_models)),
       stats_(stats) {
-    std::vector<const Player*> table_players;
-    table_players.reserve(players.size());
-    for (const Player& player : players) {
-      table_players.push_back(&player);
-    }
-    table.set_players(table_players);
+    table.set_players(players);
   }
 
-  void Play() {
-    Round round;
-    NewGame();
-
-    round = Round::PREFLOP;
-    Deal(round);
-    BettingRound(round);
-    stats_.Collect(round);
-
-    round = Round::FLOP;
-    Deal(round);
-    BettingRound(round);
-    stats_.Collect(round);
+  // Charges each phase of Play() to profile (may be nullptr to disable).
+  void set_perf_profile(PerfProfile* profile) { perf_profile_ = profile; }
 
-    round = Round::TURN;
-    Deal(round);
-    BettingRound(round);
-    stats_.Collect(round);
-
-    round = Round::RIVER;
-    Deal(round);
-    BettingRound(round);
-    stats_.Collect(round);
+  void Play() {
+    Profile(kPhaseNewGame, [this] { NewGame(); });
+    for (Round round : {Round::PREFLOP, Round::FLOP, Round::TURN,
+                        Round::RIVER}) {
+      Profile(RoundPhase(round, kRoundPhaseDeal), [&] { Deal(round); });
+      Profile(RoundPhase(round, kRoundPhaseBetting),
+              [&] { BettingRound(round); });
+      // Once everyone else has folded the hand is over; nothing more is
+      // dealt or evaluated.
+      if (in_hand_ == 1) {
+        Profile(RoundPhase(round, kRoundPhaseCollect),
+                [&] { stats_.CollectUncontested(round); });
+        break;
+      }
+      Profile(RoundPhase(round, kRoundPhaseCollect),
+              [&] { stats_.Collect(round); });
+    }
+    Profile(kPhaseShowdown, [this] { AwardPot(); });
   }
 private:
   void NewGame();
   void Deal(Round round);
   void BettingRound(Round round);
+  void AwardPot();
+
+  // Moves up to chips from player's stack into the pot.
+  void Commit(Player& player, int chips);
+  void Call(Player& player);
+  // Raises the round's bet to raise_to (capped at the player's stack).
+  // Returns false, after calling instead, if that isn't a raise.
+  bool Raise(Player& player, int raise_to);
+
+  // Heads up the button posts the small blind.
+  int SmallBlindPosition() {
+    return players_.size() == 2
+        ? table().button() : Base::RotatePosition(table().button(), -1);
+  }
+  int BigBlindPosition() {
+    return Base::RotatePosition(SmallBlindPosition(), -1);
+  }
+
+  template <typename F>
+  void Profile(int phase, F&& f) {
+    if (perf_profile_ == nullptr) {
+      f();
+      return;
+    }
+    perf_profile_->Begin();
+    f();
+    perf_profile_->End(phase);
+  }
 
   std::vector<Player>& players_;
-  poker::holdem::PlayerModelVector player_models_;
+  MODELS player_models_;
   STATS& stats_;
-  bool initial_bet_{};
+  // Players who haven't folded, and those of them who aren't all-in.
+  int in_hand_{};
+  int can_act_{};
+  PerfProfile* perf_profile_{};
 };
 
-template <typename RNG, typename STATS>
-void Game<RNG, STATS>::NewGame() {
-  std::for_each(players_.begin(), players_.end(), [](Player& player) {
-    player.reset();
-  });
-  Base::ResetForNextHand();
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::NewGame() {
+  const Stakes& stakes = table().stakes();
+  // Deeper stacks could overflow the action log
+  assert(stakes.Valid());
+  for (size_t i = 0; i < players_.size(); i++) {
+    players_[i].reset(stakes.StackAt(i));
+  }
+  Base::ResetForNextHand(RULES::kHoleCards * players_.size() +
+                         kMaxCommunityCards);
+  in_hand_ = players_.size();
+  can_act_ = players_.size();
+  Commit(players_[SmallBlindPosition()], stakes.small_blind);
+  Commit(players_[BigBlindPosition()], stakes.big_blind);
+  table().set_bet(stakes.big_blind, stakes.big_blind);
   stats_.NewGame(table(), players_);
 }
 
-template <typename RNG, typename STATS>
-void Game<RNG, STATS>::Deal(Round round) {
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::Deal(Round round) {
   switch (round) {
   case Round::PREFLOP:
     for (Player& player : players_) {
-      player.add_card(deck().DealCard());
-      player.add_card(deck().DealCard());
+      for (int i = 0; i < RULES::kHoleCards; i++) {
+        player.add_card(deck().DealCard());
+      }
     }
     break;
   case Round::FLOP:
@@ -153,22 +393,104 @@ void Game<RNG, STATS>::Deal(Round round) {
   };
 }
 
-template <typename RNG, typename STATS>
-void Game<RNG, STATS>::BettingRound(Round round) {
-  int starting_offset = (round == Round::PREFLOP) ? -3 : -1;
-  int next_to_act = Base::RotatePosition(table().button(), starting_offset);
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::Commit(Player& player, int chips) {
+  table().add_to_pot(player.Bet(chips));
+  if (player.all_in()) {
+    can_act_--;
+  }
+}
+
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::Call(Player& player) {
+  if (player.bet() < table().bet()) {
+    Commit(player, table().bet() - player.bet());
+  }
+}
 
-  for (int remaining = players_.size(); remaining > 0; remaining--) {
-    PlayerAction action = player_models_[next_to_act]->Act(table(), round, next_to_act, players_[next_to_act]);
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+bool Game<RNG, STATS, MODELS, RULES>::Raise(Player& player, int raise_to) {
+  if constexpr (RULES::kPotLimit) {
+    // At most the pot after calling
+    raise_to = std::min(raise_to, table().bet() + table().pot() +
+                                      table().bet() - player.bet());
+  }
+  raise_to = std::min(raise_to, player.bet() + player.stack());
+  if (raise_to <= table().bet()) {
+    Call(player);
+    return false;
+  }
+  // An all-in for less than a full raise doesn't change the minimum raise.
+  table().set_bet(raise_to, std::max(table().min_raise(),
+                                     raise_to - table().bet()));
+  Commit(player, raise_to - player.bet());
+  return true;
+}
+
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::BettingRound(Round round) {
+  int position;
+  if (round == Round::PREFLOP) {
+    // The blinds were posted by NewGame()
+    position = Base::RotatePosition(BigBlindPosition(), -1);
+  } else {
+    for (Player& player : players_) {
+      player.clear_bet();
+    }
+    table().set_bet(0, table().stakes().big_blind);
+    position = Base::RotatePosition(table().button(), -1);
+  }
+
+  // Players left to act before the round closes: everyone who can act, then
+  // everyone else who can act again after each raise.
+  int pending = can_act_;
+  // Bit set of positions that acted since the last full raise.  An all-in
+  // for less doesn't reopen the betting to them, so they can only call it.
+  uint32_t acted = 0;
+  for (; pending > 0 && in_hand_ > 1;
+       position = Base::RotatePosition(position, -1)) {
+    Player& player = players_[position];
+    if (!player.can_act()) {
+      continue;
+    }
+    // The last player who can act has nothing to decide unless facing a bet
+    if (can_act_ == 1 && player.bet() >= table().bet()) {
+      break;
+    }
+    pending--;
+    PlayerAction action = player_models_.Act(table(), round, position,
+                                             player);
     switch (action) {
+    case PlayerAction::FOLD:
+      player.fold();
+      in_hand_--;
+      can_act_--;
+      break;
     case PlayerAction::CHECK:
+      Call(player);
       break;
-    case PlayerAction::FOLD:
-      throw std::logic_error("Unimplemented action: FOLD");
     case PlayerAction::RAISE:
-      throw std::logic_error("Unimplemented action: RAISE");
     case PlayerAction::RAISE_ALL_IN:
-      throw std::logic_error("Unimplemented action: RAISE_ALL_IN");
+      {
+        int raise_to = action == PlayerAction::RAISE
+            ? table().bet() + table().min_raise()
+            : player.bet() + player.stack();
+        int bet = table().bet();
+        int full_raise = table().min_raise();
+        if ((acted & (1u << position)) == 0 && Raise(player, raise_to)) {
+          pending = can_act_ - (player.can_act() ? 1 : 0);
+          if (table().bet() - bet >= full_raise) {
+            acted = 0;
+          }
+          action = player.all_in() ? PlayerAction::RAISE_ALL_IN
+                                   : PlayerAction::RAISE;
+        } else {
+          // Logged as a call even when it puts the player all-in
+          Call(player);
+          action = PlayerAction::CHECK;
+        }
+      }
+      break;
     default:
       {
         std::stringstream ss;
@@ -176,47 +498,42 @@ void Game<RNG, STATS>::BettingRound(Round round) {
         throw std::logic_error(ss.str());
       }
     }
-    next_to_act = Base::RotatePosition(table().button(), -1);
+    acted |= 1u << position;
+    table().log_action({static_cast<int8_t>(round),
+                        static_cast<int8_t>(position), action, player.bet()});
   }
 }
 
-
-#if 0
-template <typename RNG, typename STATS>
-void Game<RNG, STATS>::BettingRound(Round round) {
-  int starting_player;
-  int next_player;
-  Player* player;
-  switch (round) {
-  case Round::PREFLOP:
-    for (int bettor = StartingBettor(round); !BettingFinished(); bettor = NextBettor()) {
-    }
-    starting_player = RotatePosition(table.button(), -2);
-    player = &players[starting_player];
-    if (player_models_[starting_player]->Act() == PlayerAction::FOLD) {
-      player->fold();
-    }
-    for (next_player = RotatePosition(starting_player, -1);
-         next_player != starting_player;
-         next_player = RotatePosition(starting_player, -1)) {
+template <typename RNG, typename STATS, typename MODELS, typename RULES>
+void Game<RNG, STATS, MODELS, RULES>::AwardPot() {
+  if (in_hand_ == 1) {
+    for (Player& player : players_) {
+      if (!player.folded()) {
+        player.add_winnings(table().pot());
+      }
     }
-    break;
-  case Round::FLOP:
-    table().add_community_card(deck().DealCard());
-    table().add_community_card(deck().DealCard());
-    table().add_community_card(deck().DealCard());
-    break;
-  case Round::TURN:
-    table().add_community_card(deck().DealCard());
-    break;
-  case Round::RIVER:
-    table().add_community_card(deck().DealCard());
-    break;
-  default:
-    assert(false && "Unknown round");
-  };
+    return;
+  }
+
+  typename RULES::Showdown showdown(table().community_card_mask());
+  std::array<int32_t, kMaxPlayers> strength;
+  for (size_t i = 0; i < players_.size(); i++) {
+    const Player& player = players_[i];
+    strength[i] = player.folded()
+        ? kFolded : showdown.Evaluate(player.card_mask());
+  }
+
+  std::array<int32_t, kMaxPlayers> total_bet;
+  std::array<int32_t, kMaxPlayers> winnings{};
+  for (size_t i = 0; i < players_.size(); i++) {
+    total_bet[i] = players_[i].total_bet();
+  }
+  SplitPot(players_.size(), table().button(), total_bet.data(),
+           strength.data(), winnings.data());
+  for (size_t i = 0; i < players_.size(); i++) {
+    players_[i].add_winnings(winnings[i]);
+  }
 }
-#endif
 
 } // namespace poker::holdem
 
@@ -0,0 +1,232 @@
+#ifndef HOLDEM_BATCH_H
+#define HOLDEM_BATCH_H
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <random>
+
+#include "card_mask.h"
+#include "holdem.h"
+#include "player_model_holdem.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// Structure-of-arrays view of one round at a batch of tables, as passed to
+// STATS::CollectBatch().  Per-seat arrays are seat-major: the value for seat s
+// at table t is at [s * stride + t].
+struct BatchRoundView {
+  int tables;
+  int players;
+  int stride;
+  // Hole hand index (see HoleHandIndex()) of each seat
+  const uint8_t* hole_hand;
+  // Sort code of each seat's best hand; only valid from the flop onwards
+  const int32_t* strength;
+  // Per table bit set of folded seats
+  const uint32_t* folded;
+  // Per table flag set once the hand was decided in an earlier round.  A
+  // table with one seat left that isn't ended was won uncontested this
+  // round.
+  const uint8_t* ended;
+  // Card masks of each seat's hole cards and of each table's board
+  const uint64_t* hole;
+  const uint64_t* board;
+};
+
+// Plays K independent hands in lockstep: every table is dealt, decided,
+// evaluated and collected street by street before moving on to the next
+// street.  Cards, hand strengths and player states are stored as structures
+// of arrays so the per-street loops run across tables with independent
+// iterations.  EvaluateCardMask only works in registers, so K > 1 has not
+// measured faster than K = 1; the gain over Game is the skipped betting.
+//
+// Each round the live seats of every table are decided in one
+// MODEL::ActMany() call.  There is no chip accounting: FOLD folds and every
+// other action stays in, and since a round's decisions are made together
+// each one sees the round unopened.  With PlayerModelShowdown this is
+// equivalent to Game's check-down.
+//
+// STATS must provide NewGames(int count) and CollectBatch(Round, const
+// BatchRoundView&); Statistics does.
+template <typename RNG, typename STATS, int K = 1,
+          typename MODEL = PlayerModelShowdown>
+class BatchGame {
+public:
+  static constexpr int kTables = K;
+
+  BatchGame(int player_count, STATS& stats, RNG& rng, MODEL model = MODEL())
+    : player_count_(player_count), stats_(stats), rng_(rng),
+      model_(std::move(model)) {
+    assert(player_count <= kMaxPlayers);
+    for (auto& deck : deck_) {
+      for (int i = 0; i < kCardCount; i++) {
+        deck[i] = static_cast<uint8_t>(i);
+      }
+    }
+    decision_players_.fill(static_cast<uint8_t>(player_count));
+    decision_raises_.fill(0);
+  }
+
+  // Plays one hand at each of the K tables.
+  void Play() {
+    NewGames();
+    for (Round round : {Round::PREFLOP, Round::FLOP, Round::TURN,
+                        Round::RIVER}) {
+      Deal(round);
+      Decide(round);
+      if (round != Round::PREFLOP) {
+        Evaluate();
+      }
+      stats_.CollectBatch(round, View());
+    }
+  }
+
+private:
+  void NewGames();
+  void Deal(Round round);
+  void Decide(Round round);
+  void Evaluate();
+
+  BatchRoundView View() const {
+    return BatchRoundView{K, player_count_, K, hole_hand_.data(),
+                          strength_.data(), folded_.data(), ended_.data(),
+                          hole_.data(), board_.data()};
+  }
+
+  int player_count_;
+  STATS& stats_;
+  RNG& rng_;
+  MODEL model_;
+
+  // Per table decks; the first 2 * players + 5 cards are drawn each hand
+  std::array<std::array<uint8_t, kCardCount>, K> deck_;
+  // Per table state
+  std::array<uint64_t, K> board_{};
+  std::array<uint32_t, K> folded_{};
+  std::array<uint8_t, K> ended_{};
+  // Per seat state, seat-major
+  std::array<uint64_t, kMaxPlayers * K> hole_{};
+  std::array<uint8_t, kMaxPlayers * K> hole_hand_{};
+  std::array<int32_t, kMaxPlayers * K> strength_{};
+  // Decisions of the current round, gathered for MODEL::ActMany()
+  std::array<uint8_t, kMaxPlayers * K> decision_seat_{};
+  std::array<uint8_t, kMaxPlayers * K> decision_table_{};
+  std::array<uint8_t, kMaxPlayers * K> decision_players_{};
+  std::array<uint8_t, kMaxPlayers * K> decision_position_{};
+  std::array<uint8_t, kMaxPlayers * K> decision_raises_{};
+  std::array<uint8_t, kMaxPlayers * K> decision_hole_hand_{};
+  std::array<uint64_t, kMaxPlayers * K> decision_hole_{};
+  std::array<uint64_t, kMaxPlayers * K> decision_board_{};
+  std::array<PlayerAction, kMaxPlayers * K> actions_{};
+};
+
+template <typename RNG, typename STATS, int K, typename MODEL>
+void BatchGame<RNG, STATS, K, MODEL>::NewGames() {
+  // A partial Fisher-Yates shuffle draws only the cards the hand can use.
+  // Each deck keeps its previous permutation, which doesn't bias the draw.
+  const int draw = kHoleCards * player_count_ + kMaxCommunityCards;
+  for (auto& deck : deck_) {
+    for (int i = 0; i < draw; i++) {
+      std::uniform_int_distribution<int> di(i, kCardCount - 1);
+      std::swap(deck[i], deck[di(rng_)]);
+    }
+  }
+  board_.fill(0);
+  folded_.fill(0);
+  ended_.fill(0);
+  stats_.NewGames(K);
+}
+
+template <typename RNG, typename STATS, int K, typename MODEL>
+void BatchGame<RNG, STATS, K, MODEL>::Deal(Round round) {
+  // Board cards follow the hole cards in each deck
+  const int board = 2 * player_count_;
+  switch (round) {
+  case Round::PREFLOP:
+    for (int s = 0; s < player_count_; s++) {
+      for (int t = 0; t < K; t++) {
+        int card1 = deck_[t][2 * s];
+        int card2 = deck_[t][2 * s + 1];
+        hole_[s * K + t] = IndexToCardMask(card1) | IndexToCardMask(card2);
+        hole_hand_[s * K + t] = static_cast<uint8_t>(HoleHandIndex(card1, card2));
+      }
+    }
+    break;
+  case Round::FLOP:
+    for (int t = 0; t < K; t++) {
+      board_[t] = IndexToCardMask(deck_[t][board]) |
+                  IndexToCardMask(deck_[t][board + 1]) |
+                  IndexToCardMask(deck_[t][board + 2]);
+    }
+    break;
+  case Round::TURN:
+    for (int t = 0; t < K; t++) {
+      board_[t] |= IndexToCardMask(deck_[t][board + 3]);
+    }
+    break;
+  case Round::RIVER:
+    for (int t = 0; t < K; t++) {
+      board_[t] |= IndexToCardMask(deck_[t][board + 4]);
+    }
+    break;
+  default:
+    assert(false && "Unknown round");
+  }
+}
+
+template <typename RNG, typename STATS, int K, typename MODEL>
+void BatchGame<RNG, STATS, K, MODEL>::Decide(Round round) {
+  // Hands won uncontested last round are over
+  for (int t = 0; t < K; t++) {
+    if (__builtin_popcount(folded_[t]) == player_count_ - 1) {
+      ended_[t] = 1;
+    }
+  }
+  // Seat 0 is on the button and the others follow in acting order
+  int count = 0;
+  for (int s = 0; s < player_count_; s++) {
+    for (int t = 0; t < K; t++) {
+      if (ended_[t] || (folded_[t] & (1u << s)) != 0) {
+        continue;
+      }
+      decision_seat_[count] = static_cast<uint8_t>(s);
+      decision_table_[count] = static_cast<uint8_t>(t);
+      decision_position_[count] = static_cast<uint8_t>(s);
+      decision_hole_hand_[count] = hole_hand_[s * K + t];
+      decision_hole_[count] = hole_[s * K + t];
+      decision_board_[count] = board_[t];
+      count++;
+    }
+  }
+  DecisionView view{round, count, decision_players_.data(),
+                    decision_position_.data(), decision_raises_.data(),
+                    decision_hole_hand_.data(), decision_hole_.data(),
+                    decision_board_.data()};
+  model_.MODEL::ActMany(view, actions_.data());
+
+  for (int i = 0; i < count; i++) {
+    if (actions_[i] == PlayerAction::FOLD) {
+      int t = decision_table_[i];
+      uint32_t folded = folded_[t] | (1u << decision_seat_[i]);
+      // The last seat standing can't fold
+      if (__builtin_popcount(folded) < player_count_) {
+        folded_[t] = folded;
+      }
+    }
+  }
+}
+
+template <typename RNG, typename STATS, int K, typename MODEL>
+void BatchGame<RNG, STATS, K, MODEL>::Evaluate() {
+  for (int s = 0; s < player_count_; s++) {
+    for (int t = 0; t < K; t++) {
+      strength_[s * K + t] = EvaluateCardMask(board_[t] | hole_[s * K + t]);
+    }
+  }
+}
+
+} // namespace poker::holdem
+
+#endif // HOLDEM_BATCH_H
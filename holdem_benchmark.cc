@@ -0,0 +1,328 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "equity.h"
+#include "hand_history.h"
+#include "hand_import.h"
+#include "hand_strength.h"
+#include "holdem.h"
+#include "holdem_batch.h"
+#include "holdem_state.h"
+#include "outs.h"
+#include "holdem_stats.h"
+#include "player_model_holdem.h"
+#include "poker.h"
+#include "poker_simulation_args.h"
+
+//
+// Compares hand throughput of the single table Game with the batched
+// structure-of-arrays BatchGame, both feeding Statistics, and measures the
+// betting engine on its own (no statistics) and rollouts of a copied
+// HoldemState, hand strength queries with and without the cache, exact
+// against sampled flop equity, outs, and importing ACPC hand histories.
+//
+// Usage: holdem_benchmark [players] [hands]
+//
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using poker::holdem::NullStatistics;
+
+double Seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const std::string& name, uint64_t hands, double seconds,
+            double baseline) {
+  double rate = hands / seconds;
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(12) << static_cast<uint64_t>(rate) << " hands/s";
+  if (baseline > 0) {
+    std::cout << "  (" << std::fixed << std::setprecision(2)
+              << rate / baseline << "x)";
+  }
+  std::cout << std::endl;
+}
+
+double RunGame(PokerSimulationArgs& args, int hands) {
+  poker::Table table;
+  std::vector<poker::Player> players(args.players);
+  poker::holdem::PlayerModelVector player_models;
+  for (int i = 0; i < args.players; i++) {
+    player_models.push_back(
+        std::make_unique<poker::holdem::PlayerModelShowdown>());
+  }
+  poker::holdem::Statistics stats(args);
+  std::mt19937 rng(1);
+  poker::holdem::Game<std::mt19937, poker::holdem::Statistics> game(
+      table, players, std::move(player_models), stats, rng);
+  auto start = Clock::now();
+  for (int i = 0; i < hands; i++) {
+    game.Play();
+  }
+  double seconds = Seconds(start);
+  Report("Game", stats.games(), seconds, 0);
+  return stats.games() / seconds;
+}
+
+// Plays MODEL at every seat, through the per seat PlayerModel vtable
+// (PlayerModels) or called directly (SamePlayerModel).
+template <typename MODEL, typename MODELS>
+void RunEngine(MODELS models, const std::string& name, int players, int hands,
+               double baseline) {
+  poker::Table table;
+  std::vector<poker::Player> seats(players);
+  NullStatistics stats;
+  std::mt19937 rng(1);
+  poker::holdem::Game<std::mt19937, NullStatistics, MODELS> game(
+      table, seats, std::move(models), stats, rng);
+  auto start = Clock::now();
+  for (int i = 0; i < hands; i++) {
+    game.Play();
+  }
+  Report("Engine/" + MODEL::name() + name, hands, Seconds(start), baseline);
+}
+
+template <typename MODEL>
+void RunEngine(int players, int hands, double baseline) {
+  poker::holdem::PlayerModelVector player_models;
+  for (int i = 0; i < players; i++) {
+    player_models.push_back(std::make_unique<MODEL>());
+  }
+  RunEngine<MODEL>(poker::holdem::PlayerModels(std::move(player_models)),
+                   "/virtual", players, hands, baseline);
+  RunEngine<MODEL>(poker::holdem::SamePlayerModel<MODEL>(), "/inline",
+                   players, hands, baseline);
+}
+
+template <int K>
+void RunBatchGame(PokerSimulationArgs& args, int hands, double baseline) {
+  poker::holdem::Statistics stats(args);
+  std::mt19937 rng(1);
+  poker::holdem::BatchGame<std::mt19937, poker::holdem::Statistics, K> game(
+      args.players, stats, rng);
+  auto start = Clock::now();
+  for (int i = 0; i < hands; i += K) {
+    game.Play();
+  }
+  double seconds = Seconds(start);
+  Report("BatchGame<" + std::to_string(K) + ">", stats.games(), seconds,
+         baseline);
+}
+
+// Copies a flop state and checks it down to the showdown, as Monte Carlo
+// search does from each node.
+void RunRollouts(int players, int rollouts, double baseline) {
+  std::mt19937 rng(1);
+  poker::holdem::HoldemState root;
+  root.NewHand(poker::Stakes(), players, 0, rng);
+  while (root.round == poker::holdem::Round::PREFLOP) {
+    root.Apply(poker::PlayerAction::CHECK);
+  }
+  int64_t won = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < rollouts; i++) {
+    poker::holdem::HoldemState state = root;
+    state.Rollout(rng);
+    won += state.winnings[0];
+  }
+  double seconds = Seconds(start);
+  // Keeps the rollouts from being optimized away
+  if (won < 0) {
+    std::cout << won;
+  }
+  Report("HoldemState/rollout", rollouts, seconds, baseline);
+}
+
+// Queries the hand strength of the button's hole cards on the turn of random
+// hands.  Without the cache every query is computed; with it, repeats of a
+// spot up to suit symmetry are looked up.
+void RunHandStrength(int queries) {
+  std::mt19937 rng(1);
+  std::vector<std::pair<uint64_t, uint64_t>> spots;
+  poker::holdem::HoldemState state;
+  for (int i = 0; i < queries; i++) {
+    state.NewHand(poker::Stakes(), 2, 0, rng);
+    while (state.round != poker::holdem::Round::TURN) {
+      state.Apply(poker::PlayerAction::CHECK);
+    }
+    spots.emplace_back(state.hole[0], state.board);
+  }
+  double sum = 0;
+  auto start = Clock::now();
+  for (const auto& [hole, board] : spots) {
+    sum += poker::holdem::ComputeHandStrength(hole, board).Effective();
+  }
+  double uncached = queries / Seconds(start);
+  poker::holdem::HandStrengthCache cache;
+  // Each spot asked for twice, as by two models in the same hand
+  start = Clock::now();
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto& [hole, board] : spots) {
+      sum += cache.Get(hole, board).Effective();
+    }
+  }
+  double cached = 2 * queries / Seconds(start);
+  std::cout << std::left << std::setw(32) << "HandStrength/turn" << std::right
+            << std::setw(12) << static_cast<uint64_t>(uncached)
+            << " queries/s, cached " << static_cast<uint64_t>(cached)
+            << " queries/s (" << std::fixed << std::setprecision(1)
+            << 100.0 * cache.hits() / (cache.hits() + cache.misses())
+            << "% hits)" << (sum < 0 ? " " : "") << std::endl;
+}
+
+// Heads up flop equity from enumerating all 990 runouts against sampling as
+// many: the same cost, but enumeration is exact.
+void RunEquity(int queries) {
+  std::mt19937 rng(1);
+  std::vector<poker::holdem::HoldemState> flops(queries);
+  for (poker::holdem::HoldemState& state : flops) {
+    state.NewHand(poker::Stakes(), 2, 0, rng);
+    while (state.round != poker::holdem::Round::FLOP) {
+      state.Apply(poker::PlayerAction::CHECK);
+    }
+  }
+  double sum = 0;
+  auto start = Clock::now();
+  for (const poker::holdem::HoldemState& state : flops) {
+    sum += poker::holdem::EnumerateEquity(state.hole.data(), 2, state.board)
+               .share[0];
+  }
+  double exact = queries / Seconds(start);
+  start = Clock::now();
+  for (const poker::holdem::HoldemState& state : flops) {
+    sum += poker::holdem::SampleEquity(state.hole.data(), 2, state.board, 0,
+                                       rng, 990).share[0];
+  }
+  double sampled = queries / Seconds(start);
+  std::cout << std::left << std::setw(32) << "Equity/flop" << std::right
+            << std::setw(12) << static_cast<uint64_t>(exact)
+            << " exact/s, sampled " << static_cast<uint64_t>(sampled)
+            << "/s" << (sum < 0 ? " " : "") << std::endl;
+}
+
+// Outs of every player on the flop, as a model would ask at each decision.
+void RunOuts(int players, int hands, double baseline) {
+  std::mt19937 rng(1);
+  poker::holdem::HoldemState state;
+  int outs = 0;
+  auto start = Clock::now();
+  for (int i = 0; i < hands; i++) {
+    state.NewHand(poker::Stakes(), players, 0, rng);
+    while (state.round != poker::holdem::Round::FLOP) {
+      state.Apply(poker::PlayerAction::CHECK);
+    }
+    for (int p = 0; p < players; p++) {
+      outs += poker::ComputeOuts(state.hole[p], state.board).count();
+    }
+  }
+  double seconds = Seconds(start);
+  if (outs < 0) {
+    std::cout << outs;
+  }
+  Report("Outs/flop (all players)", hands, seconds, baseline);
+}
+
+// Formats every hand played as an ACPC log line.
+struct AcpcExport : NullStatistics {
+  void NewGame(const poker::Table& table,
+               std::vector<poker::Player>& players) {
+    table_ = &table;
+    players_ = &players;
+  }
+  void Collect(poker::holdem::Round round) {
+    if (round == poker::holdem::Round::RIVER) {
+      Export();
+    }
+  }
+  void CollectUncontested(poker::holdem::Round) { Export(); }
+  void Export() {
+    poker::holdem::RecordHand(*table_, *players_, &hand_);
+    text += poker::holdem::FormatAcpcHand(hand_, players_->size(),
+                                          table_->stakes(), hands++);
+    text += '\n';
+  }
+
+  std::string text;
+  uint64_t hands{};
+  const poker::Table* table_{};
+  const std::vector<poker::Player>* players_{};
+  poker::holdem::HandRecord hand_;
+};
+
+// Parses ACPC hand histories of miller_tight hands on one core, on their own
+// and replayed into a collector that ignores them (what --import adds to
+// Statistics).
+void RunImport(int players, int hands, double baseline) {
+  poker::Table table;
+  std::vector<poker::Player> seats(players);
+  AcpcExport corpus;
+  std::mt19937 rng(1);
+  using Model =
+      poker::holdem::SamePlayerModel<poker::holdem::PlayerModelMillerTight>;
+  poker::holdem::Game<std::mt19937, AcpcExport, Model> game(
+      table, seats, Model(), corpus, rng);
+  for (int i = 0; i < hands; i++) {
+    game.Play();
+  }
+
+  poker::holdem::AcpcHandParser parser(players, poker::Stakes());
+  poker::holdem::HandRecord hand;
+  uint64_t parsed = 0;
+  auto start = Clock::now();
+  std::string_view text = corpus.text;
+  for (size_t pos = 0; pos < text.size();) {
+    size_t eol = text.find('\n', pos);
+    parsed += parser.Parse(text.substr(pos, eol - pos), &hand);
+    pos = eol + 1;
+  }
+  double seconds = Seconds(start);
+  std::cout << std::left << std::setw(32) << "Import/parse" << std::right
+            << std::setw(12)
+            << static_cast<uint64_t>(text.size() / seconds / 1e6)
+            << " MB/s, " << static_cast<uint64_t>(parsed / seconds)
+            << " hands/s" << std::endl;
+
+  poker::holdem::HandReplay replay(
+      poker::holdem::MakeHandHistoryHeader<poker::holdem::HoldemRules>(
+          players, poker::Stakes(), false));
+  NullStatistics stats;
+  start = Clock::now();
+  poker::holdem::ImportAcpcHands(text, parser, replay, stats);
+  Report("Import/parse+replay", hands, Seconds(start), baseline);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  PokerSimulationArgs args;
+  args.players = argc > 1 ? std::atoi(argv[1]) : 6;
+  int hands = argc > 2 ? std::atoi(argv[2]) : 1'000'000;
+  args.stats_winning_hand = true;
+  args.stats_hole_cards = true;
+
+  std::cout << "Players: " << args.players << ", hands: " << hands
+            << std::endl;
+  double baseline = RunGame(args, hands);
+  RunBatchGame<1>(args, hands, baseline);
+  RunBatchGame<8>(args, hands, baseline);
+  RunBatchGame<16>(args, hands, baseline);
+  RunBatchGame<64>(args, hands, baseline);
+  RunEngine<poker::holdem::PlayerModelShowdown>(args.players, hands, baseline);
+  RunEngine<poker::holdem::PlayerModelMillerTight>(args.players, hands,
+                                                   baseline);
+  RunRollouts(args.players, hands, baseline);
+  RunHandStrength(hands / 1000);
+  RunEquity(hands / 100);
+  RunOuts(args.players, hands / 10, baseline);
+  RunImport(args.players, hands, baseline);
+  return 0;
+}
@@ -0,0 +1,138 @@
+#include "holdem_state.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+namespace poker::holdem {
+
+void HoldemState::Commit(int position, int chips) {
+  int moved = std::min(chips, stack[position]);
+  stack[position] -= moved;
+  bet[position] += moved;
+  total_bet[position] += moved;
+  pot += moved;
+  if (stack[position] == 0) {
+    can_act--;
+  }
+}
+
+void HoldemState::Call(int position) {
+  if (bet[position] < current_bet) {
+    Commit(position, current_bet - bet[position]);
+  }
+}
+
+bool HoldemState::Raise(int position, int raise_to) {
+  raise_to = std::min(raise_to, bet[position] + stack[position]);
+  if (raise_to <= current_bet) {
+    Call(position);
+    return false;
+  }
+  // An all-in for less than a full raise doesn't change the minimum raise.
+  min_raise = std::max(min_raise, raise_to - current_bet);
+  current_bet = raise_to;
+  Commit(position, raise_to - bet[position]);
+  return true;
+}
+
+void HoldemState::Apply(PlayerAction action) {
+  assert(!finished());
+  const int position = to_act;
+  pending--;
+  switch (action) {
+  case PlayerAction::FOLD:
+    folded |= 1u << position;
+    in_hand--;
+    can_act--;
+    break;
+  case PlayerAction::CHECK:
+    Call(position);
+    break;
+  case PlayerAction::RAISE:
+  case PlayerAction::RAISE_ALL_IN:
+    {
+      int raise_to = action == PlayerAction::RAISE
+          ? current_bet + min_raise
+          : bet[position] + stack[position];
+      int32_t previous_bet = current_bet;
+      int32_t full_raise = min_raise;
+      if (((acted >> position) & 1) == 0 && Raise(position, raise_to)) {
+        pending = can_act - (stack[position] > 0 ? 1 : 0);
+        if (current_bet - previous_bet >= full_raise) {
+          acted = 0;
+        }
+      } else {
+        Call(position);
+      }
+    }
+    break;
+  default:
+    {
+      std::stringstream ss;
+      ss << "Invalid action value: " << static_cast<int>(action);
+      throw std::logic_error(ss.str());
+    }
+  }
+  acted |= 1u << position;
+  Advance(Rotate(position));
+}
+
+void HoldemState::Advance(int position) {
+  for (;;) {
+    // Same loop as Game::BettingRound(), resumed at position
+    for (int seen = 0; pending > 0 && in_hand > 1 && seen < players;
+         seen++, position = Rotate(position)) {
+      if (is_folded(position) || stack[position] == 0) {
+        continue;
+      }
+      // The last player who can act has nothing to decide unless facing a bet
+      if (can_act == 1 && bet[position] >= current_bet) {
+        break;
+      }
+      to_act = static_cast<int8_t>(position);
+      return;
+    }
+    if (in_hand == 1 || round == Round::RIVER) {
+      to_act = kNobody;
+      AwardPot();
+      return;
+    }
+    round = static_cast<Round>(static_cast<int>(round) + 1);
+    DealStreet();
+    for (int i = 0; i < players; i++) {
+      bet[i] = 0;
+    }
+    current_bet = 0;
+    min_raise = big_blind;
+    acted = 0;
+    pending = can_act;
+    position = Rotate(button);
+  }
+}
+
+void HoldemState::DealStreet() {
+  int cards = round == Round::FLOP ? 3 : 1;
+  for (int i = 0; i < cards; i++) {
+    board |= IndexToCardMask(deck[next_card++]);
+  }
+}
+
+void HoldemState::AwardPot() {
+  if (in_hand == 1) {
+    for (int i = 0; i < players; i++) {
+      if (!is_folded(i)) {
+        winnings[i] += pot;
+      }
+    }
+    return;
+  }
+  std::array<int32_t, kMaxPlayers> strength;
+  for (int i = 0; i < players; i++) {
+    strength[i] = is_folded(i) ? kFolded : EvaluateCardMask(board | hole[i]);
+  }
+  SplitPot(players, button, total_bet.data(), strength.data(),
+           winnings.data());
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,174 @@
+#ifndef HOLDEM_STATE_H
+#define HOLDEM_STATE_H
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+
+#include "card_mask.h"
+#include "cards.h"
+#include "holdem.h"
+#include "player_model.h"
+#include "poker.h"
+
+namespace poker::holdem {
+
+// The complete state of one hand of no-limit hold'em, for search and Monte
+// Carlo rollouts from the middle of a hand.  Unlike Game, which plays through
+// references to an external Table, players, models and statistics, a
+// HoldemState owns everything it needs in fixed-size arrays of cards as
+// indices and masks (see card_mask.h), so copying one is a plain memcpy of a
+// few hundred bytes.
+//
+// Apply() follows Game's betting rules exactly: the same blinds, acting
+// order, minimum raises and side pots.  Whenever a betting round closes the
+// next street is dealt from the state's own deck, and after the river (or
+// once everyone else has folded) the pot is awarded to winnings.
+struct HoldemState {
+  static constexpr int8_t kNobody = -1;
+
+  // Card indices in deal order; cards before next_card have been dealt
+  std::array<uint8_t, kCardCount> deck;
+  uint8_t next_card;
+
+  uint8_t players;
+  uint8_t button;
+  Round round;
+  // Position of the player to act, or kNobody once the hand is over
+  int8_t to_act;
+  // Players left to act before the round closes, as in Game::BettingRound()
+  uint8_t pending;
+  // Players who haven't folded, and those of them who aren't all-in
+  uint8_t in_hand;
+  uint8_t can_act;
+  // Bit set of folded positions
+  uint32_t folded;
+  // Bit set of positions that acted since the round's last full raise, who
+  // can only call an all-in for less (see Game::BettingRound())
+  uint32_t acted;
+
+  uint64_t board;
+  std::array<uint64_t, kMaxPlayers> hole;
+
+  // Per position chips; bet is this round's, total_bet the whole hand's.
+  // Chips won are kept apart in winnings, as Player does.
+  std::array<int32_t, kMaxPlayers> stack;
+  std::array<int32_t, kMaxPlayers> bet;
+  std::array<int32_t, kMaxPlayers> total_bet;
+  std::array<int32_t, kMaxPlayers> winnings;
+  int32_t pot;
+  // The round's bet to call and minimum raise over it
+  int32_t current_bet;
+  int32_t min_raise;
+  int32_t big_blind;
+
+  // Shuffles, deals the hole cards and posts the blinds for a new hand with
+  // the dealer button at position button, leaving the first preflop decision
+  // to act.
+  template <typename RNG>
+  void NewHand(const Stakes& stakes, int player_count, int button_position,
+               RNG& rng);
+
+  // Plays action for the player to act.  Throws std::logic_error for an
+  // invalid action.
+  void Apply(PlayerAction action);
+
+  bool finished() const { return to_act == kNobody; }
+  bool is_folded(int position) const { return (folded >> position) & 1; }
+
+  // Plays the hand out from here with every player checking or calling.
+  // The cards still to come are redrawn from the undealt part of the deck, so
+  // rollouts from copies of one state see independent runouts.
+  template <typename RNG>
+  void Rollout(RNG& rng) {
+    Rollout(rng, [](const HoldemState&) { return PlayerAction::CHECK; });
+  }
+  // As above with policy(const HoldemState&) choosing each action.
+  template <typename RNG, typename POLICY>
+  void Rollout(RNG& rng, POLICY&& policy);
+
+private:
+  int Rotate(int position) const {
+    return position == 0 ? players - 1 : position - 1;
+  }
+  // Heads up the button posts the small blind.
+  int SmallBlindPosition() const {
+    return players == 2 ? button : Rotate(button);
+  }
+
+  void Commit(int position, int chips);
+  void Call(int position);
+  bool Raise(int position, int raise_to);
+  // Finds the next player to act from position on, moving on to the next
+  // street or the showdown when the round closes.
+  void Advance(int position);
+  void DealStreet();
+  void AwardPot();
+};
+
+static_assert(std::is_trivially_copyable_v<HoldemState>,
+              "HoldemState must stay copyable with memcpy");
+
+template <typename RNG>
+void HoldemState::NewHand(const Stakes& stakes, int player_count,
+                          int button_position, RNG& rng) {
+  assert(player_count >= 2 && player_count <= kMaxPlayers);
+  assert(button_position < player_count);
+  players = static_cast<uint8_t>(player_count);
+  button = static_cast<uint8_t>(button_position);
+
+  // Only the cards the hand can deal are drawn; see Deck::Shuffle()
+  for (int i = 0; i < kCardCount; i++) {
+    deck[i] = static_cast<uint8_t>(i);
+  }
+  const int draw = kHoleCards * player_count + kMaxCommunityCards;
+  for (int i = 0; i < draw; i++) {
+    std::swap(deck[i], deck[i + UniformBelow(rng, kCardCount - i)]);
+  }
+  next_card = 0;
+  for (int i = 0; i < player_count; i++) {
+    hole[i] = IndexToCardMask(deck[next_card]) |
+              IndexToCardMask(deck[next_card + 1]);
+    next_card += kHoleCards;
+  }
+  board = 0;
+
+  for (int i = 0; i < player_count; i++) {
+    stack[i] = stakes.StackAt(i);
+    bet[i] = 0;
+    total_bet[i] = 0;
+    winnings[i] = 0;
+  }
+  folded = 0;
+  pot = 0;
+  in_hand = players;
+  can_act = players;
+  big_blind = stakes.big_blind;
+
+  round = Round::PREFLOP;
+  acted = 0;
+  int small_blind = SmallBlindPosition();
+  int big_blind_position = Rotate(small_blind);
+  Commit(small_blind, stakes.small_blind);
+  Commit(big_blind_position, stakes.big_blind);
+  current_bet = stakes.big_blind;
+  min_raise = stakes.big_blind;
+  pending = can_act;
+  Advance(Rotate(big_blind_position));
+}
+
+template <typename RNG, typename POLICY>
+void HoldemState::Rollout(RNG& rng, POLICY&& policy) {
+  const int to_deal = kMaxCommunityCards - __builtin_popcountll(board);
+  for (int i = next_card; i < next_card + to_deal; i++) {
+    std::swap(deck[i], deck[i + UniformBelow(rng, kCardCount - i)]);
+  }
+  while (!finished()) {
+    Apply(policy(static_cast<const HoldemState&>(*this)));
+  }
+}
+
+} // namespace poker::holdem
+
+#endif // HOLDEM_STATE_H
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <array>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
@@ -6,44 +8,89 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+#include "card_mask.h"
 #include "cards.pb.h"
+#include "equity.h"
 #include "holdem.h"
 #include "holdem_stats.h"
+#include "omaha.h"
 #include "poker.h"
 #include "poker.pb.h"
 #include "poker_simulation_args.h"
+#include "short_deck.h"
+#include "stats_file.h"
 
 namespace poker::holdem {
 
-Statistics::Statistics(PokerSimulationArgs &args) : args_(args) {
-  // Initialize hand index
+namespace {
+
+// Maps each distinct hole hand of the cards from low_rank up (169 for the
+// full deck) to its index.
+std::unordered_map<Hand, int> BuildHoleHandIndex(Rank low_rank) {
+  std::unordered_map<Hand, int> hole_hand_index;
   int offset{};
   Hand hand;
 
-  for (Rank rank1 = Rank::ACE; rank1 > Rank::ONE;
+  for (Rank rank1 = Rank::ACE; rank1 >= low_rank;
        rank1 = OffsetRank(rank1, -1)) {
     hand = HoleHand(rank1, rank1, HandType::ONE_PAIR);
-    hole_hand_index_[hand] = offset++;
-    for (Rank rank2 = OffsetRank(rank1, -1); rank2 > Rank::ONE;
+    hole_hand_index[hand] = offset++;
+    for (Rank rank2 = OffsetRank(rank1, -1); rank2 >= low_rank;
          rank2 = OffsetRank(rank2, -1)) {
       hand = HoleHand(rank1, rank2, HandType::FLUSH);
-      hole_hand_index_[hand] = offset++;
+      hole_hand_index[hand] = offset++;
       hand = HoleHand(rank1, rank2, HandType::HIGH_CARD);
-      hole_hand_index_[hand] = offset++;
+      hole_hand_index[hand] = offset++;
     }
   }
-  assert(offset == kHoleHandCount);
+  return hole_hand_index;
+}
+
+// The hole hand index of RULES' deck.  Built once and shared by every
+// Statistics object (e.g. per-thread shards in a sweep).
+template <typename RULES>
+const std::unordered_map<Hand, int> &SharedHoleHandIndex() {
+  static const std::unordered_map<Hand, int> hole_hand_index =
+      BuildHoleHandIndex(static_cast<Rank>(RULES::Ranking::kLowRank));
+  return hole_hand_index;
+}
+
+// RankShowdown() of the first SEATS seats of strength.
+template <size_t SEATS>
+ShowdownRanking RankSeats(const std::array<int32_t, kMaxPlayers> &strength) {
+  std::array<int32_t, SEATS> seats;
+  std::copy_n(strength.begin(), SEATS, seats.begin());
+  return RankShowdown(seats);
+}
 
+using RankSeatsFn = ShowdownRanking (*)(
+    const std::array<int32_t, kMaxPlayers> &strength);
+
+constexpr RankSeatsFn kRankSeats[kMaxPlayers + 1] = {
+    &RankSeats<0>, &RankSeats<1>, &RankSeats<2>, &RankSeats<3>,
+    &RankSeats<4>, &RankSeats<5>, &RankSeats<6>, &RankSeats<7>,
+    &RankSeats<8>, &RankSeats<9>, &RankSeats<10>,
+};
+
+} // namespace
+
+template <typename RULES>
+BasicStatistics<RULES>::BasicStatistics(PokerSimulationArgs &args)
+    : args_(args), hole_hand_index_(SharedHoleHandIndex<RULES>()) {
+  assert(kHoleHandCount == 0 ||
+         hole_hand_index_.size() == static_cast<size_t>(kHoleHandCount));
   // Initialize hole hand appearance vector
   hole_hand_appearance_ = std::vector<int32_t>(kHoleHandCount, 0);
 
   // Sanity check sort code limit (maximum hand sort code + 1). Max sort code is
   // equivalent to straight flush (enum value 9) and all aces (enum value 14).
   {
+    Hand hand;
     hand.set_type(HandType::STRAIGHT_FLUSH);
-    hand.clear_rank();
     for (int i = 0; i < 5; i++) {
       hand.add_rank(Rank::ACE);
     }
@@ -52,99 +99,387 @@ Statistics::Statistics(PokerSimulationArgs &args) : args_(args) {
   }
 
   // Initialize per-round statistics variables. We don't track statistics for
-  // pre-flop which is why the index starts at kRoundFlop.
+  // pre-flop which is why the index starts at kRoundFlop.  Only the counters
+  // for the requested statistics are allocated.
   for (int r = kRoundFlop; r < kRoundMax; r++) {
     RoundStats &stats = round_stats_[r];
 
-    // Initialize beat matrix
-    stats.beat_matrix = std::vector<std::vector<int32_t>>(kHoleHandCount);
-    for (int i = 0; i < kHoleHandCount; i++) {
-      stats.beat_matrix[i].resize(kHoleHandCount, 0);
-    }
+    if (args_.stats_hole_cards) {
+      // Initialize beat matrix
+      stats.beat_matrix = std::vector<std::vector<int32_t>>(kHoleHandCount);
+      for (int i = 0; i < kHoleHandCount; i++) {
+        stats.beat_matrix[i].resize(kHoleHandCount, 0);
+      }
 
-    // Initialize hand win count vector
-    stats.hand_win_count = std::vector<int32_t>(kSortCodeLimit, 0);
+      stats.tie_matrix = stats.beat_matrix;
 
-    // Initialize hole hand win vector
-    stats.hole_hand_wins = std::vector<int32_t>(kSortCodeLimit, 0);
+      // Initialize hole hand win, tie and loss vectors
+      stats.hole_hand_wins = std::vector<int32_t>(kHoleHandCount, 0);
+      stats.hole_hand_ties = stats.hole_hand_wins;
+      stats.hole_hand_losses = stats.hole_hand_wins;
 
-    // Initialize win percentage matrix
-    stats.win_percentage_matrix =
-        std::vector<std::vector<float>>(kHoleHandCount);
-    for (int i = 0; i < kHoleHandCount; i++) {
-      stats.win_percentage_matrix[i].resize(kHoleHandCount, 0.0);
+      // Initialize win percentage matrix
+      stats.win_percentage_matrix =
+          std::vector<std::vector<float>>(kHoleHandCount);
+      for (int i = 0; i < kHoleHandCount; i++) {
+        stats.win_percentage_matrix[i].resize(kHoleHandCount, 0.0);
+      }
+    }
+
+    if (args_.stats_winning_hand) {
+      // Initialize hand win count vector (indexed by HandValueIndex)
+      stats.hand_win_count = std::vector<int32_t>(kHandValueCount, 0);
+    }
+  }
+
+  if (args_.stats_hand_attributes) {
+    hand_attributes_.resize(kMaxPlayers);
+  }
+  if (args_.stats_equity) {
+    for (int r = kRoundFlop; r < kRoundRiver; r++) {
+      equity_stats_[r].equity.resize(kHoleHandCount);
+      equity_stats_[r].hands.resize(kHoleHandCount);
     }
   }
 }
 
-void Statistics::NewGame(const poker::Table &table,
-                         std::vector<Player> &players) {
+template <typename RULES>
+void BasicStatistics<RULES>::NewGame(const poker::Table &table,
+                                     std::vector<Player> &players) {
+  games_++;
+  // The game passes the same table and players every hand, so the player
+  // pointers only need to be set up when they change.
+  if (table_ == &table && players_.size() == players.size() &&
+      (players.empty() || players_[0] == &players[0])) {
+    return;
+  }
   table_ = &table;
-  players_.resize(players.size());
-  for (int i = 0; i < players.size(); i++) {
-    players_[i] = &players[i];
+  players_.clear();
+  for (Player &player : players) {
+    players_.push_back(&player);
   }
+  static constexpr CollectRoundFn kCollectRound[kMaxPlayers + 1] = {
+      &BasicStatistics::CollectRound<0>, &BasicStatistics::CollectRound<1>,
+      &BasicStatistics::CollectRound<2>, &BasicStatistics::CollectRound<3>,
+      &BasicStatistics::CollectRound<4>, &BasicStatistics::CollectRound<5>,
+      &BasicStatistics::CollectRound<6>, &BasicStatistics::CollectRound<7>,
+      &BasicStatistics::CollectRound<8>, &BasicStatistics::CollectRound<9>,
+      &BasicStatistics::CollectRound<10>,
+  };
+  static_assert(kMaxPlayers == 10, "Add CollectRound instantiations");
+  collect_round_ = kCollectRound[players_.size()];
 }
 
-void Statistics::CollectRound(Round round) {
-  HandEvaluator he;
+template <typename RULES>
+template <int PLAYERS>
+void BasicStatistics<RULES>::CollectRound(Round round) {
   int round_index = static_cast<int>(round);
-  RoundStats &round_stats = round_stats_[round_index];
 
-  for (Player *player : players_) {
-    he.Reset(table_->community_cards());
-    player->set_hand(round_index, he.Evaluate(player->cards()));
+  typename RULES::Showdown evaluator(table_->community_card_mask());
+  std::array<int32_t, PLAYERS> strength;
+  for (int i = 0; i < PLAYERS; i++) {
+    const Player *player = players_[i];
+    strength[i] = player->folded() ? kFolded
+                                   : evaluator.Evaluate(player->card_mask());
+  }
+  ShowdownRanking ranking = RankShowdown(strength);
+  CountShowdown(round_stats_[round_index], ranking, strength.data(),
+                seat_hole_hand_.data());
+  if (args_.stats_equity && round != Round::RIVER) {
+    std::array<uint64_t, PLAYERS> hole;
+    uint32_t folded = 0;
+    for (int i = 0; i < PLAYERS; i++) {
+      hole[i] = players_[i]->card_mask();
+      folded |= players_[i]->folded() ? 1u << i : 0;
+    }
+    CollectEquity(round_index, PLAYERS, hole.data(), seat_hole_hand_.data(),
+                  folded, table_->community_card_mask());
+  }
+
+  if (!args_.stats_hand_attributes) {
+    return;
+  }
+  for (int i = 0; i < PLAYERS; i++) {
+    const Player *player = players_[i];
+    if (player->folded()) {
+      continue;
+    }
+    if (round == Round::RIVER) {
+      if (strength[i] == strength[ranking.seat[0]]) {
+        CollectAttributeWin(i);
+      }
+    } else {
+      CollectAttributes(round_index, i, player->card_mask(),
+                        table_->community_card_mask());
+    }
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::CollectEquity(int round, int seats,
+                                           const uint64_t *hole,
+                                           const int *hole_hand,
+                                           uint32_t folded, uint64_t board) {
+  // EnumerateEquity() deals from the standard deck with hold'em hands
+  if constexpr (std::is_same_v<RULES, HoldemRules>) {
+    std::array<uint64_t, kMaxPlayers> live{};
+    std::array<int, kMaxPlayers> live_hole_hand{};
+    int players = 0;
+    uint64_t dead = 0;
+    for (int s = 0; s < seats; s++) {
+      if (folded & (1u << s)) {
+        dead |= hole[s];
+      } else {
+        live_hole_hand[players] = hole_hand[s];
+        live[players++] = hole[s];
+      }
+    }
+    Equity equity = EnumerateEquity(live.data(), players, board, dead);
+    EquityStats &stats = equity_stats_[round];
+    for (int p = 0; p < players; p++) {
+      stats.equity[live_hole_hand[p]] += equity.share[p];
+      stats.hands[live_hole_hand[p]]++;
+    }
+  }
+}
+
+template <typename RULES>
+double BasicStatistics<RULES>::HoleHandEquity(Round round,
+                                              int hole_hand) const {
+  const EquityStats &stats = equity_stats_[static_cast<int>(round)];
+  if (stats.hands.empty() || stats.hands[hole_hand] == 0) {
+    return 0;
   }
-  std::vector<Player *> players = players_;
-  std::sort(players.begin(), players.end(), [&](Player *lhs, Player *rhs) {
-    return lhs->hand(round_index).sort_code() >
-           rhs->hand(round_index).sort_code();
-  });
+  return stats.equity[hole_hand] / stats.hands[hole_hand];
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::CollectAttributes(int round, size_t slot,
+                                               uint64_t hole, uint64_t board) {
+  uint32_t attributes = HandAttributes(hole, board);
+  hand_attributes_[slot][round] = static_cast<uint8_t>(attributes);
+  AttributeStats &stats = attribute_stats_[round];
+  for (; attributes != 0; attributes &= attributes - 1) {
+    stats.hands[__builtin_ctz(attributes)]++;
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::CollectAttributeWin(size_t slot) {
+  for (int r = kRoundFlop; r < kRoundRiver; r++) {
+    AttributeStats &stats = attribute_stats_[r];
+    for (uint32_t attributes = hand_attributes_[slot][r]; attributes != 0;
+         attributes &= attributes - 1) {
+      stats.wins[__builtin_ctz(attributes)]++;
+    }
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::CountShowdown(RoundStats &round_stats,
+                                           const ShowdownRanking &ranking,
+                                           const int32_t *strength,
+                                           const int *hole_hand) {
   if (args_.stats_winning_hand) {
-    round_stats.hand_win_count[players[0]->hand(round_index).sort_code()]++;
+    int index = HandValueIndex<Ranking>(strength[ranking.seat[0]]);
+    round_stats.hand_win_count[index]++;
   }
 
   if (args_.stats_hole_cards) {
-    int32_t prev_sort_code = 0;
-    for (int i = 0; i < players.size() - 1; i++) {
-      prev_sort_code = players[i]->hand(round_index).sort_code();
-      for (int j = i + 1; j < players.size(); j++) {
-        // Only increment win count for distinct hands and for each distinct
-        // pair of hands, only increment win count once. On other words,
-        // given the following four hands (AA, AA, KTo, KTo), we should not
-        // increment [AA][AA] or [KTo][KTo] and we should only increment
-        // [AA][KTo] once.
-        if (players[j]->hand(round_index).sort_code() != prev_sort_code) {
-          int win_index = hole_hand_index_[players[i]->hand(kRoundPreflop)];
-          int lose_index = hole_hand_index_[players[j]->hand(kRoundPreflop)];
-          round_stats.beat_matrix[win_index][lose_index]++;
-          prev_sort_code = players[j]->hand(round_index).sort_code();
+    for (int g = 0; g < ranking.groups; g++) {
+      int begin = ranking.group_start[g];
+      int end = ranking.group_start[g + 1];
+      for (int k = begin; k < end; k++) {
+        int hand = hole_hand[ranking.seat[k]];
+        if (g != 0) {
+          round_stats.hole_hand_losses[hand]++;
+        } else if (end - begin == 1) {
+          round_stats.hole_hand_wins[hand]++;
+        } else {
+          round_stats.hole_hand_ties[hand]++;
+        }
+        // The rest of the group tied this player, and every later group lost
+        // to it
+        for (int other = k + 1; other < end; other++) {
+          int other_hand = hole_hand[ranking.seat[other]];
+          round_stats.tie_matrix[hand][other_hand]++;
+          round_stats.tie_matrix[other_hand][hand]++;
+        }
+        for (int other = end; other < ranking.live; other++) {
+          round_stats.beat_matrix[hand][hole_hand[ranking.seat[other]]]++;
         }
       }
     }
-    round_stats
-        .hole_hand_wins[hole_hand_index_[players[0]->hand(kRoundPreflop)]]++;
   }
 }
 
-void Statistics::Collect(Round round) {
+template <typename RULES>
+void BasicStatistics<RULES>::Collect(Round round) {
   switch (round) {
   case Round::PREFLOP:
-    for (Player *player : players_) {
-      player->set_hand(kRoundPreflop, HoleHand(player->cards()));
-      hole_hand_appearance_[hole_hand_index_[player->hand(kRoundPreflop)]]++;
+    if constexpr (kHoleHandCount == 0) {
+      break;
+    }
+    for (size_t i = 0; i < players_.size(); i++) {
+      Player *player = players_[i];
+      if constexpr (std::is_same_v<RULES, HoldemRules>) {
+        seat_hole_hand_[i] = HoleHandIndex(CardToIndex(player->cards()[0]),
+                                           CardToIndex(player->cards()[1]));
+      } else {
+        HoleHand(player->cards().data(), player->mutable_hand(kRoundPreflop));
+        seat_hole_hand_[i] = hole_hand_index_.at(player->hand(kRoundPreflop));
+      }
+      hole_hand_appearance_[seat_hole_hand_[i]]++;
+    }
+    for (auto &attributes : hand_attributes_) {
+      attributes.fill(0);
     }
     break;
   case Round::FLOP:
   case Round::TURN:
   case Round::RIVER:
-    CollectRound(round);
+    (this->*collect_round_)(round);
     break;
   default:
     break;
   }
 }
 
+template <typename RULES>
+void BasicStatistics<RULES>::CollectUncontested(Round round) {
+  // Hole hands are counted preflop whether or not the hand goes further
+  if (round == Round::PREFLOP) {
+    Collect(round);
+  }
+  uncontested_[static_cast<int>(round)]++;
+  if (args_.stats_hand_attributes) {
+    for (size_t i = 0; i < players_.size(); i++) {
+      if (!players_[i]->folded()) {
+        CollectAttributeWin(i);
+      }
+    }
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::CollectBatch(Round round,
+                                          const BatchRoundView &view) {
+  int round_index = static_cast<int>(round);
+  const bool attributes = args_.stats_hand_attributes;
+  if (round == Round::PREFLOP) {
+    // Every seat dealt in counts, including those that folded preflop
+    for (int s = 0; s < view.players; s++) {
+      for (int t = 0; t < view.tables; t++) {
+        hole_hand_appearance_[view.hole_hand[s * view.stride + t]]++;
+      }
+    }
+    if (attributes) {
+      // Sized once for the batch
+      if (hand_attributes_.size() < size_t(view.tables) * kMaxPlayers) {
+        hand_attributes_.resize(view.tables * kMaxPlayers);
+      }
+      for (auto &seat_attributes : hand_attributes_) {
+        seat_attributes.fill(0);
+      }
+    }
+  }
+  RoundStats &round_stats = round_stats_[round_index];
+  RankSeatsFn rank_seats = kRankSeats[view.players];
+  for (int t = 0; t < view.tables; t++) {
+    if (view.ended[t]) {
+      continue;
+    }
+    if (__builtin_popcount(view.folded[t]) == view.players - 1) {
+      uncontested_[round_index]++;
+      if (attributes) {
+        CollectAttributeWin(t * kMaxPlayers + __builtin_ctz(~view.folded[t]));
+      }
+      continue;
+    }
+    if (round == Round::PREFLOP) {
+      continue;
+    }
+    std::array<int32_t, kMaxPlayers> strength;
+    std::array<int, kMaxPlayers> hole_hand;
+    for (int s = 0; s < view.players; s++) {
+      bool folded = (view.folded[t] & (1u << s)) != 0;
+      strength[s] = folded ? kFolded : view.strength[s * view.stride + t];
+      hole_hand[s] = view.hole_hand[s * view.stride + t];
+    }
+    ShowdownRanking ranking = rank_seats(strength);
+    CountShowdown(round_stats, ranking, strength.data(), hole_hand.data());
+    if (args_.stats_equity && round != Round::RIVER) {
+      std::array<uint64_t, kMaxPlayers> hole;
+      for (int s = 0; s < view.players; s++) {
+        hole[s] = view.hole[s * view.stride + t];
+      }
+      CollectEquity(round_index, view.players, hole.data(), hole_hand.data(),
+                    view.folded[t], view.board[t]);
+    }
+
+    if (!attributes) {
+      continue;
+    }
+    for (int s = 0; s < view.players; s++) {
+      if ((view.folded[t] & (1u << s)) != 0) {
+        continue;
+      }
+      size_t slot = t * kMaxPlayers + s;
+      if (round == Round::RIVER) {
+        if (strength[s] == strength[ranking.seat[0]]) {
+          CollectAttributeWin(slot);
+        }
+      } else {
+        CollectAttributes(round_index, slot, view.hole[s * view.stride + t],
+                          view.board[t]);
+      }
+    }
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::Merge(const BasicStatistics &other) {
+  games_ += other.games_;
+  for (int r = kRoundPreflop; r < kRoundMax; r++) {
+    uncontested_[r] += other.uncontested_[r];
+  }
+  for (int i = 0; i < kHoleHandCount; i++) {
+    hole_hand_appearance_[i] += other.hole_hand_appearance_[i];
+  }
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    for (int i = 0; i < kHandAttributeCount; i++) {
+      attribute_stats_[r].hands[i] += other.attribute_stats_[r].hands[i];
+      attribute_stats_[r].wins[i] += other.attribute_stats_[r].wins[i];
+    }
+  }
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    RoundStats &stats = round_stats_[r];
+    const RoundStats &other_stats = other.round_stats_[r];
+    assert(stats.beat_matrix.size() == other_stats.beat_matrix.size());
+    assert(stats.hand_win_count.size() == other_stats.hand_win_count.size());
+    for (size_t i = 0; i < stats.beat_matrix.size(); i++) {
+      for (int j = 0; j < kHoleHandCount; j++) {
+        stats.beat_matrix[i][j] += other_stats.beat_matrix[i][j];
+        stats.tie_matrix[i][j] += other_stats.tie_matrix[i][j];
+      }
+    }
+    for (size_t i = 0; i < stats.hole_hand_wins.size(); i++) {
+      stats.hole_hand_wins[i] += other_stats.hole_hand_wins[i];
+      stats.hole_hand_ties[i] += other_stats.hole_hand_ties[i];
+      stats.hole_hand_losses[i] += other_stats.hole_hand_losses[i];
+    }
+    for (size_t i = 0; i < stats.hand_win_count.size(); i++) {
+      stats.hand_win_count[i] += other_stats.hand_win_count[i];
+    }
+    EquityStats &equity = equity_stats_[r];
+    const EquityStats &other_equity = other.equity_stats_[r];
+    for (size_t i = 0; i < equity.hands.size(); i++) {
+      equity.equity[i] += other_equity.equity[i];
+      equity.hands[i] += other_equity.hands[i];
+    }
+  }
+}
+
 namespace {
 struct WinStatsT {
   int index{};
@@ -158,10 +493,11 @@ std::string FlushSuffix(Hand &hand) {
   return "";
 }
 void HoleHandStripeOrderApply(
-    std::ostream &os, std::function<void(std::ostream &, int, int, int)> func) {
+    std::ostream &os, int hole_hand_count,
+    std::function<void(std::ostream &, int, int, int)> func) {
   constexpr int kColumnCount = 10;
   int stripe_size =
-      std::ceil((double)Statistics::kHoleHandCount / (double)kColumnCount);
+      std::ceil((double)hole_hand_count / (double)kColumnCount);
   for (int i = 0; i < stripe_size; i++) {
     for (int j = 0; j < kColumnCount; j++) {
       if (j > 0) {
@@ -176,186 +512,381 @@ void HoleHandStripeOrderApply(
 }
 } // namespace
 
-void Statistics::Display() {
-  std::filesystem::path output_file;
-  std::ofstream fout;
-  std::vector<WinStatsT> win_stats(kHoleHandCount);
+template <typename RULES>
+void BasicStatistics<RULES>::Display() {
   if (args_.stats_hole_cards) {
-    for (int r = kRoundFlop; r < kRoundMax; r++) {
-      for (auto const &[hand, index] : hole_hand_index_) {
-        win_stats[index].index = index;
-        win_stats[index].hand = hand;
-        win_stats[index].hand_wins = 0;
+    DisplayHoleCards();
+  }
+  if (args_.stats_winning_hand) {
+    DisplayWinningHand({this}, args_);
+  }
+  if (args_.stats_hand_attributes) {
+    DisplayHandAttributes();
+  }
+  if (args_.stats_equity) {
+    DisplayEquity();
+  }
+  if (args_.stats_export) {
+    DisplayStatsFile();
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::DisplayStatsFile() const {
+  std::stringstream ss;
+  ss << "statistics-" << std::setw(2) << std::setfill('0') << args_.players
+     << "-players.pkst";
+  std::filesystem::path output_file(args_.output_dir);
+  output_file.append(ss.str());
+  try {
+    WriteStatsFile(output_file.string());
+  } catch (const std::exception &err) {
+    std::cerr << "Error: " << err.what() << std::endl;
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::WriteStatsFile(const std::string &path) const {
+  StatsFileHeader header{};
+  header.hole_cards = RULES::kHoleCards;
+  header.low_rank = Ranking::kLowRank;
+  header.players = args_.players;
+  header.small_blind = args_.small_blind;
+  header.big_blind = args_.big_blind;
+  header.stack = args_.stack;
+  header.hole_hand_count = kHoleHandCount;
+  header.hand_value_count = kHandValueCount;
+  header.games = games_;
+  StatsFileWriter writer(header);
+
+  uint64_t *column =
+      writer.AddColumn(StatsColumnId::UNCONTESTED, 0, kRoundMax);
+  std::copy(uncontested_.begin(), uncontested_.end(), column);
+  if (kHoleHandCount > 0) {
+    column = writer.AddColumn(StatsColumnId::HOLE_HAND_APPEARANCES, 0,
+                              kHoleHandCount);
+    std::copy(hole_hand_appearance_.begin(), hole_hand_appearance_.end(),
+              column);
+  }
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    const RoundStats &round_stats = round_stats_[r];
+    if (!round_stats.beat_matrix.empty()) {
+      column = writer.AddColumn(StatsColumnId::BEAT_MATRIX, r, kHoleHandCount,
+                                kHoleHandCount);
+      for (const std::vector<int32_t> &row : round_stats.beat_matrix) {
+        column = std::copy(row.begin(), row.end(), column);
+      }
+      column = writer.AddColumn(StatsColumnId::TIE_MATRIX, r, kHoleHandCount,
+                                kHoleHandCount);
+      for (const std::vector<int32_t> &row : round_stats.tie_matrix) {
+        column = std::copy(row.begin(), row.end(), column);
       }
-      RoundStats &round_stats = round_stats_[r];
+      column =
+          writer.AddColumn(StatsColumnId::HOLE_HAND_WINS, r, kHoleHandCount);
       for (int i = 0; i < kHoleHandCount; i++) {
-        for (int j = 0; j < kHoleHandCount; j++) {
-          if (round_stats.beat_matrix[i][j] > round_stats.beat_matrix[j][i]) {
-            win_stats[i].hand_wins++;
-          }
-          if ((round_stats.beat_matrix[i][j] + round_stats.beat_matrix[j][i]) ==
-              0) {
-            round_stats.win_percentage_matrix[i][j] = -1.0;
-          } else if (i == j) {
-            round_stats.win_percentage_matrix[i][j] = 0.0;
-          } else {
-            round_stats.win_percentage_matrix[i][j] =
-                100.0 * round_stats.beat_matrix[i][j] /
-                (round_stats.beat_matrix[i][j] + round_stats.beat_matrix[j][i]);
-          }
-        }
+        column[i] =
+            round_stats.hole_hand_wins[i] + round_stats.hole_hand_ties[i];
       }
-      std::sort(win_stats.begin(), win_stats.end(),
-                [](const WinStatsT &lhs, const WinStatsT &rhs) {
-                  return lhs.hand_wins > rhs.hand_wins;
-                });
-
-      output_file = std::filesystem::path(args_.output_dir);
-      std::stringstream ss;
-      ss << "hole-cards-win-rank-" << kRound[r] << ".csv";
-      output_file.append(ss.str());
-      fout = std::ofstream(output_file);
-      auto output_wins_fn = [&](std::ostream &os, int i, int j,
-                                int stripe_size) {
-        int offset = i + (j * stripe_size);
-        if (offset < kHoleHandCount) {
-          WinStatsT &stats = win_stats[offset];
-          os << HoleHandToString(stats.hand) << "," << stats.hand_wins;
-        } else {
-          os << ",";
-        }
-      };
-      HoleHandStripeOrderApply(fout, output_wins_fn);
-      fout.close();
+      column = writer.AddColumn(StatsColumnId::HOLE_HAND_OUTRIGHT_WINS, r,
+                                kHoleHandCount);
+      std::copy(round_stats.hole_hand_wins.begin(),
+                round_stats.hole_hand_wins.end(), column);
+      column =
+          writer.AddColumn(StatsColumnId::HOLE_HAND_TIES, r, kHoleHandCount);
+      std::copy(round_stats.hole_hand_ties.begin(),
+                round_stats.hole_hand_ties.end(), column);
+      column =
+          writer.AddColumn(StatsColumnId::HOLE_HAND_LOSSES, r, kHoleHandCount);
+      std::copy(round_stats.hole_hand_losses.begin(),
+                round_stats.hole_hand_losses.end(), column);
+    }
+    if (!round_stats.hand_win_count.empty()) {
+      column = writer.AddColumn(StatsColumnId::HAND_VALUE_WINS, r,
+                                kHandValueCount);
+      std::copy(round_stats.hand_win_count.begin(),
+                round_stats.hand_win_count.end(), column);
+      column =
+          writer.AddColumn(StatsColumnId::HAND_TYPE_WINS, r, kHandTypeMax);
+      for (int index = 0; index < kHandValueCount; index++) {
+        column[static_cast<int>(SortCodeHandType<Ranking>(
+            HandValueSortCode<Ranking>(index)))] +=
+            round_stats.hand_win_count[index];
+      }
+    }
+  }
+  if (args_.stats_hand_attributes) {
+    for (int r = kRoundFlop; r < kRoundRiver; r++) {
+      const AttributeStats &stats = attribute_stats_[r];
+      column = writer.AddColumn(StatsColumnId::ATTRIBUTE_HANDS, r,
+                                kHandAttributeCount);
+      std::copy(stats.hands.begin(), stats.hands.end(), column);
+      column = writer.AddColumn(StatsColumnId::ATTRIBUTE_WINS, r,
+                                kHandAttributeCount);
+      std::copy(stats.wins.begin(), stats.wins.end(), column);
     }
+  }
+  writer.Write(path);
+}
 
-    //
-    // Win percentage
-    //
-    output_file = std::filesystem::path(args_.output_dir);
-    output_file.append("hole-cards-vs-other-hole-cards-win-pct.csv");
-    fout = std::ofstream(output_file);
-    fout << std::fixed << std::setprecision(2);
-    for (WinStatsT &stats : win_stats) {
-      fout << HoleHandToString(stats.hand) << std::endl;
-      // TODO: just set this to win_stats;
-      std::vector<WinStatsT> win_stats_sorted(kHoleHandCount);
-      for (auto const &[hand, index] : hole_hand_index_) {
-        win_stats_sorted[index].index = index;
-        win_stats_sorted[index].hand = hand;
-        win_stats_sorted[index].hand_wins = 0;
-        win_stats_sorted[index].win_percentage =
-            round_stats_[kRoundRiver].win_percentage_matrix[stats.index][index];
+template <typename RULES>
+void BasicStatistics<RULES>::DisplayHandAttributes() {
+  std::stringstream ss;
+  ss << "hand-attributes-win-pct-";
+  ss << std::setw(2) << std::setfill('0') << args_.players << "-players.csv";
+  std::filesystem::path output_file(args_.output_dir);
+  output_file.append(ss.str());
+  std::ofstream fout(output_file);
+  fout << "Attribute,Flop Hands,Flop Win %,Turn Hands,Turn Win %\n";
+  fout << std::fixed << std::setprecision(2);
+  for (int i = 0; i < kHandAttributeCount; i++) {
+    fout << HandAttributeName(i);
+    for (int r = kRoundFlop; r < kRoundRiver; r++) {
+      const AttributeStats &stats = attribute_stats_[r];
+      fout << "," << stats.hands[i] << ",";
+      if (stats.hands[i] != 0) {
+        fout << (100.0 * stats.wins[i]) / stats.hands[i];
       }
-      std::sort(win_stats_sorted.begin(), win_stats_sorted.end(),
-                [](const WinStatsT &lhs, const WinStatsT &rhs) {
-                  return lhs.win_percentage < rhs.win_percentage;
-                });
-
-      auto output_win_pct_fn = [&](std::ostream &os, int i, int j,
-                                   int stripe_size) {
-        int offset = i + (j * stripe_size);
-        if (offset < win_stats_sorted.size()) {
-          os << HoleHandToString(win_stats_sorted[offset].hand) << ","
-             << win_stats_sorted[offset].win_percentage;
+    }
+    fout << "\n";
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::DisplayEquity() {
+  std::stringstream ss;
+  ss << "hole-cards-equity-";
+  ss << std::setw(2) << std::setfill('0') << args_.players << "-players.csv";
+  std::filesystem::path output_file(args_.output_dir);
+  output_file.append(ss.str());
+  std::ofstream fout(output_file);
+  std::vector<Hand> hands(kHoleHandCount);
+  for (auto const &[hand, index] : hole_hand_index_) {
+    hands[index] = hand;
+  }
+  fout << "Hand,Flop Hands,Flop Equity %,Turn Hands,Turn Equity %\n";
+  fout << std::fixed << std::setprecision(2);
+  for (int i = 0; i < kHoleHandCount; i++) {
+    fout << HoleHandToString(hands[i]);
+    for (int r = kRoundFlop; r < kRoundRiver; r++) {
+      fout << "," << equity_stats_[r].hands[i] << ",";
+      if (equity_stats_[r].hands[i] != 0) {
+        fout << 100.0 * HoleHandEquity(static_cast<Round>(r), i);
+      }
+    }
+    fout << "\n";
+  }
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::DisplayHoleCards() {
+  std::filesystem::path output_file;
+  std::ofstream fout;
+  std::vector<WinStatsT> win_stats(kHoleHandCount);
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    for (auto const &[hand, index] : hole_hand_index_) {
+      win_stats[index].index = index;
+      win_stats[index].hand = hand;
+      win_stats[index].hand_wins = 0;
+    }
+    RoundStats &round_stats = round_stats_[r];
+    for (int i = 0; i < kHoleHandCount; i++) {
+      for (int j = 0; j < kHoleHandCount; j++) {
+        int32_t wins = round_stats.beat_matrix[i][j];
+        int32_t losses = round_stats.beat_matrix[j][i];
+        int32_t ties = round_stats.tie_matrix[i][j];
+        if (wins > losses) {
+          win_stats[i].hand_wins++;
+        }
+        if (wins + losses + ties == 0) {
+          round_stats.win_percentage_matrix[i][j] = -1.0;
+        } else if (i == j) {
+          round_stats.win_percentage_matrix[i][j] = 0.0;
         } else {
-          os << ",";
+          // A tie is half a win
+          round_stats.win_percentage_matrix[i][j] =
+              100.0 * (wins + 0.5 * ties) / (wins + losses + ties);
         }
-      };
-      HoleHandStripeOrderApply(fout, output_win_pct_fn);
+      }
     }
-    fout.close();
+    std::sort(win_stats.begin(), win_stats.end(),
+              [](const WinStatsT &lhs, const WinStatsT &rhs) {
+                return lhs.hand_wins > rhs.hand_wins;
+              });
 
-    //
-    // Hole Cards With Percentage at Showdown
-    //
-    std::stringstream ss;
-    ss << "hole-cards-win-pct-";
-    ss << std::setw(2) << std::setfill('0') << args_.players << "-players.csv";
     output_file = std::filesystem::path(args_.output_dir);
+    std::stringstream ss;
+    ss << "hole-cards-win-rank-" << kRound[r] << ".csv";
     output_file.append(ss.str());
     fout = std::ofstream(output_file);
-    fout << std::fixed << std::setprecision(2);
-    for (WinStatsT &stats : win_stats) {
-      stats.win_percentage =
-          (100.0 * round_stats_[kRoundRiver].hole_hand_wins[stats.index]) /
-          (double)hole_hand_appearance_[stats.index];
-    }
-    std::sort(win_stats.begin(), win_stats.end(),
-              [](const WinStatsT &lhs, const WinStatsT &rhs) {
-                return lhs.win_percentage > rhs.win_percentage;
-              });
-    auto output_win_pct_showdown_fn = [&](std::ostream &os, int i, int j,
-                                          int stripe_size) {
+    auto output_wins_fn = [&](std::ostream &os, int i, int j,
+                              int stripe_size) {
       int offset = i + (j * stripe_size);
       if (offset < kHoleHandCount) {
         WinStatsT &stats = win_stats[offset];
-        fout << HoleHandToString(stats.hand) << "," << stats.win_percentage;
+        os << HoleHandToString(stats.hand) << "," << stats.hand_wins;
       } else {
-        fout << ",";
+        os << ",";
       }
     };
-    HoleHandStripeOrderApply(fout, output_win_pct_showdown_fn);
+    HoleHandStripeOrderApply(fout, kHoleHandCount, output_wins_fn);
     fout.close();
   }
-  if (args_.stats_winning_hand) {
-    Hand hand;
-    int median = args_.iterations / 2;
-    HandTypeWinStats hand_type_stats[kRoundMax];
-    for (int r = 1; r < kRoundMax; r++) {
-      hand_type_stats[r].wins = std::vector<int>(kHandTypeMax, 0);
+
+  //
+  // Win percentage
+  //
+  output_file = std::filesystem::path(args_.output_dir);
+  output_file.append("hole-cards-vs-other-hole-cards-win-pct.csv");
+  fout = std::ofstream(output_file);
+  fout << std::fixed << std::setprecision(2);
+  for (WinStatsT &stats : win_stats) {
+    fout << HoleHandToString(stats.hand) << std::endl;
+    // TODO: just set this to win_stats;
+    std::vector<WinStatsT> win_stats_sorted(kHoleHandCount);
+    for (auto const &[hand, index] : hole_hand_index_) {
+      win_stats_sorted[index].index = index;
+      win_stats_sorted[index].hand = hand;
+      win_stats_sorted[index].hand_wins = 0;
+      win_stats_sorted[index].win_percentage =
+          round_stats_[kRoundRiver].win_percentage_matrix[stats.index][index];
     }
+    std::sort(win_stats_sorted.begin(), win_stats_sorted.end(),
+              [](const WinStatsT &lhs, const WinStatsT &rhs) {
+                return lhs.win_percentage < rhs.win_percentage;
+              });
 
-    for (uint32_t sort_code = 0; sort_code < kSortCodeLimit; sort_code++) {
-      if (round_stats_[kRoundFlop].hand_win_count[sort_code] == 0 &&
-          round_stats_[kRoundTurn].hand_win_count[sort_code] == 0 &&
-          round_stats_[kRoundRiver].hand_win_count[sort_code] == 0)
-        continue;
-      hand = SortCodeToHand(sort_code);
-      for (int r = kRoundFlop; r < kRoundMax; r++) {
-        RoundStats &round_stats = round_stats_[r];
-        if (round_stats.hand_win_count[sort_code] != 0) {
-          hand_type_stats[r].wins[static_cast<int>(hand.type())] +=
-              round_stats.hand_win_count[sort_code];
-          hand_type_stats[r].count += round_stats.hand_win_count[sort_code];
-          if (hand_type_stats[r].median_offset == 0 &&
-              hand_type_stats[r].count >= median) {
-            hand_type_stats[r].median_offset = sort_code;
-          }
+    auto output_win_pct_fn = [&](std::ostream &os, int i, int j,
+                                 int stripe_size) {
+      int offset = i + (j * stripe_size);
+      if (offset < win_stats_sorted.size()) {
+        os << HoleHandToString(win_stats_sorted[offset].hand) << ","
+           << win_stats_sorted[offset].win_percentage;
+      } else {
+        os << ",";
+      }
+    };
+    HoleHandStripeOrderApply(fout, kHoleHandCount, output_win_pct_fn);
+  }
+  fout.close();
+
+  //
+  // Hole Cards With Percentage at Showdown
+  //
+  std::stringstream ss;
+  ss << "hole-cards-win-pct-";
+  ss << std::setw(2) << std::setfill('0') << args_.players << "-players.csv";
+  output_file = std::filesystem::path(args_.output_dir);
+  output_file.append(ss.str());
+  fout = std::ofstream(output_file);
+  fout << std::fixed << std::setprecision(2);
+  const RoundStats &river = round_stats_[kRoundRiver];
+  for (WinStatsT &stats : win_stats) {
+    // A split pot counts as half a win
+    stats.win_percentage = 100.0 *
+        (river.hole_hand_wins[stats.index] +
+         0.5 * river.hole_hand_ties[stats.index]) /
+        hole_hand_appearance_[stats.index];
+  }
+  std::sort(win_stats.begin(), win_stats.end(),
+            [](const WinStatsT &lhs, const WinStatsT &rhs) {
+              return lhs.win_percentage > rhs.win_percentage;
+            });
+  auto output_win_pct_showdown_fn = [&](std::ostream &os, int i, int j,
+                                        int stripe_size) {
+    int offset = i + (j * stripe_size);
+    if (offset < kHoleHandCount) {
+      WinStatsT &stats = win_stats[offset];
+      fout << HoleHandToString(stats.hand) << "," << stats.win_percentage;
+    } else {
+      fout << ",";
+    }
+  };
+  HoleHandStripeOrderApply(fout, kHoleHandCount, output_win_pct_showdown_fn);
+  fout.close();
+}
+
+template <typename RULES>
+void BasicStatistics<RULES>::ComputeHandTypeWinStats(
+    HandTypeWinStats hand_type_stats[kRoundMax]) const {
+  // The median is taken over the hands that reached each round's showdown
+  uint64_t median[kRoundMax] = {};
+  uint64_t uncontested = uncontested_[kRoundPreflop];
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    hand_type_stats[r].wins = std::vector<int64_t>(kHandTypeMax, 0);
+    uncontested += uncontested_[r];
+    median[r] = (games_ - uncontested) / 2;
+  }
+  for (int index = 0; index < kHandValueCount; index++) {
+    if (round_stats_[kRoundFlop].hand_win_count[index] == 0 &&
+        round_stats_[kRoundTurn].hand_win_count[index] == 0 &&
+        round_stats_[kRoundRiver].hand_win_count[index] == 0)
+      continue;
+    int32_t sort_code = HandValueSortCode<Ranking>(index);
+    int type = SortCodeHandType<Ranking>(sort_code);
+    for (int r = kRoundFlop; r < kRoundMax; r++) {
+      const RoundStats &round_stats = round_stats_[r];
+      if (round_stats.hand_win_count[index] != 0) {
+        hand_type_stats[r].wins[type] += round_stats.hand_win_count[index];
+        hand_type_stats[r].count += round_stats.hand_win_count[index];
+        if (hand_type_stats[r].median_offset == 0 &&
+            hand_type_stats[r].count >= median[r]) {
+          hand_type_stats[r].median_offset = sort_code;
         }
       }
     }
+  }
+}
 
-    std::string flush_suffix;
+template <typename RULES>
+void BasicStatistics<RULES>::DisplayWinningHand(
+    const std::vector<const BasicStatistics *> &stats,
+    const PokerSimulationArgs &args) {
+  std::vector<std::array<HandTypeWinStats, kRoundMax>> hand_type_stats(
+      stats.size());
+  for (size_t i = 0; i < stats.size(); i++) {
+    stats[i]->ComputeHandTypeWinStats(hand_type_stats[i].data());
+  }
 
-    // Winning hand distribution
-    for (int r = kRoundFlop; r < kRoundMax; r++) {
-      output_file = std::filesystem::path(args_.output_dir);
-      std::stringstream ss;
-      ss << "winning-hand-distribution-" << kRound[r] << ".csv";
-      output_file.append(ss.str());
-      if (args_.append_output) {
-        fout = std::ofstream(output_file, std::ios::app);
-      } else {
-        fout = std::ofstream(output_file);
-        fout << "Players,High Card,One Pair,Two Pair,Three Of A "
-                "Kind,Straight,Flush,Full House,Four Of A Kind,Straight "
-                "Flush,Median\n";
+  Hand hand;
+  std::string flush_suffix;
+  std::filesystem::path output_file;
+  std::ofstream fout;
+
+  // Winning hand distribution, one row per statistics object
+  for (int r = kRoundFlop; r < kRoundMax; r++) {
+    output_file = std::filesystem::path(args.output_dir);
+    std::stringstream ss;
+    ss << "winning-hand-distribution-" << kRound[r] << ".csv";
+    output_file.append(ss.str());
+    if (args.append_output) {
+      fout = std::ofstream(output_file, std::ios::app);
+    } else {
+      fout = std::ofstream(output_file);
+      fout << "Players,High Card,One Pair,Two Pair,Three Of A "
+              "Kind,Straight,Flush,Full House,Four Of A Kind,Straight "
+              "Flush,Median,Uncontested\n";
+    }
+    for (size_t s = 0; s < stats.size(); s++) {
+      const HandTypeWinStats &type_stats = hand_type_stats[s][r];
+      // Hands that ended uncontested in this round or earlier
+      uint64_t uncontested = 0;
+      for (int u = kRoundPreflop; u <= r; u++) {
+        uncontested += stats[s]->uncontested_[u];
       }
-      fout << table_->players().size() << ",";
+      fout << stats[s]->args_.players << ",";
       fout << std::fixed << std::setprecision(3);
       for (int i = 1; i < 10; i++) {
-        double percentage =
-            (hand_type_stats[r].wins[i] * 100.0) / args_.iterations;
+        double percentage = (type_stats.wins[i] * 100.0) / stats[s]->games_;
         fout << percentage << ",";
       }
-      hand = SortCodeToHand(hand_type_stats[r].median_offset);
+      hand = SortCodeToHand(
+          StandardSortCode<Ranking>(type_stats.median_offset));
       flush_suffix = FlushSuffix(hand);
       hand.set_type(HandType::HANDTYPE_UNSPECIFIED);
-      fout << hand << flush_suffix << std::endl;
-      fout.close();
+      fout << hand << flush_suffix << ","
+           << (uncontested * 100.0) / stats[s]->games_ << "\n";
     }
-    fout << std::flush;
+    fout.close();
   }
 }
 
@@ -371,7 +902,7 @@ void Statistics::Display() {
         deviation += (i - median_offset_river) * hand_win_count_river_[i];
       }
     }
-    uint32_t stddev = deviation / args_.iterations;
+    uint32_t stddev = deviation / games_;
     uint32_t minus_stddev_offset = median_offset_river - stddev;
     while (hand_win_count_river_[minus_stddev_offset] == 0) {
       minus_stddev_offset--;
@@ -392,4 +923,8 @@ void Statistics::Display() {
     os << "," << hand << flush_suffix << std::endl;
 #endif
 
+template class BasicStatistics<HoldemRules>;
+template class BasicStatistics<omaha::Rules>;
+template class BasicStatistics<short_deck::Rules>;
+
 } // namespace poker::holdem
@@ -1,52 +1,167 @@
 #ifndef HOLDEM_STATS_H
 #define HOLDEM_STATS_H
 
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "cards.pb.h"
+#include "fixed_vector.h"
+#include "hand_attributes.h"
 #include "holdem.h"
+#include "holdem_batch.h"
 #include "poker.pb.h"
 #include "poker_simulation_args.h"
 
 namespace poker::holdem {
 
-class Statistics {
+// Collects the statistics of a simulation of the game RULES (see
+// HoldemRules), which fixes at compile time how showdowns are evaluated and
+// the sizes of the hole hand and hand value counters.  Instantiated in
+// holdem_stats.cc for hold'em, Omaha and short-deck.
+template <typename RULES>
+class BasicStatistics {
 public:
-  Statistics(PokerSimulationArgs& args);
+  BasicStatistics(PokerSimulationArgs& args);
   void NewGame(const poker::Table& table, std::vector<Player>& players);
   void Collect(Round round);
+  // Called instead of Collect(round) when everyone but one player folded in
+  // round's betting, which ends the hand there.
+  void CollectUncontested(Round round);
   void Display();
 
-  static constexpr int kHoleHandCount = 169;
+  // Collector interface for BatchGame.
+  void NewGames(int count) { games_ += count; }
+  void CollectBatch(Round round, const BatchRoundView& view);
+
+  // Writes the hole cards statistics files (part of Display()).
+  void DisplayHoleCards();
+  // Writes the hand attribute statistics file (part of Display()).
+  void DisplayHandAttributes();
+  // Writes the hole hand equity file (part of Display() with
+  // --stats:equity).
+  void DisplayEquity();
+  // Writes the counters collected as a stats file in the output directory
+  // (part of Display() with --stats:export).
+  void DisplayStatsFile() const;
+  // Writes the counters collected as a stats file (see stats_file.h) to
+  // path.  Throws std::runtime_error if it can't be written.
+  void WriteStatsFile(const std::string &path) const;
+
+  // Adds the counters collected by other, which must have been constructed
+  // with the same statistics options, into this object.  Used to combine
+  // per-thread shards.
+  void Merge(const BasicStatistics& other);
+
+  // Writes the winning hand distribution files with one row per element of
+  // stats (e.g. one per player count in a sweep), in that order.
+  static void DisplayWinningHand(
+      const std::vector<const BasicStatistics*>& stats,
+      const PokerSimulationArgs& args);
+
+  // Average showdown equity of hole_hand on the flop or turn (see
+  // --stats:equity), or 0 if it never saw that round.
+  double HoleHandEquity(Round round, int hole_hand) const;
+
+  // Number of games played, i.e. calls to NewGame().  Output is normalized by
+  // this rather than by the requested iteration count.
+  uint64_t games() const { return games_; }
+
+  using Ranking = typename RULES::Ranking;
+  static constexpr int kHoleHandCount = RULES::kHoleHandCount;
+  static constexpr int kHandValueCount = Ranking::kHandValueCount;
   static constexpr int kSortCodeLimit = 10'415'855;
 
 private:
   PokerSimulationArgs args_;
-  const Table* table_;
-  std::vector<Player*> players_;
-  std::unordered_map<Hand, int> hole_hand_index_;
+  uint64_t games_{};
+
+  const Table* table_{};
+  FixedVector<Player*, kMaxPlayers> players_;
+  // Hole hand index of each of players_, set preflop
+  std::array<int, kMaxPlayers> seat_hole_hand_{};
+  const std::unordered_map<Hand, int>& hole_hand_index_;
 
   // Vector to hold the number of times each hole hand appeared in a game.
   std::vector<int32_t> hole_hand_appearance_;
+  // Number of hands that ended uncontested in each round.
+  std::array<uint64_t, kRoundMax> uncontested_{};
+
+  // Hands in which a player had each HandAttribute after the flop or turn
+  // betting, and how many of them that player went on to win (or split).
+  struct AttributeStats {
+    std::array<uint64_t, kHandAttributeCount> hands{};
+    std::array<uint64_t, kHandAttributeCount> wins{};
+  };
+  std::array<AttributeStats, kRoundMax> attribute_stats_;
+  // Flop and turn attributes of each player in the current hand, by seat, or
+  // for BatchGame by table * kMaxPlayers + seat.
+  std::vector<std::array<uint8_t, kRoundMax>> hand_attributes_;
+
+  // Equity of each hole hand still in the hand on the flop and turn, summed
+  // over the hands it was collected in.  Each is enumerated exactly over the
+  // rest of the board with the folded hands dead (see EnumerateEquity()),
+  // rather than scored on the one runout the hand was dealt.
+  struct EquityStats {
+    std::vector<double> equity;
+    std::vector<uint64_t> hands;
+  };
+  std::array<EquityStats, kRoundMax> equity_stats_;
+
+  // Collects the equity of the seats not in folded (a bit set) with hole
+  // cards hole and hole hand indexes hole_hand, on board.
+  void CollectEquity(int round, int seats, const uint64_t* hole,
+                     const int* hole_hand, uint32_t folded, uint64_t board);
 
+  void CollectAttributes(int round, size_t slot, uint64_t hole,
+                         uint64_t board);
+  void CollectAttributeWin(size_t slot);
+
+  // Showdown counters.  A showdown with n players counts every one of its
+  // n * (n - 1) / 2 pairs of players once, as a win for the stronger hand or
+  // a tie, and every player once, as a win, a tie (a split pot) or a loss.
   struct RoundStats {
+    // [stronger][weaker] hole hand
     std::vector<std::vector<int32_t>> beat_matrix;
+    // Hole hands that tied, counted in both orders
+    std::vector<std::vector<int32_t>> tie_matrix;
     std::vector<int32_t> hand_win_count;
     std::vector<int32_t> hole_hand_wins;
+    std::vector<int32_t> hole_hand_ties;
+    std::vector<int32_t> hole_hand_losses;
     std::vector<std::vector<float>> win_percentage_matrix;
   };
 
   RoundStats round_stats_[kRoundMax];
 
+  // Collects a flop, turn or river showdown between the PLAYERS players of
+  // the current game.  NewGame() picks the instantiation for the number of
+  // players once, so the showdown is ranked by a sorting network of that
+  // size (see RankShowdown()).
+  template <int PLAYERS>
   void CollectRound(Round round);
+  using CollectRoundFn = void (BasicStatistics::*)(Round round);
+  CollectRoundFn collect_round_{};
+
+  // Records the showdown ranked by ranking, given each seat's strength and
+  // hole hand index.
+  void CountShowdown(RoundStats& round_stats, const ShowdownRanking& ranking,
+                     const int32_t* strength, const int* hole_hand);
 
   struct HandTypeWinStats {
-    std::vector<int32_t> wins;
-    uint32_t count{};
+    std::vector<int64_t> wins;
+    uint64_t count{};
     uint32_t median_offset{};
   };
+
+  void ComputeHandTypeWinStats(
+      HandTypeWinStats hand_type_stats[kRoundMax]) const;
 };
 
+using Statistics = BasicStatistics<HoldemRules>;
+
 } // namespace poker::holdem
 
 #endif // HOLDEM_STATS_H
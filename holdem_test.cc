@@ -1,17 +1,63 @@
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 
+#include "card_mask.h"
 #include "cards.h"
 #include "cards.pb.h"
+#include "equity.h"
+#include "equity_service.h"
+#include "hand_history.h"
+#include "hand_import.h"
+#include "hand_index.h"
+#include "hand_strength.h"
+#include "holdem.h"
+#include "holdem_batch.h"
+#include "holdem_state.h"
+#include "holdem_stats.h"
+#include "omaha.h"
+#include "player_model_holdem.h"
 #include "poker.h"
 #include "poker.pb.h"
+#include "poker_c.h"
+#include "poker_simulation_args.h"
+#include "stats_file.h"
 #include <google/protobuf/text_format.h>
 
 namespace {
   using ::google::protobuf::TextFormat;
+  using poker::holdem::NullStatistics;
+
+  std::atomic<int64_t> allocation_count{0};
+}
+
+// Count heap allocations so tests can check the steady-state hand loop.  The
+// replacements are kept out of line so the compiler never pairs a new
+// expression with the free() inside operator delete.
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocation_count++;
+  void* ptr = std::malloc(size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+__attribute__((noinline)) void operator delete(void* ptr, size_t) noexcept {
+  std::free(ptr);
 }
 
 class PokerTest : public testing::Test {
@@ -241,3 +287,1140 @@ TEST_F(PokerTest, HoldemHandEvaluator) {
         "rank: TEN suit: SPADES"}));
   EXPECT_EQ(ComputeHand(), "straight-flush AKQJT");
 }
+
+TEST(HoldemGameTest, SteadyStateHandDoesNotAllocate) {
+  PokerSimulationArgs args;
+  args.players = 6;
+  args.stats_winning_hand = true;
+  args.stats_hole_cards = true;
+  args.stats_hand_attributes = true;
+
+  poker::Table table;
+  std::vector<poker::Player> players(args.players);
+  poker::holdem::PlayerModelVector player_models;
+  for (int i = 0; i < args.players; i++) {
+    player_models.push_back(
+        std::make_unique<poker::holdem::PlayerModelShowdown>());
+  }
+  poker::holdem::Statistics stats(args);
+  std::mt19937 rng(1);
+  poker::holdem::Game<std::mt19937, poker::holdem::Statistics> game(
+      table, players, std::move(player_models), stats, rng);
+
+  // Warm up (first hands size the hand protos' rank storage)
+  for (int i = 0; i < 100; i++) {
+    game.Play();
+  }
+  int64_t allocations = allocation_count;
+  for (int i = 0; i < 10000; i++) {
+    game.Play();
+  }
+  EXPECT_EQ(allocation_count - allocations, 0);
+  EXPECT_EQ(stats.games(), 10100);
+}
+
+TEST(HoldemGameTest, HoleHandIndex) {
+  auto index = [](const char* card1, const char* card2) {
+    Card c1, c2;
+    EXPECT_TRUE(TextFormat::ParseFromString(card1, &c1));
+    EXPECT_TRUE(TextFormat::ParseFromString(card2, &c2));
+    return poker::holdem::HoleHandIndex(poker::CardToIndex(c1),
+                                        poker::CardToIndex(c2));
+  };
+  EXPECT_EQ(index("rank: ACE suit: SPADES", "rank: ACE suit: HEARTS"), 0);
+  EXPECT_EQ(index("rank: KING suit: CLUBS", "rank: ACE suit: CLUBS"), 1);
+  EXPECT_EQ(index("rank: ACE suit: CLUBS", "rank: KING suit: HEARTS"), 2);
+  EXPECT_EQ(index("rank: KING suit: CLUBS", "rank: KING suit: HEARTS"), 25);
+  EXPECT_EQ(index("rank: TWO suit: CLUBS", "rank: TWO suit: HEARTS"), 168);
+
+  // Same hole hand <=> same index
+  std::unordered_map<int32_t, int> index_by_sort_code;
+  for (int c1 = 0; c1 < poker::kCardCount; c1++) {
+    for (int c2 = 0; c2 < poker::kCardCount; c2++) {
+      if (c1 == c2)
+        continue;
+      poker::Hand hand = poker::holdem::HoleHand(
+          {poker::IndexToCard(c1), poker::IndexToCard(c2)});
+      int i = poker::holdem::HoleHandIndex(c1, c2);
+      auto [iter, inserted] = index_by_sort_code.emplace(hand.sort_code(), i);
+      ASSERT_EQ(iter->second, i);
+    }
+  }
+  EXPECT_EQ(index_by_sort_code.size(), poker::holdem::kHoleHandCount);
+}
+
+TEST(HoldemGameTest, RankShowdown) {
+  using namespace poker::holdem;
+  // AA, AA, KTo, KTo on a board where the pairs of aces and of kings tie,
+  // with a folded seat between them
+  ShowdownRanking ranking =
+      RankShowdown(std::array<int32_t, 5>{900, 900, kFolded, 500, 500});
+  ASSERT_EQ(ranking.live, 4);
+  ASSERT_EQ(ranking.groups, 2);
+  EXPECT_EQ(ranking.group_start[0], 0);
+  EXPECT_EQ(ranking.group_start[1], 2);
+  EXPECT_EQ(ranking.group_start[2], 4);
+  EXPECT_EQ(ranking.seat[0], 0);
+  EXPECT_EQ(ranking.seat[1], 1);
+  EXPECT_EQ(ranking.seat[2], 3);
+  EXPECT_EQ(ranking.seat[3], 4);
+
+  ranking = RankShowdown(std::array<int32_t, 3>{100, 300, 200});
+  ASSERT_EQ(ranking.groups, 3);
+  EXPECT_EQ(ranking.seat[0], 1);
+  EXPECT_EQ(ranking.seat[1], 2);
+  EXPECT_EQ(ranking.seat[2], 0);
+}
+
+TEST(HoldemGameTest, BatchGame) {
+  PokerSimulationArgs args;
+  args.players = 9;
+  args.stats_winning_hand = true;
+  args.stats_hole_cards = true;
+  args.stats_hand_attributes = true;
+
+  poker::holdem::Statistics stats(args);
+  std::mt19937 rng(1);
+  poker::holdem::BatchGame<std::mt19937, poker::holdem::Statistics, 8> game(
+      args.players, stats, rng);
+  for (int i = 0; i < 100; i++) {
+    game.Play();
+  }
+  int64_t allocations = allocation_count;
+  for (int i = 0; i < 1000; i++) {
+    game.Play();
+  }
+  EXPECT_EQ(allocation_count - allocations, 0);
+  EXPECT_EQ(stats.games(), 1100 * 8);
+}
+
+namespace {
+
+// Plays a fixed action at every decision.
+class FixedActionModel : public poker::holdem::PlayerModel {
+ public:
+  explicit FixedActionModel(poker::PlayerAction action) : action_(action) {}
+  poker::PlayerAction Act(const poker::Table&, poker::holdem::Round, int,
+                          poker::Player&) override {
+    return action_;
+  }
+ private:
+  poker::PlayerAction action_;
+};
+
+template <typename RULES = poker::holdem::HoldemRules>
+struct BettingTable {
+  BettingTable(int player_count, poker::PlayerAction action,
+               const poker::Stakes& stakes = {})
+      : players(player_count), rng(1) {
+    table.set_stakes(stakes);
+    poker::holdem::PlayerModelVector models;
+    for (int i = 0; i < player_count; i++) {
+      models.push_back(std::make_unique<FixedActionModel>(action));
+    }
+    game = std::make_unique<Game>(table, players, std::move(models), stats,
+                                  rng);
+  }
+
+  using Game = poker::holdem::Game<std::mt19937, NullStatistics,
+                                   poker::holdem::PlayerModels, RULES>;
+  poker::Table table;
+  std::vector<poker::Player> players;
+  NullStatistics stats;
+  std::mt19937 rng;
+  std::unique_ptr<Game> game;
+};
+
+} // namespace
+
+TEST(HoldemGameTest, EveryoneFoldsToTheBigBlind) {
+  BettingTable t(6, poker::PlayerAction::FOLD);
+  for (int hand = 0; hand < 20; hand++) {
+    t.game->Play();
+    EXPECT_EQ(t.table.pot(), 3);
+    EXPECT_EQ(t.table.action_log().size(), 5u);
+    // The hand ends preflop
+    EXPECT_TRUE(t.table.community_cards().empty());
+    int winners = 0;
+    for (const poker::Player& player : t.players) {
+      if (!player.folded()) {
+        winners++;
+        EXPECT_EQ(player.total_bet(), 2);
+        EXPECT_EQ(player.winnings(), 3);
+      }
+    }
+    EXPECT_EQ(winners, 1);
+  }
+}
+
+TEST(HoldemGameTest, RaisesContinueUntilEveryoneIsAllIn) {
+  // 250 big blinds, the deepest stacks the action log has room for
+  poker::Stakes stakes;
+  stakes.stack = 500;
+  BettingTable t(10, poker::PlayerAction::RAISE, stakes);
+  t.game->Play();
+  // Preflop min raises of 2 take the bet from 2 to 498, the last one shoves
+  // and everyone else calls all-in.
+  int raises = 0;
+  int all_ins = 0;
+  for (const poker::ActionLogEntry& entry : t.table.action_log()) {
+    raises += entry.action == poker::PlayerAction::RAISE;
+    all_ins += entry.action == poker::PlayerAction::RAISE_ALL_IN;
+  }
+  EXPECT_EQ(raises, 248);
+  EXPECT_EQ(all_ins, 1);
+  EXPECT_EQ(t.table.action_log().size(), 248u + 1 + 9);
+  EXPECT_EQ(t.table.pot(), 10 * 500);
+  int winnings = 0;
+  for (const poker::Player& player : t.players) {
+    EXPECT_TRUE(player.all_in());
+    winnings += player.winnings();
+  }
+  EXPECT_EQ(winnings, t.table.pot());
+
+  // More than 255 actions in a round survive a hand history
+  using namespace poker::holdem;
+  const std::string path = testing::TempDir() + "/hand_history_deep.phh";
+  {
+    HandHistoryWriter writer(
+        path, MakeHandHistoryHeader<HoldemRules>(10, stakes, false));
+    writer.Write(t.table, t.players);
+  }
+  HandHistoryReader reader(path);
+  HandRecord hand;
+  ASSERT_TRUE(reader.Next(&hand));
+  ASSERT_EQ(hand.actions.size(), t.table.action_log().size());
+  EXPECT_EQ(hand.actions[257].amount, 500);
+}
+
+TEST(HoldemGameTest, AllInSidePots) {
+  poker::Stakes stakes;
+  for (int stack : {300, 100, 50}) {
+    stakes.seat_stacks.push_back(stack);
+  }
+  BettingTable t(3, poker::PlayerAction::RAISE_ALL_IN, stakes);
+  for (int hand = 0; hand < 1000; hand++) {
+    t.game->Play();
+    ASSERT_EQ(t.table.pot(), 450);
+    // The main pot is 3 x 50, the side pot 2 x 50 and 200 is uncalled.
+    EXPECT_LE(t.players[2].winnings(), 150);
+    EXPECT_LE(t.players[1].winnings(), 250);
+    EXPECT_GE(t.players[0].winnings(), 200);
+    int winnings = 0;
+    for (const poker::Player& player : t.players) {
+      EXPECT_TRUE(player.all_in());
+      winnings += player.winnings();
+    }
+    EXPECT_EQ(winnings, 450);
+    // A shove that doesn't raise the bet is logged as a call
+    int bet = 2;
+    for (const poker::ActionLogEntry& entry : t.table.action_log()) {
+      if (entry.action == poker::PlayerAction::RAISE_ALL_IN) {
+        EXPECT_GT(entry.amount, bet);
+        bet = entry.amount;
+      } else {
+        EXPECT_EQ(entry.action, poker::PlayerAction::CHECK);
+      }
+    }
+  }
+}
+
+namespace {
+
+// Folds offsuit hole cards and records what Act() was shown.
+class FoldOffsuitModel : public poker::holdem::PlayerModel {
+ public:
+  poker::PlayerAction Act(const poker::Table& table, poker::holdem::Round,
+                          int position, poker::Player& player) override {
+    positions.push_back(poker::holdem::PositionFromButton(
+        position, table.button(), table.players().size()));
+    board_sizes.push_back(table.community_cards().size());
+    return player.cards()[0].suit() == player.cards()[1].suit()
+        ? poker::PlayerAction::CHECK : poker::PlayerAction::FOLD;
+  }
+  std::vector<int> positions;
+  std::vector<size_t> board_sizes;
+};
+
+} // namespace
+
+TEST(HoldemGameTest, ActManyAdapter) {
+  // Ace-king suited, ace-king offsuit and a pair of twos
+  const int cards[][2] = {{12, 11}, {12, 24}, {0, 13}};
+  uint8_t players[3], position[3], raises[3], hole_hand[3];
+  uint64_t hole[3], board[3];
+  uint64_t flop = poker::IndexToCardMask(30) | poker::IndexToCardMask(40) |
+                  poker::IndexToCardMask(50);
+  for (int i = 0; i < 3; i++) {
+    players[i] = 6;
+    position[i] = static_cast<uint8_t>(i * 2);
+    raises[i] = 0;
+    hole_hand[i] = poker::holdem::HoleHandIndex(cards[i][0], cards[i][1]);
+    hole[i] = poker::IndexToCardMask(cards[i][0]) |
+              poker::IndexToCardMask(cards[i][1]);
+    board[i] = flop;
+  }
+  poker::holdem::DecisionView view{poker::holdem::Round::FLOP, 3, players,
+                                   position, raises, hole_hand, hole, board};
+  FoldOffsuitModel model;
+  poker::PlayerAction actions[3];
+  model.ActMany(view, actions);
+  EXPECT_EQ(actions[0], poker::PlayerAction::CHECK);
+  EXPECT_EQ(actions[1], poker::PlayerAction::FOLD);
+  EXPECT_EQ(actions[2], poker::PlayerAction::FOLD);
+  EXPECT_EQ(model.positions, std::vector<int>({0, 2, 4}));
+  EXPECT_EQ(model.board_sizes, std::vector<size_t>({3, 3, 3}));
+
+  // A stock model decides the same through Act() as through its own loop
+  poker::holdem::PlayerModelMillerTight miller;
+  for (int i = 0; i < 3; i++) {
+    players[i] = static_cast<uint8_t>(2 + i * 4);
+    position[i] = static_cast<uint8_t>(i);
+    raises[i] = static_cast<uint8_t>(i % 2);
+  }
+  for (auto round : {poker::holdem::Round::PREFLOP,
+                     poker::holdem::Round::FLOP}) {
+    view.round = round;
+    poker::PlayerAction expected[3];
+    miller.ActMany(view, expected);
+    miller.PlayerModel::ActMany(view, actions);
+    for (int i = 0; i < 3; i++) {
+      EXPECT_EQ(actions[i], expected[i]) << i;
+    }
+  }
+}
+
+TEST(HoldemGameTest, MillerTightChart) {
+  using poker::PlayerAction;
+  poker::holdem::PlayerModelMillerTight model;
+  // Card indices: ranks from two (0) to ace (12), plus 13 for the next suit
+  auto decide = [&model](int players, int position, bool facing_bet,
+                         int card1, int card2) {
+    uint8_t players8 = players;
+    uint8_t position8 = position;
+    uint8_t raises = facing_bet ? 1 : 0;
+    uint8_t hole_hand = poker::holdem::HoleHandIndex(card1, card2);
+    uint64_t hole = poker::IndexToCardMask(card1) |
+                    poker::IndexToCardMask(card2);
+    uint64_t board = 0;
+    poker::holdem::DecisionView view{poker::holdem::Round::PREFLOP, 1,
+                                     &players8, &position8, &raises,
+                                     &hole_hand, &hole, &board};
+    PlayerAction action;
+    model.ActMany(view, &action);
+    return action;
+  };
+  // Under the gun at ten players, then on the button
+  EXPECT_EQ(decide(10, 3, false, 12, 25), PlayerAction::RAISE);  // AA
+  EXPECT_EQ(decide(10, 3, false, 0, 13), PlayerAction::FOLD);    // 22
+  EXPECT_EQ(decide(10, 0, false, 0, 13), PlayerAction::RAISE);
+  EXPECT_EQ(decide(10, 0, false, 5, 13), PlayerAction::FOLD);    // 72o
+  // The big blind checks when nobody raised
+  EXPECT_EQ(decide(10, 2, false, 5, 13), PlayerAction::CHECK);
+  // Facing a raise
+  EXPECT_EQ(decide(6, 4, true, 9, 22), PlayerAction::CHECK);     // JJ
+  EXPECT_EQ(decide(6, 4, true, 12, 11), PlayerAction::RAISE);    // AKs
+  EXPECT_EQ(decide(6, 4, true, 12, 10), PlayerAction::CHECK);    // AQs
+  EXPECT_EQ(decide(6, 4, true, 11, 22), PlayerAction::FOLD);     // KJo
+}
+
+TEST(HoldemStateTest, FoldsToTheBigBlind) {
+  std::mt19937 rng(1);
+  poker::holdem::HoldemState state;
+  state.NewHand(poker::Stakes(), 6, 0, rng);
+  // Blinds at 5 and 4, first to act is 3
+  EXPECT_EQ(state.to_act, 3);
+  EXPECT_EQ(state.pot, 3);
+  state.Rollout(rng, [](const poker::holdem::HoldemState&) {
+    return poker::PlayerAction::FOLD;
+  });
+  EXPECT_TRUE(state.finished());
+  EXPECT_EQ(state.board, 0u);
+  EXPECT_EQ(state.winnings[4], 3);
+  EXPECT_EQ(state.in_hand, 1);
+}
+
+TEST(HoldemStateTest, ShortAllInDoesNotReopenBetting) {
+  std::mt19937 rng(1);
+  poker::Stakes stakes;
+  for (int stack : {100, 100, 5}) {
+    stakes.seat_stacks.push_back(stack);
+  }
+  poker::holdem::HoldemState state;
+  state.NewHand(stakes, 3, 0, rng);
+  // Blinds at 2 and 1; 0 raises to 4 and the small blind's all-in to 5 is
+  // short of a full raise
+  ASSERT_EQ(state.to_act, 0);
+  state.Apply(poker::PlayerAction::RAISE);
+  state.Apply(poker::PlayerAction::RAISE_ALL_IN);
+  EXPECT_EQ(state.current_bet, 5);
+  // The big blind hadn't acted yet and calls; 0 can only call too
+  state.Apply(poker::PlayerAction::CHECK);
+  ASSERT_EQ(state.to_act, 0);
+  state.Apply(poker::PlayerAction::RAISE);
+  EXPECT_EQ(state.total_bet[0], 5);
+  EXPECT_EQ(state.pot, 15);
+  EXPECT_EQ(state.round, poker::holdem::Round::FLOP);
+}
+
+TEST(HoldemStateTest, RolloutsConserveChips) {
+  std::mt19937 rng(1);
+  poker::Stakes stakes;
+  for (int stack : {300, 100, 50, 200}) {
+    stakes.seat_stacks.push_back(stack);
+  }
+  poker::holdem::HoldemState root;
+  root.NewHand(stakes, 4, 1, rng);
+  root.Apply(poker::PlayerAction::RAISE_ALL_IN);
+  std::uniform_int_distribution<int> action(1, 4);
+  for (int i = 0; i < 1000; i++) {
+    poker::holdem::HoldemState state = root;
+    state.Rollout(rng, [&](const poker::holdem::HoldemState&) {
+      return static_cast<poker::PlayerAction>(action(rng));
+    });
+    ASSERT_TRUE(state.finished());
+    int32_t bets = 0;
+    int32_t won = 0;
+    for (int p = 0; p < 4; p++) {
+      bets += state.total_bet[p];
+      won += state.winnings[p];
+      EXPECT_EQ(state.stack[p] + state.total_bet[p], stakes.StackAt(p));
+    }
+    EXPECT_EQ(bets, state.pot);
+    EXPECT_EQ(won, state.pot);
+    if (state.in_hand > 1) {
+      EXPECT_EQ(__builtin_popcountll(state.board), 5);
+    }
+  }
+  // Rollouts leave the state they were copied from alone
+  EXPECT_EQ(root.round, poker::holdem::Round::PREFLOP);
+  EXPECT_EQ(root.board, 0u);
+}
+
+namespace {
+
+uint64_t CardsMask(std::initializer_list<std::pair<Rank, Suit>> cards) {
+  uint64_t mask = 0;
+  for (const auto& [rank, suit] : cards) {
+    Card card;
+    card.set_rank(rank);
+    card.set_suit(suit);
+    mask |= poker::CardToMask(card);
+  }
+  return mask;
+}
+
+} // namespace
+
+TEST(HandStrengthTest, StrengthAndPotential) {
+  // The nut flush on the river can only tie or win
+  poker::holdem::HandStrength nuts = poker::holdem::ComputeHandStrength(
+      CardsMask({{ACE, HEARTS}, {KING, HEARTS}}),
+      CardsMask({{TWO, HEARTS}, {SEVEN, HEARTS}, {NINE, HEARTS},
+                 {JACK, CLUBS}, {THREE, SPADES}}));
+  EXPECT_FLOAT_EQ(nuts.strength, 1.0f);
+  EXPECT_EQ(nuts.positive_potential, 0.0f);
+  EXPECT_EQ(nuts.negative_potential, 0.0f);
+
+  // A flush draw on the flop is mostly behind with a lot of potential
+  uint64_t hole = CardsMask({{FIVE, SPADES}, {SIX, SPADES}});
+  uint64_t board = CardsMask({{TWO, SPADES}, {NINE, SPADES},
+                              {KING, DIAMONDS}});
+  poker::holdem::HandStrength draw =
+      poker::holdem::ComputeHandStrength(hole, board);
+  EXPECT_LT(draw.strength, 0.5f);
+  EXPECT_GT(draw.positive_potential, 0.15f);
+  EXPECT_GT(draw.Effective(), draw.strength);
+
+  // The same spot with the suits relabelled is one cache entry
+  poker::holdem::HandStrengthCache cache(10);
+  cache.Get(hole, board);
+  poker::holdem::HandStrength swapped = cache.Get(
+      CardsMask({{FIVE, HEARTS}, {SIX, HEARTS}}),
+      CardsMask({{TWO, HEARTS}, {NINE, HEARTS}, {KING, CLUBS}}));
+  EXPECT_EQ(cache.hits(), 1u);
+  EXPECT_EQ(cache.misses(), 1u);
+  EXPECT_NEAR(swapped.strength, draw.strength, 1e-4);
+  EXPECT_NEAR(swapped.positive_potential, draw.positive_potential, 1e-4);
+
+  EXPECT_THROW(poker::holdem::ComputeHandStrength(hole, 0),
+               std::invalid_argument);
+}
+
+TEST(HandIndexTest, SuitIsomorphism) {
+  poker::HandIndexer hole({2});
+  poker::HandIndexer flop({3});
+  EXPECT_EQ(hole.size(), 169u);
+  EXPECT_EQ(flop.size(), 1755u);
+  const poker::HandIndexer& street =
+      poker::holdem::StreetIndexer(poker::holdem::Round::FLOP);
+  EXPECT_EQ(street.size(), 1286792u);
+
+  // Weights add up to every hand
+  uint64_t flops = 0;
+  for (uint64_t i = 0; i < flop.size(); i++) {
+    flops += flop.Weight(i);
+  }
+  EXPECT_EQ(flops, 22100u);
+
+  // Random hands index the same under any relabelling of suits, and their
+  // index's canonical hand is one of those relabellings.
+  std::mt19937 rng(3);
+  poker::holdem::HoldemState state;
+  std::array<int, 4> suits = {0, 1, 2, 3};
+  auto relabel = [&](uint64_t mask) {
+    uint64_t result = 0;
+    for (int suit = 0; suit < 4; suit++) {
+      result |= static_cast<uint64_t>(poker::SuitRanks(mask, suit))
+                << (16 * suits[suit]);
+    }
+    return result;
+  };
+  for (int i = 0; i < 2000; i++) {
+    state.NewHand(poker::Stakes(), 2, 0, rng);
+    while (state.round != poker::holdem::Round::RIVER) {
+      state.Apply(poker::PlayerAction::CHECK);
+    }
+    std::array<uint64_t, 2> hand = {state.hole[0], state.board};
+    const poker::HandIndexer& river =
+        poker::holdem::StreetIndexer(poker::holdem::Round::RIVER);
+    uint64_t index = river.Index(hand.data());
+    ASSERT_LT(index, river.size());
+    std::shuffle(suits.begin(), suits.end(), rng);
+    std::array<uint64_t, 2> relabelled = {relabel(hand[0]), relabel(hand[1])};
+    ASSERT_EQ(river.Index(relabelled.data()), index);
+    std::array<uint64_t, 2> canonical;
+    river.Unindex(index, canonical.data());
+    ASSERT_EQ(river.Index(canonical.data()), index);
+    ASSERT_EQ(__builtin_popcountll(canonical[1]), 5);
+  }
+}
+
+TEST(EquityTest, ExactRunouts) {
+  // Ace-king of hearts against queens on a flop with two hearts
+  std::array<uint64_t, 2> hole = {
+      CardsMask({{ACE, HEARTS}, {KING, HEARTS}}),
+      CardsMask({{QUEEN, SPADES}, {QUEEN, CLUBS}})};
+  uint64_t flop = CardsMask({{TWO, HEARTS}, {SEVEN, HEARTS}, {NINE, CLUBS}});
+  std::mt19937 rng(5);
+  poker::holdem::Equity exact =
+      poker::holdem::ShowdownEquity(hole.data(), 2, flop, 0, rng);
+  EXPECT_TRUE(exact.exact);
+  EXPECT_EQ(exact.runouts, 990u);
+  EXPECT_NEAR(exact.share[0] + exact.share[1], 1.0, 1e-9);
+
+  // Sampling converges on the same answer
+  poker::holdem::Equity sampled =
+      poker::holdem::SampleEquity(hole.data(), 2, flop, 0, rng, 200000);
+  EXPECT_FALSE(sampled.exact);
+  EXPECT_NEAR(sampled.share[0], exact.share[0], 0.01);
+
+  // On the turn 44 rivers remain; the 9 hearts, 3 aces and 3 kings win
+  uint64_t turn = flop | CardsMask({{FOUR, DIAMONDS}});
+  poker::holdem::Equity river =
+      poker::holdem::ShowdownEquity(hole.data(), 2, turn, 0, rng);
+  EXPECT_EQ(river.runouts, 44u);
+  EXPECT_DOUBLE_EQ(river.share[0], 15.0 / 44);
+
+  // Folded hands are dead cards: with the other aces and kings gone only
+  // the hearts are left
+  uint64_t folded = CardsMask({{ACE, SPADES}, {ACE, CLUBS}, {ACE, DIAMONDS},
+                               {KING, SPADES}, {KING, CLUBS},
+                               {KING, DIAMONDS}});
+  river = poker::holdem::ShowdownEquity(hole.data(), 2, turn, folded, rng);
+  EXPECT_EQ(river.runouts, 38u);
+  EXPECT_DOUBLE_EQ(river.share[0], 9.0 / 38);
+
+  // The same through a HoldemState, with the other aces and kings in the
+  // hands of three folded players
+  poker::holdem::HoldemState state;
+  state.NewHand(poker::Stakes(), 5, 0, rng);
+  state.hole = {hole[0], CardsMask({{ACE, SPADES}, {KING, SPADES}}), hole[1],
+                CardsMask({{ACE, CLUBS}, {KING, CLUBS}}),
+                CardsMask({{ACE, DIAMONDS}, {KING, DIAMONDS}})};
+  state.folded = 0b11010;
+  state.board = turn;
+  river = poker::holdem::ShowdownEquity(state, rng);
+  EXPECT_EQ(river.runouts, 38u);
+  EXPECT_DOUBLE_EQ(river.share[0], 9.0 / 38);
+  EXPECT_DOUBLE_EQ(river.share[2], 29.0 / 38);
+  EXPECT_EQ(river.share[1] + river.share[3] + river.share[4], 0);
+
+  // Statistics with --stats:equity enumerates every flop and turn
+  PokerSimulationArgs args;
+  args.players = 2;
+  args.stats_equity = true;
+  poker::Table table;
+  std::vector<poker::Player> players(args.players);
+  poker::holdem::PlayerModelVector models;
+  for (int i = 0; i < args.players; i++) {
+    models.push_back(std::make_unique<poker::holdem::PlayerModelShowdown>());
+  }
+  poker::holdem::Statistics stats(args);
+  poker::holdem::Game<std::mt19937, poker::holdem::Statistics> game(
+      table, players, std::move(models), stats, rng);
+  for (int i = 0; i < 5000; i++) {
+    game.Play();
+  }
+  const int aces = poker::holdem::HoleHandIndex(12, 25);
+  const int seven_deuce = poker::holdem::HoleHandIndex(5, 13);
+  EXPECT_GT(stats.HoleHandEquity(poker::holdem::Round::FLOP, aces), 0.7);
+  EXPECT_LT(stats.HoleHandEquity(poker::holdem::Round::TURN, seven_deuce),
+            0.4);
+  EXPECT_EQ(stats.HoleHandEquity(poker::holdem::Round::RIVER, aces), 0);
+}
+
+TEST(OmahaTest, EvaluatorMatchesBruteForce) {
+  std::mt19937 rng(1);
+  std::array<int, poker::kCardCount> deck;
+  poker::omaha::Evaluator evaluator;
+  for (int deal = 0; deal < 3000; deal++) {
+    // Flops, turns and rivers; every other deal only from two suits, so
+    // flushes come up often
+    const int board_cards = 3 + deal % 3;
+    std::iota(deck.begin(), deck.end(), 0);
+    std::shuffle(deck.begin(),
+                 deck.begin() + (deal % 2 == 0 ? poker::kCardCount
+                                               : 2 * poker::kRankCount),
+                 rng);
+    std::array<uint64_t, 4 + poker::kMaxCommunityCards> cards;
+    for (int i = 0; i < 4 + board_cards; i++) {
+      cards[i] = poker::IndexToCardMask(deck[i]);
+    }
+    uint64_t hole = cards[0] | cards[1] | cards[2] | cards[3];
+    uint64_t board = 0;
+    for (int i = 4; i < 4 + board_cards; i++) {
+      board |= cards[i];
+    }
+
+    int32_t best = 0;
+    for (int a = 0; a < 4; a++) {
+      for (int b = a + 1; b < 4; b++) {
+        for (int c = 4; c < 4 + board_cards; c++) {
+          for (int d = c + 1; d < 4 + board_cards; d++) {
+            for (int e = d + 1; e < 4 + board_cards; e++) {
+              best = std::max(best, poker::EvaluateCardMask(
+                  cards[a] | cards[b] | cards[c] | cards[d] | cards[e]));
+            }
+          }
+        }
+      }
+    }
+    evaluator.SetBoard(board);
+    ASSERT_EQ(evaluator.Evaluate(hole), best) << deal;
+  }
+  EXPECT_THROW(evaluator.SetBoard(0xC), std::invalid_argument);
+}
+
+TEST(OmahaTest, PotLimitRaises) {
+  BettingTable<poker::omaha::Rules> t(3, poker::PlayerAction::RAISE_ALL_IN);
+  for (int hand = 0; hand < 100; hand++) {
+    t.game->Play();
+    // Each all-in is held to the pot: to 7, 23 and 76 over the blinds of 1
+    // and 2, then the fourth and last raise gets everyone's 200 in.
+    const auto& log = t.table.action_log();
+    ASSERT_EQ(log.size(), 6u);
+    EXPECT_EQ(log[0].amount, 7);
+    EXPECT_EQ(log[1].amount, 23);
+    EXPECT_EQ(log[2].amount, 76);
+    EXPECT_EQ(log[3].amount, 200);
+    EXPECT_EQ(t.table.pot(), 600);
+    int winnings = 0;
+    for (const poker::Player& player : t.players) {
+      EXPECT_EQ(player.cards().size(), 4u);
+      winnings += player.winnings();
+    }
+    EXPECT_EQ(winnings, 600);
+  }
+}
+
+namespace {
+
+// Statistics collector that logs what it sees of the table at each call,
+// with seats numbered from the button.
+struct TraceStatistics {
+  struct Entry {
+    int call;
+    uint64_t board;
+    int pot;
+    std::array<uint64_t, poker::kMaxPlayers> hole;
+    uint32_t folded;
+    bool operator==(const Entry& other) const {
+      return call == other.call && board == other.board &&
+             pot == other.pot && hole == other.hole &&
+             folded == other.folded;
+    }
+  };
+  void NewGame(const poker::Table& table,
+               std::vector<poker::Player>& players) {
+    table_ = &table;
+    players_ = &players;
+    Log(-1);
+  }
+  void Collect(poker::holdem::Round round) {
+    Log(static_cast<int>(round));
+  }
+  void CollectUncontested(poker::holdem::Round round) {
+    Log(4 + static_cast<int>(round));
+  }
+  void Log(int call) {
+    Entry entry{call, table_->community_card_mask(), table_->pot(), {}, 0};
+    const int players = players_->size();
+    for (int i = 0; i < players; i++) {
+      int seat = (i - table_->button() + players) % players;
+      entry.hole[seat] = (*players_)[i].card_mask();
+      entry.folded |= (*players_)[i].folded() << seat;
+    }
+    log.push_back(entry);
+  }
+
+  std::vector<Entry> log;
+  const poker::Table* table_{};
+  const std::vector<poker::Player>* players_{};
+};
+
+} // namespace
+
+TEST(HandHistoryTest, ReplayMatchesPlay) {
+  using namespace poker::holdem;
+  for (bool compressed : {false, true}) {
+    const std::string path = testing::TempDir() + "/hand_history_test.phh";
+    const int kPlayers = 6;
+    const int kHands = 5000;
+    TraceStatistics played;
+    {
+      poker::Table table;
+      std::vector<poker::Player> players(kPlayers);
+      PlayerModelVector models;
+      for (int i = 0; i < kPlayers; i++) {
+        models.push_back(std::make_unique<PlayerModelMillerTight>());
+      }
+      HandHistoryWriter writer(
+          path, MakeHandHistoryHeader<HoldemRules>(kPlayers, table.stakes(),
+                                                   compressed));
+      HandHistoryRecorder<TraceStatistics> recorder(played, writer);
+      std::mt19937 rng(7);
+      Game<std::mt19937, HandHistoryRecorder<TraceStatistics>> game(
+          table, players, std::move(models), recorder, rng);
+      for (int i = 0; i < kHands; i++) {
+        game.Play();
+      }
+      EXPECT_EQ(writer.hands(), kHands);
+    }
+
+    HandHistoryReader reader(path);
+    EXPECT_EQ(reader.header().players, kPlayers);
+    EXPECT_EQ(reader.header().hole_cards, kHoleCards);
+    TraceStatistics replayed;
+    EXPECT_EQ(ReplayHandHistory(reader, replayed), kHands);
+    ASSERT_EQ(replayed.log.size(), played.log.size());
+    for (size_t i = 0; i < played.log.size(); i++) {
+      ASSERT_TRUE(replayed.log[i] == played.log[i]) << "Call " << i;
+    }
+  }
+  EXPECT_THROW(HandHistoryReader("/nonexistent/history"), std::runtime_error);
+
+  // Corrupt the one hand of an uncompressed history: a button past the last
+  // seat, then an action by a seat past the last one
+  const std::string path = testing::TempDir() + "/hand_history_corrupt.phh";
+  poker::Table table;
+  table.set_button(0);
+  std::vector<poker::Player> players(2);
+  for (int i = 0; i < 2; i++) {
+    players[i].add_card(poker::IndexToCard(2 * i));
+    players[i].add_card(poker::IndexToCard(2 * i + 1));
+  }
+  table.log_action({0, 1, poker::PlayerAction::FOLD, 0});
+  {
+    HandHistoryWriter writer(path, MakeHandHistoryHeader<HoldemRules>(
+                                       2, table.stakes(), false));
+    writer.Write(table, players);
+  }
+  const size_t button = sizeof(HandHistoryHeader) +
+                        sizeof(HandHistoryBlockHeader);
+  const size_t action = button + 2 + kRoundMax + 2 * kHoleCards;
+  for (size_t offset : {button, action}) {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekg(offset);
+    char valid = file.get();
+    file.seekp(offset);
+    file.put(static_cast<char>(offset == button ? 2 : valid + (1 << 4)));
+    file.flush();
+    HandRecord record;
+    HandHistoryReader corrupt(path);
+    EXPECT_THROW(corrupt.Next(&record), std::runtime_error) << offset;
+    file.seekp(offset);
+    file.put(valid);
+    file.flush();
+    HandHistoryReader valid_reader(path);
+    EXPECT_TRUE(valid_reader.Next(&record));
+  }
+}
+
+namespace {
+
+// Collector that also formats each hand as an ACPC log line.
+struct AcpcExport : TraceStatistics {
+  void Collect(poker::holdem::Round round) {
+    TraceStatistics::Collect(round);
+    if (round == poker::holdem::Round::RIVER) {
+      Export();
+    }
+  }
+  void CollectUncontested(poker::holdem::Round round) {
+    TraceStatistics::CollectUncontested(round);
+    Export();
+  }
+  void Export() {
+    poker::holdem::HandRecord hand;
+    poker::holdem::RecordHand(*table_, *players_, &hand);
+    text += poker::holdem::FormatAcpcHand(hand, players_->size(),
+                                          table_->stakes(), hands++);
+    text += '\n';
+  }
+
+  std::string text;
+  uint64_t hands{};
+};
+
+} // namespace
+
+TEST(HandImportTest, AcpcHands) {
+  using namespace poker::holdem;
+  AcpcHandParser parser(2, AcpcStakes());
+  HandRecord hand;
+  EXPECT_FALSE(parser.Parse("# comment", &hand));
+  ASSERT_TRUE(parser.Parse(
+      "STATE:7:r300c/cr900f:9hQc|5dQd/8dAs8s:-300|300:Alice|Bob", &hand));
+  // ACPC seat 1 is the button, which is seat 0 here
+  EXPECT_EQ(hand.button, 0);
+  EXPECT_EQ(poker::IndexToCard(hand.hole[0]).rank(), Rank::FIVE);
+  EXPECT_EQ(poker::IndexToCard(hand.hole[0]).suit(), Suit::DIAMONDS);
+  EXPECT_EQ(poker::IndexToCard(hand.hole[2]).rank(), Rank::NINE);
+  EXPECT_EQ(hand.board.size(), 3u);
+  ASSERT_EQ(hand.actions.size(), 5u);
+  EXPECT_EQ(hand.actions[0].position, 0);
+  EXPECT_EQ(hand.actions[0].amount, 300);
+  EXPECT_EQ(hand.actions[3].action, poker::PlayerAction::RAISE);
+  EXPECT_EQ(hand.actions[3].amount, 600);
+  EXPECT_EQ(hand.actions[4].action, poker::PlayerAction::FOLD);
+  EXPECT_THROW(parser.Parse("STATE:8:cc:9hQc|5dQd|2c2d/8dAs8s::", &hand),
+               std::invalid_argument);
+  EXPECT_THROW(parser.Parse("STATE:8:r99999c:9hQc|5dQd::", &hand),
+               std::invalid_argument);
+  const char* kAcpcHand =
+      "STATE:0:r300c/cc/cc/r600f:9dQc|5d7h/Jh4c2s/Kd/Qs:-300|300:Alice|Bob";
+  EXPECT_TRUE(parser.Parse(kAcpcHand, &hand));
+  // Parsed with other stakes the raises don't fit the stacks
+  AcpcHandParser shallow(2, poker::Stakes());
+  try {
+    shallow.Parse(kAcpcHand, &hand);
+    ADD_FAILURE() << "Parsed a hand deeper than the stakes";
+  } catch (const std::invalid_argument& err) {
+    EXPECT_NE(std::string(err.what()).find("stakes don't match"),
+              std::string::npos) << err.what();
+  }
+
+  // Simulated hands exported and imported again replay the same
+  const int kPlayers = 6;
+  AcpcExport played;
+  {
+    poker::Table table;
+    std::vector<poker::Player> players(kPlayers);
+    PlayerModelVector models;
+    for (int i = 0; i < kPlayers; i++) {
+      models.push_back(std::make_unique<PlayerModelMillerTight>());
+    }
+    std::mt19937 rng(11);
+    Game<std::mt19937, AcpcExport> game(table, players, std::move(models),
+                                        played, rng);
+    for (int i = 0; i < 5000; i++) {
+      game.Play();
+    }
+  }
+  EXPECT_EQ(AcpcPlayerCount(played.text), kPlayers);
+  std::vector<std::string_view> chunks = SplitAtLines(played.text, 10000);
+  EXPECT_GT(chunks.size(), 10u);
+  AcpcHandParser six_parser(kPlayers, poker::Stakes());
+  HandReplay replay(
+      MakeHandHistoryHeader<HoldemRules>(kPlayers, poker::Stakes(), false));
+  TraceStatistics imported;
+  uint64_t hands = 0;
+  for (std::string_view chunk : chunks) {
+    EXPECT_EQ(chunk.back(), '\n');
+    hands += ImportAcpcHands(chunk, six_parser, replay, imported);
+  }
+  EXPECT_EQ(hands, played.hands);
+  ASSERT_EQ(imported.log.size(), played.log.size());
+  for (size_t i = 0; i < played.log.size(); i++) {
+    ASSERT_TRUE(imported.log[i] == played.log[i]) << "Call " << i;
+  }
+}
+
+TEST(StatsFileTest, ExportMatchesCounters) {
+  using namespace poker::holdem;
+  PokerSimulationArgs args;
+  args.players = 6;
+  args.stats_winning_hand = true;
+  args.stats_hole_cards = true;
+  const int kHands = 2000;
+  const std::string path = testing::TempDir() + "/stats_file_test.pkst";
+
+  poker::Table table;
+  std::vector<poker::Player> players(args.players);
+  PlayerModelVector models;
+  for (int i = 0; i < args.players; i++) {
+    models.push_back(std::make_unique<PlayerModelShowdown>());
+  }
+  Statistics stats(args);
+  std::mt19937 rng(1);
+  Game<std::mt19937, Statistics> game(table, players, std::move(models),
+                                      stats, rng);
+  for (int i = 0; i < kHands; i++) {
+    game.Play();
+  }
+  stats.WriteStatsFile(path);
+
+  StatsFile file(path);
+  EXPECT_EQ(file.header().games, kHands);
+  EXPECT_EQ(file.header().players, args.players);
+  EXPECT_EQ(file.header().hole_hand_count, kHoleHandCount);
+  EXPECT_EQ(file.HoleHandName(0), "AA");
+  EXPECT_EQ(file.HoleHandName(1), "AKs");
+  EXPECT_EQ(file.HoleHandName(2), "AKo");
+  EXPECT_EQ(file.HoleHandName(25), "KK");
+  EXPECT_EQ(file.HoleHandName(kHoleHandCount - 1), "22");
+
+  StatsColumn appearances = file.column(StatsColumnId::HOLE_HAND_APPEARANCES);
+  ASSERT_EQ(appearances.size(), kHoleHandCount);
+  uint64_t dealt = 0;
+  for (size_t i = 0; i < appearances.size(); i++) {
+    dealt += appearances[i];
+  }
+  EXPECT_EQ(dealt, uint64_t{kHands} * args.players);
+
+  // Everyone shows down (showdown model): every hand has a river winner
+  StatsColumn beat = file.column(StatsColumnId::BEAT_MATRIX, kRoundRiver);
+  EXPECT_EQ(beat.rows, kHoleHandCount);
+  EXPECT_EQ(beat.columns, kHoleHandCount);
+  StatsColumn value_wins =
+      file.column(StatsColumnId::HAND_VALUE_WINS, kRoundRiver);
+  StatsColumn type_wins =
+      file.column(StatsColumnId::HAND_TYPE_WINS, kRoundRiver);
+  uint64_t value_total = 0;
+  uint64_t type_total = 0;
+  for (size_t i = 0; i < value_wins.size(); i++) {
+    value_total += value_wins[i];
+  }
+  for (size_t i = 0; i < type_wins.size(); i++) {
+    type_total += type_wins[i];
+  }
+  EXPECT_GE(value_total, kHands);
+  EXPECT_EQ(type_total, value_total);
+
+  // Every showdown counts each pair of players once, as a win or a tie, and
+  // each player once as a win, tie or loss
+  StatsColumn ties = file.column(StatsColumnId::TIE_MATRIX, kRoundRiver);
+  uint64_t wins = 0;
+  uint64_t tied = 0;
+  for (size_t i = 0; i < beat.size(); i++) {
+    wins += beat[i];
+    tied += ties[i];
+  }
+  EXPECT_GT(tied, 0);
+  EXPECT_EQ(wins + tied / 2,
+            value_total * args.players * (args.players - 1) / 2);
+  uint64_t results = 0;
+  for (StatsColumnId id : {StatsColumnId::HOLE_HAND_OUTRIGHT_WINS,
+                           StatsColumnId::HOLE_HAND_TIES,
+                           StatsColumnId::HOLE_HAND_LOSSES}) {
+    StatsColumn column = file.column(id, kRoundRiver);
+    for (size_t i = 0; i < column.size(); i++) {
+      results += column[i];
+    }
+  }
+  EXPECT_EQ(results, value_total * args.players);
+  // Wins include split pots
+  StatsColumn won = file.column(StatsColumnId::HOLE_HAND_WINS, kRoundRiver);
+  StatsColumn outright =
+      file.column(StatsColumnId::HOLE_HAND_OUTRIGHT_WINS, kRoundRiver);
+  StatsColumn split = file.column(StatsColumnId::HOLE_HAND_TIES, kRoundRiver);
+  for (size_t i = 0; i < won.size(); i++) {
+    EXPECT_EQ(won[i], outright[i] + split[i]) << file.HoleHandName(i);
+  }
+  EXPECT_TRUE(file.column(StatsColumnId::BEAT_MATRIX, kRoundPreflop).empty());
+  EXPECT_TRUE(file.column(StatsColumnId::ATTRIBUTE_HANDS, kRoundFlop).empty());
+
+  // A header whose low rank or hole hand count HoleHandName() can't name
+  FILE* corrupt = std::fopen(path.c_str(), "r+b");
+  ASSERT_NE(corrupt, nullptr);
+  std::fseek(corrupt, offsetof(StatsFileHeader, low_rank), SEEK_SET);
+  std::fputc(1, corrupt);
+  std::fflush(corrupt);
+  EXPECT_THROW(StatsFile{path}, std::runtime_error);
+  std::fseek(corrupt, offsetof(StatsFileHeader, low_rank), SEEK_SET);
+  std::fputc(3, corrupt);
+  std::fflush(corrupt);
+  EXPECT_THROW(StatsFile{path}, std::runtime_error);
+  std::fseek(corrupt, offsetof(StatsFileHeader, low_rank), SEEK_SET);
+  std::fputc(2, corrupt);
+  std::fflush(corrupt);
+  EXPECT_NO_THROW(StatsFile{path});
+
+  std::rewind(corrupt);
+  std::fputs("PKHH", corrupt);
+  std::fclose(corrupt);
+  EXPECT_THROW(StatsFile{path}, std::runtime_error);
+}
+
+TEST(CApiTest, MatchesLibrary) {
+  EXPECT_EQ(poker_api_version(), POKER_API_VERSION);
+
+  // Random seven card hands, evaluated in one batch
+  const int kHands = 1000;
+  std::mt19937 rng(3);
+  std::vector<uint8_t> cards;
+  for (int i = 0; i < kHands; i++) {
+    std::vector<uint8_t> deck(poker::kCardCount);
+    std::iota(deck.begin(), deck.end(), 0);
+    std::shuffle(deck.begin(), deck.end(), rng);
+    cards.insert(cards.end(), deck.begin(), deck.begin() + 7);
+  }
+  std::vector<int32_t> strength(kHands);
+  ASSERT_EQ(poker_evaluate(cards.data(), kHands, 7, strength.data()),
+            POKER_OK);
+  for (int i = 0; i < kHands; i++) {
+    uint64_t mask = 0;
+    for (int c = 0; c < 7; c++) {
+      mask |= poker::IndexToCardMask(cards[i * 7 + c]);
+    }
+    ASSERT_EQ(strength[i], poker::EvaluateCardMask(mask));
+    ASSERT_EQ(poker_hand_category(strength[i]),
+              static_cast<int>(poker::SortCodeHandType<
+                               poker::StandardRanking>(strength[i])));
+  }
+  EXPECT_EQ(poker_hand_category(-1), 0);
+
+  // Hole classes and their names, as Statistics and StatsFile number them
+  std::vector<uint8_t> hole_cards;
+  for (int i = 0; i < kHands; i++) {
+    hole_cards.insert(hole_cards.end(), &cards[i * 7], &cards[i * 7 + 2]);
+  }
+  std::vector<uint8_t> hole_class(kHands);
+  ASSERT_EQ(poker_hole_class(hole_cards.data(), kHands, hole_class.data()),
+            POKER_OK);
+  for (int i = 0; i < kHands; i++) {
+    ASSERT_EQ(hole_class[i], poker::holdem::HoleHandIndex(
+                                 hole_cards[2 * i], hole_cards[2 * i + 1]));
+  }
+  char name[4];
+  for (auto [index, expected] : {std::pair{0, "AA"}, {1, "AKs"}, {2, "AKo"},
+                                 {25, "KK"}, {167, "32o"}, {168, "22"}}) {
+    ASSERT_EQ(poker_hole_class_name(index, name), POKER_OK);
+    EXPECT_STREQ(name, expected);
+  }
+
+  // AhKh against QsQc on Js Th 2c: the same as EnumerateEquity
+  poker_equity_query query{};
+  query.players = 2;
+  query.board_count = 3;
+  const uint8_t hole[2][2] = {{38, 37}, {10, 23}};
+  std::copy(&hole[0][0], &hole[0][0] + 4, &query.hole[0][0]);
+  query.board[0] = 9;
+  query.board[1] = 34;
+  query.board[2] = 13;
+  poker_equity_query queries[2] = {query, query};
+  queries[1].dead_count = 1;
+  queries[1].dead[0] = 12;
+  poker_equity_result results[2];
+  ASSERT_EQ(poker_equity(queries, 2, poker::holdem::kDefaultMaxRunouts, 1,
+                         results),
+            POKER_OK);
+  uint64_t masks[2] = {
+      poker::IndexToCardMask(38) | poker::IndexToCardMask(37),
+      poker::IndexToCardMask(10) | poker::IndexToCardMask(23)};
+  uint64_t board = poker::IndexToCardMask(9) | poker::IndexToCardMask(34) |
+                   poker::IndexToCardMask(13);
+  poker::holdem::Equity equity =
+      poker::holdem::EnumerateEquity(masks, 2, board);
+  EXPECT_TRUE(results[0].exact);
+  EXPECT_EQ(results[0].runouts, equity.runouts);
+  EXPECT_DOUBLE_EQ(results[0].share[0], equity.share[0]);
+  EXPECT_DOUBLE_EQ(results[0].share[1], equity.share[1]);
+  EXPECT_LT(results[1].runouts, results[0].runouts);
+
+  // Bad input is reported, not thrown
+  uint8_t duplicate[5] = {1, 2, 3, 4, 4};
+  EXPECT_EQ(poker_evaluate(duplicate, 1, 5, strength.data()),
+            POKER_INVALID_ARGUMENT);
+  query.board[0] = 38;
+  EXPECT_EQ(poker_equity(&query, 1, 1000, 1, results),
+            POKER_INVALID_ARGUMENT);
+  EXPECT_EQ(poker_hole_class_name(POKER_HOLE_CLASS_COUNT, name),
+            POKER_INVALID_ARGUMENT);
+}
+
+TEST(EquityServiceTest, QueriesCacheAndLatency) {
+  using namespace poker::holdem;
+  EquityQuery query = ParseEquityQuery("AhKh ?? QsQc BOARD Js9s 2c DEAD 3d");
+  EXPECT_EQ(query.players, 3);
+  EXPECT_EQ(query.hole[1], 0);
+  EXPECT_EQ(__builtin_popcountll(query.board), 3);
+  EXPECT_EQ(__builtin_popcountll(query.dead), 1);
+  EXPECT_THROW(ParseEquityQuery("AhKh"), std::invalid_argument);
+  EXPECT_THROW(ParseEquityQuery("AhKh Ah2c"), std::invalid_argument);
+  EXPECT_THROW(ParseEquityQuery("AhKh ?? BOARD 2c3c"), std::invalid_argument);
+  EXPECT_THROW(ParseEquityQuery("AhKx ??"), std::invalid_argument);
+  // Ten random hands and a board need 25 of the cards not dead
+  std::string random_hands = "?? ?? ?? ?? ?? ?? ?? ?? ?? ?? DEAD ";
+  for (int i = 0; i < 27; i++) {
+    random_hands += "23456789TJQKA"[i % 13];
+    random_hands += "schd"[i / 13];
+  }
+  EXPECT_EQ(ParseEquityQuery(random_hands).players, 10);
+  EXPECT_THROW(ParseEquityQuery(random_hands + "3h"), std::invalid_argument);
+  // Only two cards left for a five card board
+  uint64_t hole[2] = {poker::IndexToCardMask(0) | poker::IndexToCardMask(1),
+                      poker::IndexToCardMask(2) | poker::IndexToCardMask(3)};
+  uint64_t dead = poker::kFullDeckMask & ~hole[0] & ~hole[1] &
+                  ~poker::IndexToCardMask(4) & ~poker::IndexToCardMask(5);
+  Equity none = EnumerateEquity(hole, 2, 0, dead);
+  EXPECT_EQ(none.runouts, 0);
+  EXPECT_EQ(none.share[0], 0);
+
+  // Suit permutations share a key; the order of the hands doesn't
+  EXPECT_EQ(EquityCacheKey(ParseEquityQuery("AhKh ?? BOARD Js9s2c")),
+            EquityCacheKey(ParseEquityQuery("AdKd ?? BOARD Jc9c2h")));
+  EXPECT_NE(EquityCacheKey(ParseEquityQuery("AhKh ?? BOARD Js9s2c")),
+            EquityCacheKey(ParseEquityQuery("AhKh ?? BOARD Jh9s2c")));
+  EXPECT_NE(EquityCacheKey(ParseEquityQuery("AhKh QsQc")),
+            EquityCacheKey(ParseEquityQuery("QsQc AhKh")));
+
+  // A random hand is sampled: aces win about 85% against one
+  std::mt19937 rng(1);
+  EquityQuery aces = ParseEquityQuery("AhAs ??");
+  Equity equity = ShowdownEquity(aces.hole.data(), aces.players, 0, 0, rng,
+                                 20000);
+  EXPECT_FALSE(equity.exact);
+  EXPECT_NEAR(equity.share[0], 0.852, 0.01);
+  EXPECT_NEAR(equity.share[0] + equity.share[1], 1.0, 1e-9);
+
+  EquityCache cache(2);
+  cache.Insert("a", equity);
+  cache.Insert("b", equity);
+  EXPECT_NE(cache.Find("a"), nullptr);
+  cache.Insert("c", equity);  // Evicts b, the least recently used
+  EXPECT_EQ(cache.Find("b"), nullptr);
+  EXPECT_NE(cache.Find("a"), nullptr);
+  EXPECT_NE(cache.Find("c"), nullptr);
+
+  LatencyHistogram latency;
+  for (uint64_t micros = 1; micros <= 1000; micros++) {
+    latency.Record(micros);
+  }
+  EXPECT_EQ(latency.count(), 1000);
+  EXPECT_EQ(latency.Percentile(0.01), 10);
+  EXPECT_NEAR(latency.Percentile(0.5), 500, 500 / 8);
+  EXPECT_NEAR(latency.Percentile(0.99), 990, 990 / 8);
+  EXPECT_EQ(latency.Percentile(1.0), 1000);
+}
@@ -0,0 +1,31 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+namespace poker {
+
+// A file mapped read-only into memory for its lifetime, so large inputs can
+// be read in place by many threads without copying.  Throws
+// std::runtime_error if the file can't be opened or mapped.
+class MappedFile {
+public:
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  const std::string& path() const { return path_; }
+
+private:
+  std::string path_;
+  const char* data_{};
+  size_t size_{};
+};
+
+} // namespace poker
+
+#endif // MAPPED_FILE_H
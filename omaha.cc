@@ -0,0 +1,115 @@
+#include "omaha.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace poker::omaha {
+
+namespace {
+
+// Rank classes of triples of ranks r0 <= r1 <= r2 (0-based), at
+// (r0 * kRankCount + r1) * kRankCount + r2
+constexpr std::array<uint16_t, kRankCount * kRankCount * kRankCount>
+    kTripleClassOf = [] {
+      std::array<uint16_t, kRankCount * kRankCount * kRankCount> classes{};
+      uint16_t next = 0;
+      for (int r0 = 0; r0 < kRankCount; r0++) {
+        for (int r1 = r0; r1 < kRankCount; r1++) {
+          for (int r2 = r1; r2 < kRankCount; r2++) {
+            classes[(r0 * kRankCount + r1) * kRankCount + r2] = next++;
+          }
+        }
+      }
+      return classes;
+    }();
+
+} // namespace
+
+const int32_t* Evaluator::RankValues() {
+  static const std::vector<int32_t>* const kValues = [] {
+    auto* values = new std::vector<int32_t>(kPairClasses * kTripleClasses);
+    for (int p0 = 0; p0 < kRankCount; p0++) {
+      for (int p1 = p0; p1 < kRankCount; p1++) {
+        for (int t0 = 0; t0 < kRankCount; t0++) {
+          for (int t1 = t0; t1 < kRankCount; t1++) {
+            for (int t2 = t1; t2 < kRankCount; t2++) {
+              std::array<int, kRankCount> counts{};
+              for (int rank : {p0, p1, t0, t1, t2}) {
+                counts[rank]++;
+              }
+              // Deal each rank's cards to the suits in turn
+              std::array<uint32_t, kSuitCount> suits{};
+              bool possible = true;
+              for (int rank = 0; rank < kRankCount; rank++) {
+                possible = possible && counts[rank] <= kSuitCount;
+                for (int s = 0; s < counts[rank] && s < kSuitCount; s++) {
+                  suits[s] |= 1u << (rank + static_cast<int>(Rank::TWO));
+                }
+              }
+              int triple =
+                  kTripleClassOf[(t0 * kRankCount + t1) * kRankCount + t2];
+              (*values)[triple * kPairClasses + PairClass(p0, p1)] =
+                  possible ? card_mask_internal::EvaluateNoFlush(
+                                 suits[0], suits[1], suits[2], suits[3])
+                           : 0;
+            }
+          }
+        }
+      }
+    }
+    return values;
+  }();
+  return kValues->data();
+}
+
+void Evaluator::SetBoard(uint64_t board) {
+  std::array<int, kMaxCommunityCards> bits;
+  int count = 0;
+  for (uint64_t mask = board; mask != 0; mask &= mask - 1) {
+    if (count == kMaxCommunityCards) {
+      count++;
+      break;
+    }
+    bits[count++] = __builtin_ctzll(mask);
+  }
+  if (count < 3 || count > kMaxCommunityCards) {
+    throw std::invalid_argument("Omaha boards have three to five cards");
+  }
+
+  const int32_t* rank_values = RankValues();
+  board_ = board;
+  int triple_count = 0;
+  flush_triple_count_ = 0;
+  for (int i = 0; i < count; i++) {
+    for (int j = i + 1; j < count; j++) {
+      for (int k = j + 1; k < count; k++) {
+        std::array<int, 3> ranks = {
+            bits[i] % 16 - static_cast<int>(Rank::TWO),
+            bits[j] % 16 - static_cast<int>(Rank::TWO),
+            bits[k] % 16 - static_cast<int>(Rank::TWO)};
+        std::sort(ranks.begin(), ranks.end());
+        const int32_t* row =
+            rank_values +
+            kTripleClassOf[(ranks[0] * kRankCount + ranks[1]) * kRankCount +
+                           ranks[2]] * kPairClasses;
+        // A paired board repeats rank classes
+        if (std::find(triple_rows_.begin(), triple_rows_.begin() + triple_count,
+                      row) == triple_rows_.begin() + triple_count) {
+          triple_rows_[triple_count++] = row;
+        }
+        int suit = bits[i] / 16;
+        if (suit == bits[j] / 16 && suit == bits[k] / 16) {
+          flush_triples_[flush_triple_count_++] = {
+              (1u << (bits[i] % 16)) | (1u << (bits[j] % 16)) |
+                  (1u << (bits[k] % 16)),
+              suit};
+        }
+      }
+    }
+  }
+  std::fill(triple_rows_.begin() + triple_count, triple_rows_.end(),
+            triple_rows_[0]);
+}
+
+} // namespace poker::omaha
@@ -0,0 +1,139 @@
+#ifndef OMAHA_H
+#define OMAHA_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "card_mask.h"
+#include "holdem.h"
+#include "poker.h"
+
+namespace poker::omaha {
+
+// Hole cards dealt to each player in Omaha
+constexpr int kHoleCards = 4;
+
+// Rank classes: the multisets of two ranks of a hole pair and of three ranks
+// of a board triple (see Evaluator)
+constexpr int kPairClasses = kRankCount * (kRankCount + 1) / 2;
+constexpr int kTripleClasses =
+    kRankCount * (kRankCount + 1) * (kRankCount + 2) / 6;
+
+// Rank class of ranks r0 <= r1 (0-based): pairs are numbered by r0, then r1.
+constexpr int PairClass(int r0, int r1) {
+  return r0 * kRankCount - r0 * (r0 - 1) / 2 + r1 - r0;
+}
+
+// PairClass() of two cards by their bits in a card mask modulo 16, at
+// bit0 * 16 + bit1 in either order.
+constexpr std::array<uint8_t, 16 * 16> kPairClassOfBits = [] {
+  std::array<uint8_t, 16 * 16> classes{};
+  const int low = static_cast<int>(Rank::TWO);
+  for (int b0 = low; b0 < low + kRankCount; b0++) {
+    for (int b1 = low; b1 < low + kRankCount; b1++) {
+      classes[b0 * 16 + b1] = static_cast<uint8_t>(
+          PairClass(std::min(b0, b1) - low, std::max(b0, b1) - low));
+    }
+  }
+  return classes;
+}();
+
+// Evaluates Omaha hands against one board: the best five-card hand made of
+// exactly two hole cards and exactly three board cards, as a sort code (see
+// card_mask.h).
+//
+// A straightforward evaluation tries each of the 6 hole card pairs with each
+// of the (up to) 10 board triples, 60 hand evaluations per player.  Without a
+// flush the value of a pair with a triple only depends on their ranks, so it
+// is looked up in a table by the triple's rank class (one of 455 multisets of
+// three ranks) and the pair's (one of 91 multisets of two).  The board is the
+// same for every player, so SetBoard() finds the table rows of its distinct
+// triple rank classes once per street, and every player's pairs read the
+// same few rows, which stay in cache.  Only a triple of one suit with a pair
+// of its suit can make a flush, which is evaluated on its own.
+class Evaluator {
+public:
+  Evaluator() = default;
+  explicit Evaluator(uint64_t board) { SetBoard(board); }
+
+  // Precomputes the board's triples.  Throws std::invalid_argument unless
+  // board has three to five cards.
+  void SetBoard(uint64_t board);
+  uint64_t board() const { return board_; }
+
+  // Returns the sort code of the best hand of hole (two to four cards not on
+  // the board) with the board.
+  int32_t Evaluate(uint64_t hole) const;
+
+private:
+  static constexpr int kMaxTriples = 10;
+
+  // Sort codes without a flush, by triple rank class * kPairClasses + pair
+  // rank class (0 for five cards of a rank)
+  static const int32_t* RankValues();
+
+  // A monotone triple, which can make a flush with a pair of its suit
+  struct FlushTriple {
+    uint32_t ranks;
+    int suit;
+  };
+
+  uint64_t board_{};
+  // RankValues() rows of the board's distinct triple rank classes, padded
+  // with repeats of the first so every evaluation reads a fixed number
+  std::array<const int32_t*, kMaxTriples> triple_rows_{};
+  std::array<FlushTriple, kMaxTriples> flush_triples_{};
+  int flush_triple_count_{};
+};
+
+// Game rules policy (see holdem::HoldemRules) for pot-limit Omaha.
+struct Rules {
+  using Deck = ::Deck;
+  using Ranking = StandardRanking;
+  static constexpr int kHoleCards = omaha::kHoleCards;
+  static constexpr int kHoleHandCount = 0;
+  static constexpr bool kPotLimit = true;
+  using Showdown = Evaluator;
+};
+
+// Plays hands of pot-limit Omaha at one table, with hold'em's betting
+// structure (see holdem::Game) and player models.
+template <typename RNG, typename STATS,
+          typename MODELS = holdem::PlayerModels>
+using Game = holdem::Game<RNG, STATS, MODELS, Rules>;
+
+inline int32_t Evaluator::Evaluate(uint64_t hole) const {
+  using namespace card_mask_internal;
+  std::array<int, kHoleCards> bits;
+  int count = 0;
+  for (; hole != 0 && count < kHoleCards; hole &= hole - 1) {
+    bits[count++] = __builtin_ctzll(hole);
+  }
+
+  int32_t best = 0;
+  for (int i = 0; i < count; i++) {
+    for (int j = i + 1; j < count; j++) {
+      int pair = kPairClassOfBits[(bits[i] % 16) * 16 + bits[j] % 16];
+      for (const int32_t* row : triple_rows_) {
+        best = std::max(best, row[pair]);
+      }
+      int suit = bits[i] / 16;
+      if (flush_triple_count_ == 0 || suit != bits[j] / 16) {
+        continue;
+      }
+      uint32_t pair_ranks = (1u << (bits[i] % 16)) | (1u << (bits[j] % 16));
+      for (int t = 0; t < flush_triple_count_; t++) {
+        if (flush_triples_[t].suit == suit) {
+          best = std::max(best,
+                          EvaluateFlush(flush_triples_[t].ranks | pair_ranks));
+        }
+      }
+    }
+  }
+  return best;
+}
+
+} // namespace poker::omaha
+
+#endif // OMAHA_H
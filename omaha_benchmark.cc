@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "card_mask.h"
+#include "holdem.h"
+#include "omaha.h"
+#include "player_model_holdem.h"
+#include "poker.h"
+
+//
+// Compares Omaha showdown evaluation by brute force (every pair of hole
+// cards with every triple of board cards through EvaluateCardMask) with
+// omaha::Evaluator, which prepares the board once for every player, and the
+// Omaha engine's hand throughput with hold'em's. Showdown rates count one
+// player's hand evaluated, engine rates count whole table hands played.
+//
+// Usage: omaha_benchmark [players] [hands]
+//
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using poker::holdem::NullStatistics;
+
+double Seconds(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void Report(const std::string& name, uint64_t count, double seconds,
+            double baseline, const char* unit) {
+  double rate = count / seconds;
+  std::cout << std::left << std::setw(32) << name << std::right
+            << std::setw(12) << static_cast<uint64_t>(rate) << " " << unit
+            << "/s";
+  if (baseline > 0) {
+    std::cout << "  (" << std::fixed << std::setprecision(2)
+              << rate / baseline << "x)";
+  }
+  std::cout << std::endl;
+}
+
+// One showdown: a five card board and each player's four hole cards.
+struct Deal {
+  uint64_t board;
+  std::array<uint64_t, poker::kMaxPlayers> hole;
+};
+
+std::vector<Deal> RandomDeals(int players, int count) {
+  std::mt19937 rng(1);
+  std::array<int, poker::kCardCount> deck;
+  for (int i = 0; i < poker::kCardCount; i++) {
+    deck[i] = i;
+  }
+  std::vector<Deal> deals(count);
+  for (Deal& deal : deals) {
+    std::shuffle(deck.begin(), deck.end(), rng);
+    int next = 0;
+    deal.board = 0;
+    for (int i = 0; i < poker::kMaxCommunityCards; i++) {
+      deal.board |= poker::IndexToCardMask(deck[next++]);
+    }
+    for (int p = 0; p < players; p++) {
+      deal.hole[p] = 0;
+      for (int i = 0; i < poker::omaha::kHoleCards; i++) {
+        deal.hole[p] |= poker::IndexToCardMask(deck[next++]);
+      }
+    }
+  }
+  return deals;
+}
+
+// Splits cards into single card masks and returns how many there are.
+int Split(uint64_t cards, uint64_t* split) {
+  int count = 0;
+  for (; cards != 0; cards &= cards - 1) {
+    split[count++] = cards & -cards;
+  }
+  return count;
+}
+
+// The best of the 60 five-card hands, each evaluated from scratch.
+int32_t EvaluateBruteForce(uint64_t hole, uint64_t board) {
+  std::array<uint64_t, poker::omaha::kHoleCards> h;
+  std::array<uint64_t, poker::kMaxCommunityCards> b;
+  int hole_cards = Split(hole, h.data());
+  int board_cards = Split(board, b.data());
+  int32_t best = 0;
+  for (int i = 0; i < hole_cards; i++) {
+    for (int j = i + 1; j < hole_cards; j++) {
+      for (int k = 0; k < board_cards; k++) {
+        for (int l = k + 1; l < board_cards; l++) {
+          for (int m = l + 1; m < board_cards; m++) {
+            best = std::max(best, poker::EvaluateCardMask(
+                                      h[i] | h[j] | b[k] | b[l] | b[m]));
+          }
+        }
+      }
+    }
+  }
+  return best;
+}
+
+double RunBruteForce(const std::vector<Deal>& deals, int players) {
+  int64_t sum = 0;
+  auto start = Clock::now();
+  for (const Deal& deal : deals) {
+    for (int p = 0; p < players; p++) {
+      sum += EvaluateBruteForce(deal.hole[p], deal.board);
+    }
+  }
+  double seconds = Seconds(start);
+  if (sum == 0) {
+    std::cout << sum;
+  }
+  uint64_t hands = static_cast<uint64_t>(deals.size()) * players;
+  Report("Showdown/brute force", hands, seconds, 0, "player hands");
+  return hands / seconds;
+}
+
+void RunEvaluator(const std::vector<Deal>& deals, int players,
+                  double baseline) {
+  int64_t sum = 0;
+  poker::omaha::Evaluator evaluator;
+  auto start = Clock::now();
+  for (const Deal& deal : deals) {
+    evaluator.SetBoard(deal.board);
+    for (int p = 0; p < players; p++) {
+      sum += evaluator.Evaluate(deal.hole[p]);
+    }
+  }
+  double seconds = Seconds(start);
+  if (sum == 0) {
+    std::cout << sum;
+  }
+  Report("Showdown/omaha::Evaluator", static_cast<uint64_t>(deals.size()) *
+         players, seconds, baseline, "player hands");
+}
+
+template <typename RULES>
+double RunEngine(const std::string& name, int players, int hands,
+                 double baseline) {
+  using Model = poker::holdem::PlayerModelShowdown;
+  poker::Table table;
+  std::vector<poker::Player> seats(players);
+  NullStatistics stats;
+  std::mt19937 rng(1);
+  poker::holdem::Game<std::mt19937, NullStatistics,
+                      poker::holdem::SamePlayerModel<Model>, RULES>
+      game(table, seats, poker::holdem::SamePlayerModel<Model>(), stats, rng);
+  auto start = Clock::now();
+  for (int i = 0; i < hands; i++) {
+    game.Play();
+  }
+  double seconds = Seconds(start);
+  Report("Engine/" + name, hands, seconds, baseline, "table hands");
+  return hands / seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  int players = argc > 1 ? std::atoi(argv[1]) : 6;
+  int hands = argc > 2 ? std::atoi(argv[2]) : 1'000'000;
+  if (players < 2 || players > 10) {
+    std::cerr << "Omaha deals 2 to 10 players" << std::endl;
+    return 1;
+  }
+
+  std::cout << "Players: " << players << ", hands: " << hands << std::endl;
+  std::vector<Deal> deals = RandomDeals(players, hands / 10);
+  double baseline = RunBruteForce(deals, players);
+  RunEvaluator(deals, players, baseline);
+  baseline = RunEngine<poker::holdem::HoldemRules>("holdem", players, hands,
+                                                   0);
+  RunEngine<poker::omaha::Rules>("omaha", players, hands, baseline);
+  return 0;
+}
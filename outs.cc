@@ -0,0 +1,69 @@
+#include "outs.h"
+
+#include <stdexcept>
+
+namespace poker {
+
+namespace {
+
+int HandTypeOf(int32_t sort_code) {
+  return sort_code >> 20;
+}
+
+// HandType made by the cards of a board alone.  Short of five cards only
+// ranks can match up, so only pairs, trips and quads count.
+int BoardHandType(uint64_t board) {
+  if (__builtin_popcountll(board) >= 5) {
+    return HandTypeOf(EvaluateCardMask(board));
+  }
+  uint32_t s0 = SuitRanks(board, 0);
+  uint32_t s1 = SuitRanks(board, 1);
+  uint32_t s2 = SuitRanks(board, 2);
+  uint32_t s3 = SuitRanks(board, 3);
+  uint32_t two_or_more =
+      (s0 & s1) | (s0 & s2) | (s0 & s3) | (s1 & s2) | (s1 & s3) | (s2 & s3);
+  uint32_t odd = s0 ^ s1 ^ s2 ^ s3;
+  uint32_t quads = s0 & s1 & s2 & s3;
+  uint32_t trips = two_or_more & odd;
+  int pairs = __builtin_popcount(two_or_more & ~odd & ~quads);
+  if (quads != 0) {
+    return static_cast<int>(HandType::FOUR_OF_A_KIND);
+  }
+  if (trips != 0) {
+    return static_cast<int>(pairs > 0 ? HandType::FULL_HOUSE
+                                      : HandType::THREE_OF_A_KIND);
+  }
+  return static_cast<int>(pairs >= 2 ? HandType::TWO_PAIR
+                          : pairs == 1 ? HandType::ONE_PAIR
+                                       : HandType::HIGH_CARD);
+}
+
+} // namespace
+
+Outs ComputeOuts(uint64_t hole, uint64_t board) {
+  const int board_cards = __builtin_popcountll(board);
+  if (__builtin_popcountll(hole) != 2 || board_cards < 3 || board_cards > 4 ||
+      (hole & board) != 0 || ((hole | board) & ~kFullDeckMask) != 0) {
+    throw std::invalid_argument(
+        "Outs need two hole cards and a board of three or four");
+  }
+  Outs outs{};
+  const uint64_t cards = hole | board;
+  outs.strength = EvaluateCardMask(cards);
+  outs.unseen = kFullDeckMask & ~cards;
+  const int type = HandTypeOf(outs.strength);
+  for (uint64_t unseen = outs.unseen; unseen != 0; unseen &= unseen - 1) {
+    int bit = __builtin_ctzll(unseen);
+    uint64_t card = uint64_t{1} << bit;
+    int32_t strength = EvaluateCardMask(cards | card);
+    int next_type = HandTypeOf(strength);
+    outs.next_strength[(bit / 16) * kRankCount + bit % 16 - 2] = strength;
+    outs.by_type[next_type]++;
+    if (next_type > type && next_type > BoardHandType(board | card)) {
+      outs.outs |= card;
+    }
+  }
+  return outs;
+}
+
+} // namespace poker
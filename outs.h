@@ -0,0 +1,41 @@
+#ifndef OUTS_H
+#define OUTS_H
+
+#include <array>
+#include <cstdint>
+
+#include "card_mask.h"
+#include "poker.h"
+
+namespace poker {
+
+// What each unseen card would do for two hole cards on a flop or turn.
+struct Outs {
+  // Sort code of the hand now
+  int32_t strength;
+  // Sort code with each unseen card added, by card index (see card_mask.h);
+  // zero for cards already in the hand or on the board
+  std::array<int32_t, kCardCount> next_strength;
+  // Card masks of the unseen cards and of the outs among them: cards that
+  // raise the hand's HandType beyond what the board makes by itself, so the
+  // improvement is the player's rather than shared with everyone
+  uint64_t unseen;
+  uint64_t outs;
+  // Unseen cards by the HandType they make
+  std::array<uint8_t, kHandTypeMax> by_type;
+
+  int count() const { return __builtin_popcountll(outs); }
+};
+
+// Scores every unseen card in one pass over the deck mask: the hand and
+// board masks are built once and each card costs an EvaluateCardMask() of
+// the hand with it, plus a BoardHandType() of the board with it when the
+// card improves the hand type (another EvaluateCardMask() on the turn, where
+// the board reaches five cards).  About two microseconds.  Throws
+// std::invalid_argument unless hole is two cards and board three or four
+// others.
+Outs ComputeOuts(uint64_t hole, uint64_t board);
+
+} // namespace poker
+
+#endif // OUTS_H
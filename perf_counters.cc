@@ -0,0 +1,191 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace poker {
+
+#ifdef __linux__
+
+namespace {
+
+constexpr uint64_t kPerfConfig[] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int OpenCounter(uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  // User space only; this is all that perf_event_paranoid=2 permits and it is
+  // where the simulation spends its time anyway.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+  fd_.fill(-1);
+  for (int i = 0; i < kPerfCounterMax; i++) {
+    fd_[i] = OpenCounter(kPerfConfig[i]);
+    if (fd_[i] < 0) {
+      std::stringstream ss;
+      if (!error_.empty()) {
+        ss << error_ << "; ";
+      }
+      ss << kPerfCounter[i] << ": " << strerror(errno);
+      if (errno == EACCES || errno == EPERM) {
+        ss << " (check /proc/sys/kernel/perf_event_paranoid)";
+      }
+      error_ = ss.str();
+      continue;
+    }
+    ioctl(fd_[i], PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_[i], PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fd_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+void PerfCounters::Read(PerfSample* sample) const {
+  // value, time_enabled, time_running
+  uint64_t buf[3];
+  for (int i = 0; i < kPerfCounterMax; i++) {
+    if (fd_[i] < 0 || read(fd_[i], buf, sizeof(buf)) != sizeof(buf)) {
+      sample->value[i] = 0;
+      continue;
+    }
+    // Scale if the PMU had to multiplex this counter with other events
+    if (buf[2] != 0 && buf[2] < buf[1]) {
+      buf[0] = static_cast<uint64_t>(
+          static_cast<double>(buf[0]) * buf[1] / buf[2]);
+    }
+    sample->value[i] = buf[0];
+  }
+}
+
+#else // __linux__
+
+PerfCounters::PerfCounters() {
+  fd_.fill(-1);
+  error_ = "hardware performance counters are only supported on Linux";
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::Read(PerfSample* sample) const {
+  sample->value.fill(0);
+}
+
+#endif // __linux__
+
+bool PerfCounters::enabled() const {
+  for (int fd : fd_) {
+    if (fd >= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PerfProfile::End(int phase) {
+  counters_.Read(&end_);
+  PerfSample& total = totals_[phase];
+  for (int i = 0; i < kPerfCounterMax; i++) {
+    total.value[i] += end_.value[i] - begin_.value[i];
+  }
+}
+
+namespace {
+
+void DisplayPerHand(std::ostream& os, const PerfCounters& counters,
+                    const PerfSample& delta, uint64_t hands) {
+  for (int i = 0; i < kPerfCounterMax; i++) {
+    os << ",";
+    if (counters.enabled(static_cast<PerfCounter>(i))) {
+      os << static_cast<double>(delta.value[i]) / hands;
+    } else {
+      os << "n/a";
+    }
+  }
+  os << ",";
+  if (counters.enabled(PerfCounter::CYCLES) &&
+      counters.enabled(PerfCounter::INSTRUCTIONS) &&
+      delta.value[static_cast<int>(PerfCounter::CYCLES)] != 0) {
+    os << static_cast<double>(
+              delta.value[static_cast<int>(PerfCounter::INSTRUCTIONS)]) /
+          delta.value[static_cast<int>(PerfCounter::CYCLES)];
+  } else {
+    os << "n/a";
+  }
+  os << "\n";
+}
+
+void DisplayHeader(std::ostream& os, const char* first_column) {
+  os << first_column;
+  for (const char* name : kPerfCounter) {
+    os << "," << name;
+  }
+  os << ",ipc\n";
+}
+
+} // namespace
+
+void PerfProfile::Display(std::ostream& os, uint64_t hands) const {
+  if (hands == 0) {
+    return;
+  }
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(2);
+  DisplayHeader(os, "Phase (per hand)");
+  for (size_t i = 0; i < phases_.size(); i++) {
+    os << phases_[i];
+    DisplayPerHand(os, counters_, totals_[i], hands);
+  }
+  os.flags(flags);
+}
+
+void DisplayPerfSample(std::ostream& os, const PerfCounters& counters,
+                       const PerfSample& begin, const PerfSample& end,
+                       uint64_t hands) {
+  if (hands == 0) {
+    return;
+  }
+  PerfSample delta;
+  for (int i = 0; i < kPerfCounterMax; i++) {
+    delta.value[i] = end.value[i] - begin.value[i];
+  }
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(2);
+  DisplayHeader(os, "Main loop (per hand)");
+  os << "total";
+  DisplayPerHand(os, counters, delta, hands);
+  os.flags(flags);
+}
+
+} // namespace poker
@@ -0,0 +1,86 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace poker {
+
+enum class PerfCounter {
+  CYCLES,
+  INSTRUCTIONS,
+  CACHE_MISSES,
+  BRANCH_MISSES,
+  MAX
+};
+
+constexpr int kPerfCounterMax = static_cast<int>(PerfCounter::MAX);
+constexpr const char* const kPerfCounter[] = {
+  "cycles", "instructions", "cache-misses", "branch-misses" };
+
+struct PerfSample {
+  std::array<uint64_t, kPerfCounterMax> value{};
+};
+
+// Hardware performance counters for the calling thread, opened with
+// perf_event_open(2).  Only available on Linux.  If the kernel refuses a
+// counter (e.g. perf_event_paranoid inside a container, or an event the
+// virtualized PMU doesn't expose) that counter is left disabled and reads as
+// zero; callers should check enabled() and report error() instead of failing.
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Returns true if at least one counter could be opened.
+  bool enabled() const;
+  bool enabled(PerfCounter counter) const {
+    return fd_[static_cast<int>(counter)] >= 0;
+  }
+  const std::string& error() const { return error_; }
+
+  // Reads the current (cumulative) value of every enabled counter.
+  void Read(PerfSample* sample) const;
+
+private:
+  std::array<int, kPerfCounterMax> fd_;
+  std::string error_;
+};
+
+// Accumulates counter deltas into a fixed set of named phases.  Begin() takes a
+// snapshot and End(phase) charges everything since that snapshot to phase.
+// Each boundary costs one read(2) per counter, so phase totals include that
+// overhead and are meant for relative comparison between phases.
+class PerfProfile {
+public:
+  PerfProfile(const PerfCounters& counters, std::vector<std::string> phases)
+    : counters_(counters), phases_(std::move(phases)),
+      totals_(phases_.size()) {}
+
+  void Begin() { counters_.Read(&begin_); }
+  void End(int phase);
+
+  // Writes per-hand averages for each phase.
+  void Display(std::ostream& os, uint64_t hands) const;
+
+private:
+  const PerfCounters& counters_;
+  std::vector<std::string> phases_;
+  std::vector<PerfSample> totals_;
+  PerfSample begin_;
+  PerfSample end_;
+};
+
+// Writes per-hand averages of the counter deltas between begin and end.
+void DisplayPerfSample(std::ostream& os, const PerfCounters& counters,
+                       const PerfSample& begin, const PerfSample& end,
+                       uint64_t hands);
+
+} // namespace poker
+
+#endif // PERF_COUNTERS_H
@@ -1,9 +1,17 @@
 #ifndef PLAYER_MODEL_H
 #define PLAYER_MODEL_H
 
+#include <cstdint>
+
 namespace poker {
 
-enum class PlayerAction {
+// Actions a player model can take.  CHECK checks, or calls the current bet
+// (all-in if the player can't cover it).  RAISE raises by the minimum legal
+// amount and RAISE_ALL_IN puts the player's whole stack in; a raise the
+// player can't afford plays as all-in.  An all-in short of a full raise
+// doesn't reopen the betting, so players who already acted can only call it
+// and a raise from them plays as CHECK.
+enum class PlayerAction : uint8_t {
   UNSPECIFIED = 0,
   FOLD,
   CHECK,
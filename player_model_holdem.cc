@@ -1,19 +1,137 @@
 #include "player_model_holdem.h"
 
+#include "card_mask.h"
 #include "holdem.h"
 #include "player_model.h"
 #include "poker.h"
 
 namespace poker::holdem {
 
-PlayerAction PlayerModelShowdown::Act(const Table& table, Round round,
-                                      int position, Player& player) {
-  return PlayerAction::CHECK;
+namespace {
+
+// Ranks as card_mask.h rank offsets (two = 0 ... ace = 12)
+constexpr int kTen = 8;
+constexpr int kJack = 9;
+constexpr int kQueen = 10;
+constexpr int kKing = 11;
+constexpr int kAce = 12;
+
+// A hole hand class as its two ranks, high first
+struct HoleHandClass {
+  int high;
+  int low;
+  bool suited;
+
+  bool pair() const { return high == low; }
+  bool Is(int h, int l) const { return high == h && low == l; }
+  bool Suited(int h, int l) const { return suited && Is(h, l); }
+  bool Offsuit(int h, int l) const { return !suited && Is(h, l); }
+  bool PairAtLeast(int rank) const { return pair() && high >= rank; }
+};
+
+enum class Range { EARLY, MIDDLE, LATE };
+
+bool InRaiseRange(const HoleHandClass& hand, Range range) {
+  // Early: 99+, ATs+, KQs, AQo+
+  if (hand.PairAtLeast(7) || (hand.suited && hand.high == kAce &&
+                              hand.low >= kTen) ||
+      hand.Suited(kKing, kQueen) ||
+      (!hand.suited && hand.high == kAce && hand.low >= kQueen)) {
+    return true;
+  }
+  if (range == Range::EARLY) {
+    return false;
+  }
+  // Middle: 77-88, A8s-A9s, KJs, QJs, JTs, AJo, KQo
+  if (hand.PairAtLeast(5) || (hand.suited && hand.high == kAce &&
+                              hand.low >= 6) ||
+      hand.Suited(kKing, kJack) || hand.Suited(kQueen, kJack) ||
+      hand.Suited(kJack, kTen) || hand.Offsuit(kAce, kJack) ||
+      hand.Offsuit(kKing, kQueen)) {
+    return true;
+  }
+  if (range == Range::MIDDLE) {
+    return false;
+  }
+  // Late: any pair, any suited ace, KTs, QTs, J9s, T9s, 98s, ATo, KJo, QJo
+  return hand.pair() || (hand.suited && hand.high == kAce) ||
+         hand.Suited(kKing, kTen) || hand.Suited(kQueen, kTen) ||
+         hand.Suited(kJack, 7) || hand.Suited(kTen, 7) || hand.Suited(7, 6) ||
+         hand.Offsuit(kAce, kTen) || hand.Offsuit(kKing, kJack) ||
+         hand.Offsuit(kQueen, kJack);
+}
+
+PlayerAction FacingBet(const HoleHandClass& hand) {
+  if (hand.PairAtLeast(kQueen) || hand.Is(kAce, kKing)) {
+    return PlayerAction::RAISE;
+  }
+  if (hand.PairAtLeast(kTen) || hand.Suited(kAce, kQueen) ||
+      hand.Suited(kAce, kJack) || hand.Suited(kKing, kQueen) ||
+      hand.Offsuit(kAce, kQueen)) {
+    return PlayerAction::CHECK;
+  }
+  return PlayerAction::FOLD;
+}
+
+PlayerAction Unopened(const HoleHandClass& hand, int chart_position,
+                      Round round) {
+  bool early = InRaiseRange(hand, Range::EARLY);
+  if (round != Round::PREFLOP) {
+    return early ? PlayerAction::RAISE : PlayerAction::CHECK;
+  }
+  if (chart_position == PlayerModelMillerTight::kBigBlind) {
+    return early ? PlayerAction::RAISE : PlayerAction::CHECK;
+  }
+  Range range;
+  if (chart_position <= PlayerModelMillerTight::kButton + 1) {
+    // Small blind, button and cutoff
+    range = Range::LATE;
+  } else if (chart_position <= PlayerModelMillerTight::kButton + 4) {
+    range = Range::MIDDLE;
+  } else {
+    range = Range::EARLY;
+  }
+  return InRaiseRange(hand, range) ? PlayerAction::RAISE : PlayerAction::FOLD;
 }
 
-PlayerAction PlayerModelMillerTight::Act(const Table& table, Round round,
-                                         int position, Player& player) {
-  return PlayerAction::CHECK;
+PlayerModelMillerTight::Chart BuildMillerTightChart() {
+  PlayerModelMillerTight::Chart chart{};
+  auto set = [&chart](int index, PlayerAction action) {
+    int code = static_cast<int>(action) - 1;
+    chart[index >> 2] |= static_cast<uint8_t>(code << ((index & 3) * 2));
+  };
+  for (int high = 0; high < kRankCount; high++) {
+    for (int low = 0; low <= high; low++) {
+      for (bool suited : {false, true}) {
+        if (suited && high == low) {
+          continue;
+        }
+        HoleHandClass hand{high, low, suited};
+        // Cards of the two ranks in the first one or two suits
+        int hole_hand = HoleHandIndex(high, (suited ? 0 : kRankCount) + low);
+        for (int position = 0;
+             position < PlayerModelMillerTight::kChartPositions; position++) {
+          for (Round round : {Round::PREFLOP, Round::FLOP, Round::TURN,
+                              Round::RIVER}) {
+            set(PlayerModelMillerTight::ChartIndex(position, round, false,
+                                                   hole_hand),
+                Unopened(hand, position, round));
+            set(PlayerModelMillerTight::ChartIndex(position, round, true,
+                                                   hole_hand),
+                FacingBet(hand));
+          }
+        }
+      }
+    }
+  }
+  return chart;
+}
+
+} // namespace
+
+PlayerModelMillerTight::PlayerModelMillerTight() {
+  static const Chart chart = BuildMillerTightChart();
+  chart_ = &chart;
 }
 
 } // namespace poker::holdem
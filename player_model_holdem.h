@@ -1,46 +1,150 @@
 #ifndef PLAYER_MODEL_HOLDEM_H
 #define PLAYER_MODEL_HOLDEM_H
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 
+#include "card_mask.h"
 #include "holdem.h"
 #include "player_model.h"
 #include "poker.h"
 
 namespace poker::holdem {
 
-class PlayerModelShowdown : public PlayerModel {
+class PlayerModelShowdown final : public PlayerModel {
  public:
   virtual ~PlayerModelShowdown() override = default;
   static const std::string name() { return "showdown"; }
   PlayerAction Act(const Table &table, Round round, int position,
-                   Player &player) override;
+                   Player &player) override {
+    return PlayerAction::CHECK;
+  }
+  void ActMany(const DecisionView& view, PlayerAction* actions) override {
+    std::fill(actions, actions + view.count, PlayerAction::CHECK);
+  }
 };
 
-class PlayerModelMillerTight : public PlayerModel {
+// A tight player in the style of Ed Miller's starting hand charts.  Every
+// decision is a lookup in a chart keyed by position, hole hand class, round
+// and whether the player faces a bet or raise:
+//
+//  - Unopened, it raises 99+, ATs+, KQs, AQo+ from early position, adds
+//    77-88, A8s-A9s, KJs, QJs, JTs, AJo and KQo in middle position and any
+//    pair, any suited ace, KTs, QTs, J9s, T9s, 98s, ATo, KJo and QJo from
+//    the cutoff, button and small blind, and folds everything else.  The big
+//    blind checks what it wouldn't raise from early position.
+//  - Facing a raise it re-raises QQ+ and AK, calls JJ-TT, AQs, AJs, KQs and
+//    AQo, and folds the rest.
+//  - After the flop it bets its early position hands and checks the others,
+//    and plays the preflop facing-a-raise ranges against a bet.
+//
+// Positions are counted back from the button (cutoff, hijack, ...) so the
+// same seat plays the same range at any table size.
+class PlayerModelMillerTight final : public PlayerModel {
  public:
+  PlayerModelMillerTight();
   virtual ~PlayerModelMillerTight() override = default;
   static const std::string name() { return "miller_tight"; }
   PlayerAction Act(const Table &table, Round round, int position,
-                   Player &player) override;
+                   Player &player) override {
+    int players = table.players().size();
+    bool facing_bet = table.bet() >
+        (round == Round::PREFLOP ? table.stakes().big_blind : 0);
+    const Player::Cards& cards = player.cards();
+    return Decide(players,
+                  PositionFromButton(position, table.button(), players),
+                  round, facing_bet,
+                  HoleHandIndex(CardToIndex(cards[0]), CardToIndex(cards[1])));
+  }
+  void ActMany(const DecisionView& view, PlayerAction* actions) override {
+    for (int i = 0; i < view.count; i++) {
+      actions[i] = Decide(view.players[i], view.position[i], view.round,
+                          view.raises[i] > 0, view.hole_hand[i]);
+    }
+  }
+
+  // Chart positions: the blinds, then the button and the seats before it.
+  static constexpr int kSmallBlind = 0;
+  static constexpr int kBigBlind = 1;
+  static constexpr int kButton = 2;
+  static constexpr int kChartPositions = kButton + kMaxPlayers - 2;
+
+  // Maps a PositionFromButton() at a table of players to a chart position.
+  static int ChartPosition(int players, int position) {
+    if (players == 2) {
+      // Heads up the button is the small blind
+      return position == 0 ? kSmallBlind : kBigBlind;
+    }
+    if (position == 0) {
+      return kButton;
+    }
+    return position <= 2 ? position - 1 : kButton + players - position;
+  }
+
+  // Actions are packed four to a byte, two bits each
+  static constexpr int kChartEntries =
+      kChartPositions * kRoundMax * 2 * kHoleHandCount;
+  using Chart = std::array<uint8_t, (kChartEntries + 3) / 4>;
+
+  static int ChartIndex(int chart_position, Round round, bool facing_bet,
+                        int hole_hand) {
+    return ((chart_position * kRoundMax + static_cast<int>(round)) * 2 +
+            facing_bet) * kHoleHandCount + hole_hand;
+  }
+
+ private:
+  PlayerAction Decide(int players, int position, Round round, bool facing_bet,
+                      int hole_hand) const {
+    int index = ChartIndex(ChartPosition(players, position), round,
+                           facing_bet, hole_hand);
+    int code = ((*chart_)[index >> 2] >> ((index & 3) * 2)) & 3;
+    return static_cast<PlayerAction>(code + 1);
+  }
+
+  // Built once and shared by every instance
+  const Chart* chart_;
 };
 
+template <typename MODEL>
+struct PlayerModelTag {
+  using type = MODEL;
+};
+
+// The registry of player models by name.  Visit(name, f) calls
+// f(PlayerModelTag<MODEL>()) for the model called name and returns false if
+// there is none, so callers can instantiate code for the concrete type (e.g.
+// Game with SamePlayerModel<MODEL>).
+template <typename... MODELS>
+struct PlayerModelRegistry {
+  template <typename F>
+  static bool Visit(std::string_view name, F&& f) {
+    return ((name == MODELS::name() ? (f(PlayerModelTag<MODELS>()), true)
+                                    : false) || ...);
+  }
+};
+
+using PlayerModelTypes =
+    PlayerModelRegistry<PlayerModelShowdown, PlayerModelMillerTight>;
+
 class PlayerModelFactory {
  public:
   static std::unique_ptr<PlayerModel> Create(std::string_view name) {
-    if (name == PlayerModelShowdown::name()) {
-      return std::make_unique<PlayerModelShowdown>();
-    } else if (name == PlayerModelMillerTight::name()) {
-      return std::make_unique<PlayerModelMillerTight>();
-    } else {
+    std::unique_ptr<PlayerModel> model;
+    PlayerModelTypes::Visit(name, [&model](auto tag) {
+      model = std::make_unique<typename decltype(tag)::type>();
+    });
+    if (!model) {
       std::stringstream ss;
       ss << "Unrecognized player model: " << name;
       throw std::invalid_argument(ss.str());
     }
+    return model;
   }
 };
 
@@ -1,5 +1,7 @@
 #include "poker.h"
 
+#include <sstream>
+
 #include "poker.pb.h"
 
 namespace poker {
@@ -40,12 +42,12 @@ std::ostream& operator<<(std::ostream& os, const HandType& type) {
 }
 
 std::ostream& operator<<(std::ostream& os, const Hand& hand) {
+  if (hand.type() != HandType::HANDTYPE_UNSPECIFIED) {
+    os << hand.type() << " ";
+  }
   for (int rank : hand.rank()) {
     os << static_cast<Rank>(rank);
   }
-  if (hand.type() != HandType::HANDTYPE_UNSPECIFIED) {
-    os << " (" << hand.type() << ")";
-  }
   return os;
 }
 
@@ -79,6 +81,116 @@ Hand SortCodeToHand(int32_t sort_code) {
   return hand;
 }
 
+namespace {
+
+template <typename RANKING>
+int32_t RanksToSortCode(HandType type, std::initializer_list<int> ranks) {
+  int32_t sort_code = static_cast<int32_t>(RANKING::kCategory[type]) << 20;
+  int shift = 16;
+  for (int rank : ranks) {
+    sort_code |= rank << shift;
+    shift -= 4;
+  }
+  return sort_code;
+}
+
+// Builds the sorted list of every sort code EvaluateCardMask<RANKING>() can
+// produce.
+template <typename RANKING>
+std::vector<int32_t> BuildHandValues() {
+  constexpr int kAce = static_cast<int>(Rank::ACE);
+  constexpr int kLow = RANKING::kLowRank;
+  // High card of the wheel
+  constexpr int kWheel = kLow + 3;
+  auto sort_code = RanksToSortCode<RANKING>;
+  std::vector<int32_t> values;
+  values.reserve(RANKING::kHandValueCount);
+
+  auto is_straight = [](int r0, int r1, int r2, int r3, int r4) {
+    return (r0 - r4 == 4) || (r0 == kAce && r1 == kWheel);
+  };
+  // Five distinct ranks: high card and flush (straights are handled below)
+  for (int r0 = kAce; r0 >= kLow; r0--)
+    for (int r1 = r0 - 1; r1 >= kLow; r1--)
+      for (int r2 = r1 - 1; r2 >= kLow; r2--)
+        for (int r3 = r2 - 1; r3 >= kLow; r3--)
+          for (int r4 = r3 - 1; r4 >= kLow; r4--) {
+            if (is_straight(r0, r1, r2, r3, r4))
+              continue;
+            values.push_back(
+                sort_code(HandType::HIGH_CARD, {r0, r1, r2, r3, r4}));
+            values.push_back(sort_code(HandType::FLUSH, {r0, r1, r2, r3, r4}));
+          }
+  // Straights, with the wheel written 5432A (A-high last) like HandEvaluator
+  for (int high = kWheel; high <= kAce; high++) {
+    int low = (high == kWheel) ? kAce : high - 4;
+    for (HandType type : {HandType::STRAIGHT, HandType::STRAIGHT_FLUSH}) {
+      values.push_back(
+          sort_code(type, {high, high - 1, high - 2, high - 3, low}));
+    }
+  }
+  for (int a = kAce; a >= kLow; a--) {
+    for (int b = kAce; b >= kLow; b--) {
+      if (b == a)
+        continue;
+      values.push_back(sort_code(HandType::FOUR_OF_A_KIND, {a, a, a, a, b}));
+      values.push_back(sort_code(HandType::FULL_HOUSE, {a, a, a, b, b}));
+      for (int c = b - 1; c >= kLow; c--) {
+        if (c == a)
+          continue;
+        values.push_back(
+            sort_code(HandType::THREE_OF_A_KIND, {a, a, a, b, c}));
+        if (b < a) {
+          // Two pair a > b with kicker c, plus the kickers above b
+          values.push_back(sort_code(HandType::TWO_PAIR, {a, a, b, b, c}));
+        }
+        for (int d = c - 1; d >= kLow; d--) {
+          if (d == a)
+            continue;
+          values.push_back(sort_code(HandType::ONE_PAIR, {a, a, b, c, d}));
+        }
+      }
+      if (b < a) {
+        for (int c = kAce; c > b; c--) {
+          if (c == a)
+            continue;
+          values.push_back(sort_code(HandType::TWO_PAIR, {a, a, b, b, c}));
+        }
+      }
+    }
+  }
+  std::sort(values.begin(), values.end());
+  assert(values.size() == RANKING::kHandValueCount);
+  return values;
+}
+
+template <typename RANKING>
+const std::vector<int32_t>& HandValues() {
+  static const std::vector<int32_t> values = BuildHandValues<RANKING>();
+  return values;
+}
+
+} // namespace
+
+template <typename RANKING>
+int HandValueIndex(int32_t sort_code) {
+  const std::vector<int32_t>& values = HandValues<RANKING>();
+  auto iter = std::lower_bound(values.begin(), values.end(), sort_code);
+  if (iter == values.end() || *iter != sort_code)
+    return -1;
+  return static_cast<int>(iter - values.begin());
+}
+
+template <typename RANKING>
+int32_t HandValueSortCode(int index) {
+  return HandValues<RANKING>()[index];
+}
+
+template int HandValueIndex<StandardRanking>(int32_t sort_code);
+template int HandValueIndex<ShortDeckRanking>(int32_t sort_code);
+template int32_t HandValueSortCode<StandardRanking>(int index);
+template int32_t HandValueSortCode<ShortDeckRanking>(int index);
+
 std::string HoleHandToString(const Hand& hand) {
   std::stringstream ss;
   ss << hand.rank(0) << hand.rank(1);
@@ -108,7 +220,18 @@ std::string CommunityCardsToString(const std::vector<Card>& community_cards) {
   return ss.str();
 }
 
-void HandEvaluator::Reset(const std::vector<Card>& community) {
+HandEvaluator::HandEvaluator() {
+  // Reserve the most cards each rank/suit can hold so that evaluation never
+  // has to grow these vectors.
+  for (int i=0; i<MAX_RANK; i++) {
+    rank_[i].reserve(MAX_SUIT);
+  }
+  for (int i=0; i<MAX_SUIT; i++) {
+    suit_[i].reserve(MAX_RANK);
+  }
+}
+
+void HandEvaluator::Reset(const Card* community, size_t count) {
   // Clear state
   memset(rank_reset_limit_, 0, sizeof(rank_reset_limit_));
   memset(suit_reset_limit_, 0, sizeof(suit_reset_limit_));
@@ -120,7 +243,8 @@ void HandEvaluator::Reset(const std::vector<Card>& community) {
   }
 
   // Add community cards
-  for (Card card : community) {
+  for (size_t i = 0; i < count; i++) {
+    const Card& card = community[i];
     int ranki = static_cast<int>(card.rank());
     rank_[ranki].push_back(card.suit());
     rank_reset_limit_[ranki] = rank_[ranki].size();
@@ -130,8 +254,9 @@ void HandEvaluator::Reset(const std::vector<Card>& community) {
   }
 }
 
-Hand HandEvaluator::Evaluate(const std::vector<Card>& hole) {
-  for (Card card : hole) {
+void HandEvaluator::Evaluate(const Card* hole, size_t count, Hand* out) {
+  for (size_t i = 0; i < count; i++) {
+    const Card& card = hole[i];
     rank_[static_cast<int>(card.rank())].push_back(card.suit());
     suit_[static_cast<int>(card.suit())].push_back(card.rank());
   }
@@ -222,13 +347,16 @@ Hand HandEvaluator::Evaluate(const std::vector<Card>& hole) {
     }
   }
 
-  Hand hand;
+  Hand& hand = *out;
+  hand.Clear();
 
   // Check for flush
   for (int i=0; i<MAX_SUIT; i++) {
     if (suit_[i].size() >= 5) {
-      std::vector<Rank> flush = suit_[i];
-      std::sort(flush.begin(), flush.end(), [](Rank lhs, Rank rhs) {
+      std::array<Rank, MAX_RANK> flush;
+      auto flush_end = std::copy(suit_[i].begin(), suit_[i].end(),
+                                 flush.begin());
+      std::sort(flush.begin(), flush_end, [](Rank lhs, Rank rhs) {
         return lhs > rhs;
       });
       // check for straight flush
@@ -236,7 +364,8 @@ Hand HandEvaluator::Evaluate(const std::vector<Card>& hole) {
         Rank straight_flush_high = Rank::RANK_UNSPECIFIED;
         int prev_rank = 0;
         int run_length = 0;
-        for (Rank rank : flush) {
+        for (auto iter = flush.begin(); iter != flush_end; ++iter) {
+          Rank rank = *iter;
           if (straight_flush_high == Rank::RANK_UNSPECIFIED ||
               static_cast<int>(rank) != prev_rank - 1) {
             if (rank <= Rank::FOUR)
@@ -345,7 +474,8 @@ Hand HandEvaluator::Evaluate(const std::vector<Card>& hole) {
   }
 
   // Reset community counters
-  for (Card card : hole) {
+  for (size_t i = 0; i < count; i++) {
+    const Card& card = hole[i];
     int ranki = static_cast<int>(card.rank());
     rank_[ranki].resize(rank_reset_limit_[ranki]);
     int suiti = static_cast<int>(card.suit());
@@ -354,7 +484,6 @@ Hand HandEvaluator::Evaluate(const std::vector<Card>& hole) {
   rank_[1].clear();
 
   hand.set_sort_code(HandToSortCode(hand));
-  return hand;
 }
 
 } // namespace poker
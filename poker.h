@@ -2,6 +2,7 @@
 #define POKER_H
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <functional>
@@ -10,8 +11,11 @@
 #include <random>
 #include <vector>
 
+#include "card_mask.h"
 #include "cards.h"
 #include "cards.pb.h"
+#include "fixed_vector.h"
+#include "player_model.h"
 #include "poker.pb.h"
 
 template<>
@@ -26,6 +30,61 @@ namespace poker {
 
 constexpr int kHandTypeMax = static_cast<int>(HandType::MAX);
 
+// Limits from the game rules, used to size per-hand state inline.  Hole
+// cards are as many as any supported game deals (Omaha's four).
+constexpr int kMaxPlayers = 10;
+constexpr int kMaxHoleCards = 4;
+constexpr int kMaxCommunityCards = 5;
+constexpr int kMaxRounds = 4;
+// Deepest starting stack, in big blinds (see Stakes::Valid()).  Every full
+// raise adds at least a big blind to the most any player has bet in the hand,
+// and each player can only go all-in for less than a full raise once, which
+// bounds the raises in a hand and so the length of its action log.
+constexpr int kMaxStackBigBlinds = 250;
+constexpr int kMaxRaises = kMaxStackBigBlinds + kMaxPlayers;
+// Every player acts once per round, and every other player once more after
+// each raise.
+constexpr int kMaxActions =
+    kMaxRounds * kMaxPlayers + kMaxRaises * (kMaxPlayers - 1);
+
+// Blinds and starting stacks, in chips.  Every player starts each hand with
+// stack chips unless seat_stacks has an entry for their seat.
+struct Stakes {
+  int small_blind = 1;
+  int big_blind = 2;
+  int stack = 200;
+  FixedVector<int, kMaxPlayers> seat_stacks;
+
+  int StackAt(int position) const {
+    return static_cast<size_t>(position) < seat_stacks.size()
+        ? seat_stacks[position] : stack;
+  }
+
+  // Whether the blinds are ordered and every stack is positive and at most
+  // kMaxStackBigBlinds big blinds.
+  bool Valid() const {
+    if (small_blind < 0 || big_blind <= 0 || small_blind > big_blind) {
+      return false;
+    }
+    for (size_t i = 0; i <= seat_stacks.size(); i++) {
+      int chips = i < seat_stacks.size() ? seat_stacks[i] : stack;
+      if (chips <= 0 || chips / big_blind > kMaxStackBigBlinds) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// One entry of a hand's action log.  amount is the player's total bet in the
+// round after the action.
+struct ActionLogEntry {
+  int8_t round;
+  int8_t position;
+  PlayerAction action;
+  int32_t amount;
+};
+
 inline bool operator==(const Hand& lhs, const Hand& rhs)
 {
   return lhs.sort_code() == rhs.sort_code();
@@ -37,6 +96,20 @@ std::ostream& operator<<(std::ostream& os, const Hand& hand);
 int32_t HandToSortCode(Hand& hand);
 Hand SortCodeToHand(int32_t sort_code);
 
+// Number of distinct five-card hand values (sort codes that HandEvaluator can
+// produce).  Counters indexed by HandValueIndex() instead of by sort code need
+// 7462 slots rather than kSortCodeLimit.
+constexpr int kHandValueCount = StandardRanking::kHandValueCount;
+
+// Returns the dense index of sort_code in [0, RANKING::kHandValueCount),
+// ordered by ascending sort code, or -1 if sort_code is not a valid hand
+// value under RANKING (see EvaluateCardMask()).  The underlying table is
+// built once per ranking and shared by all threads.
+template <typename RANKING = StandardRanking>
+int HandValueIndex(int32_t sort_code);
+template <typename RANKING = StandardRanking>
+int32_t HandValueSortCode(int index);
+
 // Returns a string representation of hole cards (e.g. "AA", "KJo", "65s").
 std::string HoleHandToString(const Hand& hand);
 
@@ -48,8 +121,19 @@ std::string CommunityCardsToString(const std::vector<Card>& community_cards);
 
 class HandEvaluator {
 public:
-  void Reset(const std::vector<Card>& community);
-  Hand Evaluate(const std::vector<Card>& hole);
+  HandEvaluator();
+  void Reset(const std::vector<Card>& community) {
+    Reset(community.data(), community.size());
+  }
+  void Reset(const Card* community, size_t count);
+  Hand Evaluate(const std::vector<Card>& hole) {
+    Hand hand;
+    Evaluate(hole.data(), hole.size(), &hand);
+    return hand;
+  }
+  // Evaluates into an existing hand, reusing its storage.  Once the evaluator
+  // and hand have warmed up this does not allocate.
+  void Evaluate(const Card* hole, size_t count, Hand* hand);
 private:
   static const int MAX_RANK = static_cast<int>(Rank_ARRAYSIZE);
   static const int MAX_SUIT = static_cast<int>(Suit_ARRAYSIZE);
@@ -61,42 +145,138 @@ private:
 
 class Player {
 public:
-  const std::vector<Card>& cards() const { return cards_; }
-  void add_card(Card card) { cards_.push_back(card); }
+  using Cards = FixedVector<Card, kMaxHoleCards>;
+
+  const Cards& cards() const { return cards_; }
+  // The hole cards as a card mask (see card_mask.h).
+  uint64_t card_mask() const { return card_mask_; }
+  void add_card(const Card& card) {
+    cards_.push_back(card);
+    card_mask_ |= CardToMask(card);
+  }
 
   const Hand& hand(int i) const { return hand_[i]; }
-  void set_hand(int i, Hand hand) { if (hand_.size() <= i) hand_.resize(i+1); hand_[i] = hand; }
+  Hand* mutable_hand(int i) { return &hand_[i]; }
+  void set_hand(int i, const Hand& hand) { hand_[i] = hand; }
 
   bool folded() const { return folded_; }
   void fold() { folded_ = true; }
 
-  void reset() { cards_.clear(); folded_ = false; }
+  // Chips behind, chips bet in the current round and chips put in the pot
+  // this hand (including the current round).
+  int stack() const { return stack_; }
+  int bet() const { return bet_; }
+  int total_bet() const { return total_bet_; }
+  // True while the player still has decisions to make this hand.
+  bool can_act() const { return !folded_ && stack_ > 0; }
+  bool all_in() const { return !folded_ && stack_ == 0; }
+
+  // Moves up to amount chips from the stack into the current bet and returns
+  // the number of chips moved.
+  int Bet(int amount) {
+    amount = std::min(amount, stack_);
+    stack_ -= amount;
+    bet_ += amount;
+    total_bet_ += amount;
+    return amount;
+  }
+  void clear_bet() { bet_ = 0; }
+
+  // Chips won from the pot this hand.
+  int winnings() const { return winnings_; }
+  void add_winnings(int chips) { winnings_ += chips; }
+
+  void reset(int stack) {
+    cards_.clear();
+    card_mask_ = 0;
+    folded_ = false;
+    stack_ = stack;
+    bet_ = 0;
+    total_bet_ = 0;
+    winnings_ = 0;
+  }
 
 private:
-  std::vector<Card> cards_;
-  std::vector<Hand> hand_;
+  Cards cards_;
+  uint64_t card_mask_{};
+  std::array<Hand, kMaxRounds> hand_;
   bool folded_{};
+  int stack_{};
+  int bet_{};
+  int total_bet_{};
+  int winnings_{};
 };
 
 class Table {
 public:
-  const std::vector<const Player*>& players() const { return players_; }
-  void set_players(std::vector<const Player*> players) { players_ = players; }
+  using Players = FixedVector<const Player*, kMaxPlayers>;
+  using CommunityCards = FixedVector<Card, kMaxCommunityCards>;
+  using ActionLog = FixedVector<ActionLogEntry, kMaxActions>;
+
+  const Players& players() const { return players_; }
+  void set_players(const std::vector<Player>& players) {
+    players_.clear();
+    for (const Player& player : players) {
+      players_.push_back(&player);
+    }
+  }
 
   int button() const { return button_; }
   void set_button(int button) { button_ = button; }
 
-  const std::vector<Card>& community_cards() const { return community_cards_; }
-  void add_community_card(Card card) { community_cards_.push_back(card); }
-  void clear_community_cards() { community_cards_.clear(); }
+  const CommunityCards& community_cards() const { return community_cards_; }
+  // The community cards as a card mask (see card_mask.h).
+  uint64_t community_card_mask() const { return community_card_mask_; }
+  void add_community_card(const Card& card) {
+    community_cards_.push_back(card);
+    community_card_mask_ |= CardToMask(card);
+  }
+  void clear_community_cards() {
+    community_cards_.clear();
+    community_card_mask_ = 0;
+  }
+
+  const Stakes& stakes() const { return stakes_; }
+  void set_stakes(const Stakes& stakes) { stakes_ = stakes; }
+
+  // Chips in the pot, including the current round's bets.
+  int pot() const { return pot_; }
+  void add_to_pot(int chips) { pot_ += chips; }
+  // Highest bet in the current round, and the minimum amount a raise must
+  // add to it.
+  int bet() const { return bet_; }
+  int min_raise() const { return min_raise_; }
+  void set_bet(int bet, int min_raise) {
+    bet_ = bet;
+    min_raise_ = min_raise;
+  }
+
+  // Every action of the current hand, in order.  The blinds aren't logged.
+  const ActionLog& action_log() const { return action_log_; }
+  void log_action(const ActionLogEntry& entry) {
+    action_log_.push_back(entry);
+  }
+
+  void clear_betting() {
+    pot_ = 0;
+    bet_ = 0;
+    min_raise_ = 0;
+    action_log_.clear();
+  }
 
 private:
-  std::vector<const Player*> players_;
+  Players players_;
   int button_;
-  std::vector<Card> community_cards_;
+  CommunityCards community_cards_;
+  uint64_t community_card_mask_{};
+  Stakes stakes_;
+  int pot_{};
+  int bet_{};
+  int min_raise_{};
+  ActionLog action_log_;
 };
 
-template <typename RNG>
+template <typename RNG, typename DECK = Deck>
 class Game {
 public:
   Game(Table& table, int player_count, RNG& rng)
@@ -105,9 +285,11 @@ public:
     table_.set_button(di(rng_));
   }
 
-  void ResetForNextHand() {
+  // Starts the next hand, which deals at most cards_per_hand cards.
+  void ResetForNextHand(int cards_per_hand = DECK::kDeckSize) {
     table_.clear_community_cards();
-    deck_.Shuffle(rng_);
+    table_.clear_betting();
+    deck_.Shuffle(rng_, cards_per_hand);
     table_.set_button(RotatePosition(table_.button(), -1));
   }
 
@@ -124,13 +306,13 @@ protected:
     return position;
   }
 
-  Deck& deck() { return deck_; }
+  DECK& deck() { return deck_; }
   Table& table() { return table_; }
 
   RNG& rng_;
   Table& table_;
   int player_count_;
-  Deck deck_;
+  DECK deck_;
 };
 
 } // namespace poker
@@ -0,0 +1,169 @@
+#include "poker_c.h"
+
+#include <array>
+#include <exception>
+#include <random>
+
+#include "card_mask.h"
+#include "equity.h"
+#include "holdem.h"
+#include "poker.h"
+
+namespace {
+
+using poker::kCardCount;
+
+// Adds card to *mask, or returns false if it isn't a card or is already in
+// it.
+bool AddCard(uint8_t card, uint64_t* mask) {
+  if (card >= kCardCount) {
+    return false;
+  }
+  uint64_t bit = poker::IndexToCardMask(card);
+  if (*mask & bit) {
+    return false;
+  }
+  *mask |= bit;
+  return true;
+}
+
+// Runs body, keeping exceptions from crossing into C callers.
+template <typename BODY>
+poker_status Guard(BODY body) {
+  try {
+    return body();
+  } catch (const std::exception&) {
+    return POKER_INTERNAL_ERROR;
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+int poker_api_version(void) { return POKER_API_VERSION; }
+
+poker_status poker_evaluate(const uint8_t* cards, size_t count,
+                            int cards_per_hand, int32_t* strength) {
+  if (cards_per_hand < 5 || cards_per_hand > 7) {
+    return POKER_INVALID_ARGUMENT;
+  }
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t* hand = cards + i * cards_per_hand;
+    uint64_t mask = 0;
+    for (int c = 0; c < cards_per_hand; c++) {
+      if (!AddCard(hand[c], &mask)) {
+        return POKER_INVALID_ARGUMENT;
+      }
+    }
+    strength[i] = poker::EvaluateCardMask(mask);
+  }
+  return POKER_OK;
+}
+
+int poker_hand_category(int32_t strength) {
+  // HandValueIndex() builds its table on first use, which may throw
+  try {
+    if (poker::HandValueIndex(strength) < 0) {
+      return 0;
+    }
+  } catch (const std::exception&) {
+    return 0;
+  }
+  return static_cast<int>(
+      poker::SortCodeHandType<poker::StandardRanking>(strength));
+}
+
+poker_status poker_hole_class(const uint8_t* hole, size_t count,
+                              uint8_t* hole_class) {
+  for (size_t i = 0; i < count; i++) {
+    uint64_t mask = 0;
+    if (!AddCard(hole[2 * i], &mask) || !AddCard(hole[2 * i + 1], &mask)) {
+      return POKER_INVALID_ARGUMENT;
+    }
+    hole_class[i] = static_cast<uint8_t>(
+        poker::holdem::HoleHandIndex(hole[2 * i], hole[2 * i + 1]));
+  }
+  return POKER_OK;
+}
+
+poker_status poker_hole_class_name(int hole_class, char* name) {
+  static constexpr char kRanks[] = "23456789TJQKA";
+  if (hole_class < 0 || hole_class >= POKER_HOLE_CLASS_COUNT) {
+    return POKER_INVALID_ARGUMENT;
+  }
+  // Each high rank (0 for the two) lists its pair, then a suited and an
+  // offsuit hand with each lower rank
+  int index = hole_class;
+  int high = poker::kRankCount - 1;
+  while (index > 2 * high) {
+    index -= 1 + 2 * high;
+    high--;
+  }
+  name[0] = kRanks[high];
+  if (index == 0) {
+    name[1] = kRanks[high];
+    name[2] = '\0';
+  } else {
+    name[1] = kRanks[high - 1 - (index - 1) / 2];
+    name[2] = (index - 1) % 2 == 0 ? 's' : 'o';
+    name[3] = '\0';
+  }
+  return POKER_OK;
+}
+
+poker_status poker_equity(const poker_equity_query* queries, size_t count,
+                          uint64_t max_runouts, uint64_t seed,
+                          poker_equity_result* results) {
+  if (max_runouts == 0) {
+    return POKER_INVALID_ARGUMENT;
+  }
+  return Guard([&] {
+    std::mt19937 rng(seed);
+    std::array<uint64_t, POKER_MAX_PLAYERS> hole;
+    for (size_t q = 0; q < count; q++) {
+      const poker_equity_query& query = queries[q];
+      if (query.players < 2 || query.players > POKER_MAX_PLAYERS ||
+          (query.board_count != 0 && query.board_count < 3) ||
+          query.board_count > 5 || query.dead_count > 8) {
+        return POKER_INVALID_ARGUMENT;
+      }
+      uint64_t known = 0;
+      for (int p = 0; p < query.players; p++) {
+        uint64_t before = known;
+        if (!AddCard(query.hole[p][0], &known) ||
+            !AddCard(query.hole[p][1], &known)) {
+          return POKER_INVALID_ARGUMENT;
+        }
+        hole[p] = known & ~before;
+      }
+      uint64_t board = 0;
+      for (int c = 0; c < query.board_count; c++) {
+        if (!AddCard(query.board[c], &known)) {
+          return POKER_INVALID_ARGUMENT;
+        }
+        board |= poker::IndexToCardMask(query.board[c]);
+      }
+      uint64_t dead = 0;
+      for (int c = 0; c < query.dead_count; c++) {
+        if (!AddCard(query.dead[c], &known)) {
+          return POKER_INVALID_ARGUMENT;
+        }
+        dead |= poker::IndexToCardMask(query.dead[c]);
+      }
+
+      poker::holdem::Equity equity = poker::holdem::ShowdownEquity(
+          hole.data(), query.players, board, dead, rng, max_runouts);
+      poker_equity_result& result = results[q];
+      for (int p = 0; p < POKER_MAX_PLAYERS; p++) {
+        result.share[p] = p < query.players ? equity.share[p] : 0;
+      }
+      result.runouts = equity.runouts;
+      result.exact = equity.exact;
+      result.reserved = 0;
+    }
+    return POKER_OK;
+  });
+}
+
+} // extern "C"
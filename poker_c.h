@@ -0,0 +1,114 @@
+#ifndef POKER_C_H
+#define POKER_C_H
+
+/*
+ * C interface to the hold'em hand evaluator and equity calculator, for
+ * services that embed them in process instead of running poker_simulation.
+ *
+ * The interface is stable: functions and structs are only ever added, and
+ * the layout of the structs below doesn't change (callers can check
+ * poker_api_version() against POKER_API_VERSION).  Every call works on
+ * caller-provided contiguous buffers, takes whole batches at a time, and
+ * never allocates or throws.
+ *
+ * Cards are card indices: (suit - 1) * 13 + rank - 2, with suits spades,
+ * clubs, hearts, diamonds (1 to 4) and ranks two to ace (2 to 14), so 0 is
+ * the two of spades and 51 the ace of diamonds.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define POKER_API __attribute__((visibility("default")))
+#else
+#define POKER_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define POKER_API_VERSION 1
+
+#define POKER_MAX_PLAYERS 10
+#define POKER_HOLE_CLASS_COUNT 169
+
+typedef enum poker_status {
+  POKER_OK = 0,
+  /* A card index out of range or dealt twice, or a count out of range */
+  POKER_INVALID_ARGUMENT = 1,
+  POKER_INTERNAL_ERROR = 2,
+} poker_status;
+
+/* Returns the POKER_API_VERSION the library was built with. */
+POKER_API int poker_api_version(void);
+
+/*
+ * Evaluates count hands of cards_per_hand (5 to 7) cards each, stored one
+ * after the other in cards, into strength[0..count).  Higher strengths are
+ * better hands and equal strengths tie.
+ */
+POKER_API poker_status poker_evaluate(const uint8_t* cards, size_t count,
+                                      int cards_per_hand, int32_t* strength);
+
+/*
+ * Returns the hand category of a strength from poker_evaluate(): 1 (high
+ * card) to 9 (straight flush), or 0 if it isn't a valid strength.
+ */
+POKER_API int poker_hand_category(int32_t strength);
+
+/*
+ * Looks up the class of count two card hole hands, stored one after the
+ * other in hole, into hole_class[0..count).  Classes are numbered from 0 to
+ * POKER_HOLE_CLASS_COUNT - 1 by high rank from the ace down, each high rank
+ * listing its pair and then the suited and offsuit hands with every lower
+ * rank: AA, AKs, AKo, AQs, ..., 22.
+ */
+POKER_API poker_status poker_hole_class(const uint8_t* hole, size_t count,
+                                        uint8_t* hole_class);
+
+/*
+ * Writes the name of hole_class, such as "AKs" or "TT", to name (at least 4
+ * bytes, NUL terminated).
+ */
+POKER_API poker_status poker_hole_class_name(int hole_class, char* name);
+
+/* Showdown equity of known hole cards on a partial board. */
+typedef struct poker_equity_query {
+  uint8_t players;     /* 2 to POKER_MAX_PLAYERS */
+  uint8_t board_count; /* 0, 3, 4 or 5 */
+  uint8_t dead_count;  /* Other known cards, 0 to 8 */
+  uint8_t reserved;
+  uint8_t hole[POKER_MAX_PLAYERS][2];
+  uint8_t board[5];
+  uint8_t dead[8];
+  uint8_t reserved2[3];
+} poker_equity_query;
+
+typedef struct poker_equity_result {
+  /* Each player's expected share of the pot, ties split evenly */
+  double share[POKER_MAX_PLAYERS];
+  /* Runouts enumerated or sampled */
+  uint64_t runouts;
+  /* 1 if every runout was enumerated */
+  int32_t exact;
+  int32_t reserved;
+} poker_equity_result;
+
+/*
+ * Computes the equity of queries[0..count) into results[0..count).  A query
+ * is enumerated exactly when it has at most max_runouts runouts, and
+ * max_runouts of them are sampled otherwise, from a generator seeded with
+ * seed.  Heads up, 100000 makes every query exact from the flop on.
+ */
+POKER_API poker_status poker_equity(const poker_equity_query* queries,
+                                    size_t count, uint64_t max_runouts,
+                                    uint64_t seed,
+                                    poker_equity_result* results);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* POKER_C_H */
@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <argparse/argparse.hpp>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "equity.h"
+#include "equity_service.h"
+#include "thread_pool.h"
+
+// Answers equity queries from local tools over a Unix domain socket, so they
+// share one process's warm caches instead of each starting from cold (see
+// equity_service.h for the line protocol).
+//
+// A single thread polls the clients.  Every request read in one wakeup is
+// answered from the cache if it can be; the rest are computed as one batch
+// on a work-stealing pool (the same query asked twice in a batch is computed
+// once), cached, and answered in the order each client asked.  Latency is
+// measured from the wakeup that read a request to its answer being queued.
+//
+// Usage: poker_equityd [--socket PATH] [-j THREADS] [--cache-size N]
+//                      [--max-runouts N]
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Longest request line accepted
+constexpr size_t kMaxLineBytes = 4096;
+
+struct Options {
+  std::string socket_path;
+  int threads{};
+  int cache_size{};
+  int max_runouts{};
+};
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void RequestStop(int) { stop_requested = 1; }
+
+struct Client {
+  int fd;
+  // Bytes read but not yet a whole line, and answers not yet sent
+  std::string in;
+  std::string out;
+  // Set while skipping the rest of a line longer than kMaxLineBytes
+  bool discarding{};
+  bool closed{};
+};
+
+// An answer to one request, in the order its client asked: text, or the
+// result of job once the batch has run.  Only equity answers are counted in
+// the latency percentiles.
+struct Reply {
+  Client* client;
+  std::string text;
+  int job = -1;
+  bool equity{};
+};
+
+// A cache miss computed by the batch
+struct Job {
+  poker::holdem::EquityQuery query;
+  std::string key;
+  poker::holdem::Equity equity;
+};
+
+class EquityServer {
+public:
+  explicit EquityServer(const Options& options)
+    : options_(options), cache_(options.cache_size), pool_(options.threads) {
+    for (int i = 0; i < options.threads; i++) {
+      rngs_.emplace_back(std::random_device()() + i);
+    }
+  }
+
+  // Listens on the socket until SIGINT or SIGTERM.  Returns false if the
+  // socket can't be set up.
+  bool Run();
+
+private:
+  bool Listen();
+  void Accept();
+  void Read(Client& client);
+  void Handle(Client& client, std::string_view line);
+  void RunBatch();
+  void Write(Client& client);
+  std::string StatsText() const;
+
+  Options options_;
+  int listener_ = -1;
+  std::vector<std::unique_ptr<Client>> clients_;
+  poker::holdem::EquityCache cache_;
+  // Computes the cache misses; its threads live as long as the server
+  poker::WorkStealingPool pool_;
+  // Generator of each pool worker, for sampled equities
+  std::vector<std::mt19937> rngs_;
+
+  // Requests read in the current wakeup
+  std::vector<Reply> replies_;
+  std::vector<Job> jobs_;
+  std::unordered_map<std::string, int> job_by_key_;
+
+  poker::holdem::LatencyHistogram latency_;
+  uint64_t hits_{};
+  uint64_t misses_{};
+  uint64_t batches_{};
+};
+
+bool EquityServer::Listen() {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (options_.socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Error: Socket path too long" << std::endl;
+    return false;
+  }
+  std::strcpy(address.sun_path, options_.socket_path.c_str());
+  listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  // A socket file nobody listens on is left over from an earlier run
+  if (connect(listener_, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) == 0) {
+    std::cerr << "Error: poker_equityd is already listening on "
+              << options_.socket_path << std::endl;
+    return false;
+  }
+  close(listener_);
+  unlink(options_.socket_path.c_str());
+  listener_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (bind(listener_, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listener_, SOMAXCONN) != 0) {
+    std::cerr << "Error: Can't listen on " << options_.socket_path << ": "
+              << std::strerror(errno) << std::endl;
+    return false;
+  }
+  fcntl(listener_, F_SETFL, O_NONBLOCK);
+  return true;
+}
+
+void EquityServer::Accept() {
+  int fd;
+  while ((fd = accept(listener_, nullptr, nullptr)) >= 0) {
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    clients_.push_back(std::make_unique<Client>(Client{fd}));
+  }
+}
+
+void EquityServer::Read(Client& client) {
+  char buffer[16384];
+  ssize_t bytes;
+  while ((bytes = read(client.fd, buffer, sizeof(buffer))) > 0) {
+    // Handles the whole lines of each read as it arrives, so client.in
+    // never holds more than one partial line
+    std::string_view data(buffer, bytes);
+    for (size_t end; (end = data.find('\n')) != std::string_view::npos;
+         data.remove_prefix(end + 1)) {
+      if (client.discarding) {
+        client.discarding = false;
+        continue;
+      }
+      if (client.in.size() + end > kMaxLineBytes) {
+        replies_.push_back({&client, "ERROR Request too long"});
+        client.in.clear();
+        continue;
+      }
+      client.in.append(data.data(), end);
+      std::string_view line = client.in;
+      if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+      }
+      Handle(client, line);
+      client.in.clear();
+    }
+    if (client.discarding) {
+      continue;
+    }
+    if (client.in.size() + data.size() > kMaxLineBytes) {
+      // Answered now; the rest of the line is dropped as it arrives
+      replies_.push_back({&client, "ERROR Request too long"});
+      client.in.clear();
+      client.discarding = true;
+    } else {
+      client.in.append(data);
+    }
+  }
+  if (bytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+    client.closed = true;
+  }
+}
+
+void EquityServer::Handle(Client& client, std::string_view line) {
+  constexpr std::string_view kEquity = "EQUITY ";
+  if (line == "STATS") {
+    replies_.push_back({&client, StatsText()});
+    return;
+  }
+  if (line.substr(0, kEquity.size()) != kEquity) {
+    replies_.push_back({&client, "ERROR Unknown request"});
+    return;
+  }
+  poker::holdem::EquityQuery query;
+  try {
+    query = poker::holdem::ParseEquityQuery(line.substr(kEquity.size()));
+  } catch (const std::exception& err) {
+    replies_.push_back({&client, std::string("ERROR ") + err.what()});
+    return;
+  }
+  std::string key = poker::holdem::EquityCacheKey(query);
+  if (const poker::holdem::Equity* equity = cache_.Find(key)) {
+    hits_++;
+    replies_.push_back(
+        {&client, poker::holdem::FormatEquity(*equity, query.players, true),
+         -1, true});
+    return;
+  }
+  misses_++;
+  auto [iter, inserted] = job_by_key_.emplace(key, jobs_.size());
+  if (inserted) {
+    jobs_.push_back({query, std::move(key)});
+  }
+  replies_.push_back({&client, "", iter->second, true});
+}
+
+void EquityServer::RunBatch() {
+  batches_++;
+  for (size_t j = 0; j < jobs_.size(); j++) {
+    pool_.Submit(j % pool_.size(), [this, j](int worker) {
+      Job& job = jobs_[j];
+      job.equity = poker::holdem::ShowdownEquity(
+          job.query.hole.data(), job.query.players, job.query.board,
+          job.query.dead, rngs_[worker], options_.max_runouts);
+    });
+  }
+  pool_.Run();
+  for (const Job& job : jobs_) {
+    cache_.Insert(job.key, job.equity);
+  }
+}
+
+void EquityServer::Write(Client& client) {
+  size_t sent = 0;
+  while (sent < client.out.size()) {
+    ssize_t bytes = send(client.fd, client.out.data() + sent,
+                         client.out.size() - sent, MSG_NOSIGNAL);
+    if (bytes < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        client.closed = true;
+      }
+      break;
+    }
+    sent += bytes;
+  }
+  client.out.erase(0, sent);
+}
+
+std::string EquityServer::StatsText() const {
+  std::string text = "OK requests=" + std::to_string(hits_ + misses_) +
+                     " hits=" + std::to_string(hits_) +
+                     " misses=" + std::to_string(misses_) +
+                     " batches=" + std::to_string(batches_) +
+                     " cached=" + std::to_string(cache_.size());
+  for (auto [name, quantile] : {std::pair{"p50", 0.5}, {"p90", 0.9},
+                                {"p99", 0.99}, {"p999", 0.999}}) {
+    text += std::string(" ") + name + "_us=" +
+            std::to_string(latency_.Percentile(quantile));
+  }
+  text += " max_us=" + std::to_string(latency_.max());
+  return text;
+}
+
+bool EquityServer::Run() {
+  if (!Listen()) {
+    return false;
+  }
+  std::cout << "Listening on " << options_.socket_path << " ("
+            << options_.threads << " threads, cache of "
+            << options_.cache_size << ")" << std::endl;
+
+  std::vector<pollfd> fds;
+  while (!stop_requested) {
+    fds.clear();
+    fds.push_back({listener_, POLLIN, 0});
+    for (const auto& client : clients_) {
+      fds.push_back({client->fd,
+                     static_cast<short>(client->out.empty()
+                                            ? POLLIN
+                                            : POLLIN | POLLOUT),
+                     0});
+    }
+    if (poll(fds.data(), fds.size(), -1) < 0) {
+      continue;  // EINTR, e.g. to stop
+    }
+    Clock::time_point wakeup = Clock::now();
+    size_t polled = clients_.size();
+    if (fds[0].revents & POLLIN) {
+      Accept();
+    }
+
+    for (size_t i = 0; i < polled; i++) {
+      if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+        Read(*clients_[i]);
+      }
+    }
+    if (!jobs_.empty()) {
+      RunBatch();
+    }
+    uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                          Clock::now() - wakeup)
+                          .count();
+    for (Reply& reply : replies_) {
+      if (reply.job >= 0) {
+        const Job& job = jobs_[reply.job];
+        reply.text = poker::holdem::FormatEquity(job.equity, job.query.players,
+                                                 false);
+      }
+      if (reply.equity) {
+        latency_.Record(micros);
+      }
+      reply.client->out += reply.text;
+      reply.client->out += '\n';
+    }
+    replies_.clear();
+    jobs_.clear();
+    job_by_key_.clear();
+
+    for (const auto& client : clients_) {
+      if (!client->out.empty()) {
+        Write(*client);
+      }
+    }
+    // Clients that hung up are dropped once their answers are sent (or
+    // can't be)
+    clients_.erase(
+        std::remove_if(clients_.begin(), clients_.end(),
+                       [](const std::unique_ptr<Client>& client) {
+                         if (client->closed) {
+                           close(client->fd);
+                         }
+                         return client->closed;
+                       }),
+        clients_.end());
+  }
+
+  std::cout << StatsText() << std::endl;
+  for (const auto& client : clients_) {
+    close(client->fd);
+  }
+  close(listener_);
+  unlink(options_.socket_path.c_str());
+  return true;
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+  Options options;
+  argparse::ArgumentParser program("poker_equityd");
+  program.add_argument("--socket")
+    .help("Unix domain socket to listen on")
+    .default_value(std::string("/tmp/poker_equityd.sock"))
+    .store_into(options.socket_path);
+  program.add_argument("-j", "--threads")
+    .help("Worker threads computing cache misses")
+    .default_value(static_cast<int>(
+        std::max(1u, std::thread::hardware_concurrency())))
+    .store_into(options.threads);
+  program.add_argument("--cache-size")
+    .help("Equities kept in the least recently used cache")
+    .default_value(1'000'000)
+    .store_into(options.cache_size);
+  program.add_argument("--max-runouts")
+    .help("Runouts enumerated, or sampled when there are more")
+    .default_value(static_cast<int>(poker::holdem::kDefaultMaxRunouts))
+    .store_into(options.max_runouts);
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& err) {
+    std::cerr << err.what() << std::endl;
+    std::cerr << program;
+    exit(1);
+  }
+  if (options.threads < 1 || options.cache_size < 0 ||
+      options.max_runouts < 1) {
+    std::cerr << "Error: --threads and --max-runouts must be positive and "
+                 "--cache-size not negative" << std::endl;
+    exit(1);
+  }
+  return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  Options options = ParseOptions(argc, argv);
+
+  // Without SA_RESTART, so the signal interrupts poll()
+  struct sigaction action {};
+  action.sa_handler = RequestStop;
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+
+  EquityServer server(options);
+  return server.Run() ? 0 : 1;
+}
@@ -1,45 +1,485 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
+#include <string_view>
 #include <utility>
 #include <vector>
 
 #include "cards.h"
+#include "hand_history.h"
+#include "hand_import.h"
 #include "holdem.h"
+#include "holdem_batch.h"
 #include "holdem_stats.h"
+#include "mapped_file.h"
+#include "omaha.h"
+#include "perf_counters.h"
 #include "player_model_holdem.h"
 #include "poker.pb.h"
 #include "poker_simulation_args.h"
 #include "poker_simulation_utils.h"
+#include "short_deck.h"
+#include "thread_pool.h"
 
 namespace {
 
-poker::holdem::PlayerModelVector CreatePlayerModels(
-    const PokerSimulationArgs& args) {
-  poker::holdem::PlayerModelVector player_models(args.players);
-  for (int i = 0; i < args.players; i++) {
-    player_models[i] =
-        poker::holdem::PlayerModelFactory::Create(args.player_model);
+// In --duration mode the clock is only consulted once per this many hands.
+constexpr int kHandsPerClockCheck = 1024;
+
+// Tables played in lockstep by --batch. Wider batches measured no faster
+// (holdem_benchmark's BatchGame<K> rows): EvaluateCardMask has no table
+// lookups whose latency interleaving tables could hide, and --batch's gain
+// over Game comes from skipping chip accounting.
+constexpr int kBatchTables = 1;
+
+// Every seat plays args.player_model, so games are instantiated with the
+// model's concrete type (see PlayerModelRegistry) rather than dispatching
+// through a PlayerModel per seat, and with the game type's rules policy
+// (see HoldemRules).
+template <typename MODEL>
+using Models = poker::holdem::SamePlayerModel<MODEL>;
+template <typename RULES>
+using Statistics = poker::holdem::BasicStatistics<RULES>;
+template <typename MODEL, typename RULES>
+using SimulatedGame =
+    poker::holdem::Game<std::mt19937, Statistics<RULES>, Models<MODEL>, RULES>;
+
+poker::Stakes StakesFromArgs(const PokerSimulationArgs& args) {
+  poker::Stakes stakes;
+  stakes.small_blind = args.small_blind;
+  stakes.big_blind = args.big_blind;
+  stakes.stack = args.stack;
+  return stakes;
+}
+
+// Plays hands until args.iterations hands or the --duration budget are used
+// up.  Each call to game.Play() plays hands_per_play hands.
+template <typename GAME>
+void RunHands(const PokerSimulationArgs& args, GAME& game, int hands_per_play) {
+  if (args.duration > 0) {
+    // Run until the budget minus the output margin is spent (or the optional
+    // iteration cap is reached).  Progress is reported against the budget.
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(args.duration - args.duration_margin));
+    int budget_ms = static_cast<int>(
+        (args.duration - args.duration_margin) * 1000);
+    uint64_t hands = 0;
+    uint64_t max_hands = args.iterations > 0 ? args.iterations : UINT64_MAX;
+    ProgressBar progress_bar(budget_ms, 50);
+    while (hands < max_hands) {
+      for (int i = 0; i < kHandsPerClockCheck && hands < max_hands;
+           i += hands_per_play) {
+        game.Play();
+        hands += hands_per_play;
+      }
+      auto now = Clock::now();
+      if (now >= deadline) {
+        break;
+      }
+      progress_bar.Update(static_cast<int>(
+          std::chrono::duration_cast<std::chrono::milliseconds>(now - start)
+              .count()));
+    }
+    progress_bar.Update(budget_ms);
+    std::cout << "Hands simulated: " << hands << std::endl;
+  } else {
+    ProgressBar progress_bar(args.iterations, 50);
+    for (int i = 0; i < args.iterations; i += hands_per_play) {
+      progress_bar.Update(i);
+      game.Play();
+    }
+    progress_bar.Update(args.iterations);
   }
-  return player_models;
 }
 
-}  // namespace
+// Hands simulated per task in sweep mode.
+constexpr int kSweepChunkHands = 4096;
 
-int main(int argc, char* argv[]) {
-  PokerSimulationArgs args = ParseArgs(argc, argv);
-  args.Display();
+// Simulation state owned by one sweep worker for one player count.
+template <typename MODEL, typename RULES>
+struct SweepTable {
+  SweepTable(PokerSimulationArgs& args, std::seed_seq& seed)
+      : players(args.players),
+        stats(args),
+        rng(seed),
+        game(table, players, Models<MODEL>(), stats, rng) {
+    table.set_stakes(StakesFromArgs(args));
+  }
+
+  poker::Table table;
+  std::vector<poker::Player> players;
+  Statistics<RULES> stats;
+  std::mt19937 rng;
+  SimulatedGame<MODEL, RULES> game;
+};
+
+// Simulates every player count in [args.players, args.players_sweep_max] on
+// one work-stealing pool.  Each player count is a chain of chunk tasks; every
+// worker starts one chain per player count, so when the cheaper (fewer player)
+// configurations run out of hands their workers steal chunks of the remaining
+// ones.  Workers keep a statistics shard per player count, merged at the end.
+template <typename MODEL, typename RULES>
+void RunSweep(const PokerSimulationArgs& args) {
+  std::vector<PokerSimulationArgs> config_args;
+  for (int p = args.players_sweep_max; p >= args.players; p--) {
+    PokerSimulationArgs config = args;
+    config.players = p;
+    config.players_sweep_max = 0;
+    config_args.push_back(config);
+  }
+  const int config_count = static_cast<int>(config_args.size());
+
+  poker::WorkStealingPool pool(args.threads);
+  std::vector<std::vector<std::unique_ptr<SweepTable<MODEL, RULES>>>> shards(pool.size());
+  for (auto& worker_shards : shards) {
+    worker_shards.resize(config_count);
+  }
+
+  // Hands left to claim per configuration (unbounded in --duration mode
+  // without an explicit iteration cap).
+  std::vector<std::atomic<int64_t>> remaining(config_count);
+  for (std::atomic<int64_t>& r : remaining) {
+    r = args.iterations > 0 ? args.iterations : INT64_MAX;
+  }
+  std::atomic<int64_t> hands{};
+
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(args.duration - args.duration_margin));
+  int progress_total = args.duration > 0
+      ? static_cast<int>((args.duration - args.duration_margin) * 1000)
+      : static_cast<int>(std::min<int64_t>(
+            static_cast<int64_t>(args.iterations) * config_count, INT32_MAX));
+  ProgressBar progress_bar(progress_total, 50);
+
+  std::function<void(int, int)> run_chunk = [&](int worker, int config) {
+    if (args.duration > 0 && Clock::now() >= deadline) {
+      return;
+    }
+    int64_t claimed = std::min<int64_t>(
+        kSweepChunkHands, remaining[config].fetch_sub(kSweepChunkHands));
+    if (claimed <= 0) {
+      return;
+    }
+    std::unique_ptr<SweepTable<MODEL, RULES>>& table = shards[worker][config];
+    if (!table) {
+      std::seed_seq seed{static_cast<int>(std::time(0)), worker,
+                         config_args[config].players};
+      table = std::make_unique<SweepTable<MODEL, RULES>>(config_args[config], seed);
+    }
+    for (int64_t i = 0; i < claimed; i++) {
+      table->game.Play();
+    }
+    int64_t total = hands += claimed;
+    if (worker == 0) {
+      progress_bar.Update(args.duration > 0
+          ? static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    Clock::now() - start).count())
+          : static_cast<int>(std::min<int64_t>(total, INT32_MAX)));
+    }
+    pool.Submit(worker, [&run_chunk, config](int w) { run_chunk(w, config); });
+  };
+
+  for (int w = 0; w < pool.size(); w++) {
+    for (int c = 0; c < config_count; c++) {
+      pool.Submit(w, [&run_chunk, c](int worker) { run_chunk(worker, c); });
+    }
+  }
+  pool.Run();
+  progress_bar.Update(progress_total);
+  std::cout << "Hands simulated: " << hands << std::endl;
 
+  // Merge shards into one Statistics per player count, in ascending player
+  // count order, and write all of them in one pass.
+  std::vector<std::unique_ptr<Statistics<RULES>>> results;
+  std::vector<const Statistics<RULES>*> winning_hand_stats;
+  for (int c = config_count - 1; c >= 0; c--) {
+    auto stats = std::make_unique<Statistics<RULES>>(config_args[c]);
+    for (auto& worker_shards : shards) {
+      if (worker_shards[c]) {
+        stats->Merge(worker_shards[c]->stats);
+        worker_shards[c].reset();
+      }
+    }
+    if (args.stats_hole_cards) {
+      stats->DisplayHoleCards();
+    }
+    if (args.stats_hand_attributes) {
+      stats->DisplayHandAttributes();
+    }
+    if (args.stats_equity) {
+      stats->DisplayEquity();
+    }
+    if (args.stats_export) {
+      stats->DisplayStatsFile();
+    }
+    winning_hand_stats.push_back(stats.get());
+    results.push_back(std::move(stats));
+  }
+  if (args.stats_winning_hand) {
+    Statistics<RULES>::DisplayWinningHand(winning_hand_stats, args);
+  }
+}
+
+// Simulates args.players at a single table on the calling thread, recording
+// the hands to args.history_file if set.
+template <typename MODEL, typename RULES>
+void RunTable(PokerSimulationArgs& args) {
   poker::Table table;
+  table.set_stakes(StakesFromArgs(args));
   std::vector<poker::Player> players(args.players);
-  poker::holdem::PlayerModelVector player_models = CreatePlayerModels(args);
-  poker::holdem::Statistics stats(args);
+  Statistics<RULES> stats(args);
   std::mt19937 rng(static_cast<unsigned int>(std::time(0)));
-  poker::holdem::Game<std::mt19937, poker::holdem::Statistics> game(
-      table, players, std::move(player_models), stats, rng);
+
+  std::unique_ptr<poker::PerfCounters> perf_counters;
+  std::unique_ptr<poker::PerfProfile> perf_profile;
+  if (args.perf_counters) {
+    perf_counters = std::make_unique<poker::PerfCounters>();
+    if (!perf_counters->error().empty()) {
+      std::cerr << "Warning: performance counters unavailable: "
+                << perf_counters->error() << std::endl;
+    }
+    if (!perf_counters->enabled()) {
+      perf_counters.reset();
+    } else if (args.perf_counters_phases && !args.batch) {
+      perf_profile = std::make_unique<poker::PerfProfile>(
+          *perf_counters, poker::holdem::PhaseNames());
+    }
+  }
+
+  std::unique_ptr<poker::holdem::HandHistoryWriter> history;
+  if (!args.history_file.empty()) {
+    try {
+      history = std::make_unique<poker::holdem::HandHistoryWriter>(
+          args.history_file,
+          poker::holdem::MakeHandHistoryHeader<RULES>(
+              args.players, table.stakes(), args.compress_history));
+    } catch (const std::exception& err) {
+      std::cerr << "Error: " << err.what() << std::endl;
+      exit(1);
+    }
+  }
+
+  poker::PerfSample perf_begin;
+  poker::PerfSample perf_end;
+  if (perf_counters) {
+    perf_counters->Read(&perf_begin);
+  }
+
+  if (args.batch) {
+    poker::holdem::BatchGame<std::mt19937, Statistics<RULES>,
+                             kBatchTables, MODEL> batch_game(args.players,
+                                                             stats, rng);
+    RunHands(args, batch_game, kBatchTables);
+  } else if (history) {
+    using Recorder = poker::holdem::HandHistoryRecorder<Statistics<RULES>>;
+    Recorder recorder(stats, *history);
+    poker::holdem::Game<std::mt19937, Recorder, Models<MODEL>, RULES> game(
+        table, players, Models<MODEL>(), recorder, rng);
+    game.set_perf_profile(perf_profile.get());
+    RunHands(args, game, 1);
+    history->Flush();
+  } else {
+    SimulatedGame<MODEL, RULES> game(table, players, Models<MODEL>(), stats,
+                                     rng);
+    game.set_perf_profile(perf_profile.get());
+    RunHands(args, game, 1);
+  }
+
+  if (perf_counters) {
+    perf_counters->Read(&perf_end);
+  }
+
+  if (history) {
+    std::cout << "Hands recorded: " << history->hands() << std::endl;
+  }
+  stats.Display();
+
+  if (perf_counters) {
+    poker::DisplayPerfSample(std::cout, *perf_counters, perf_begin, perf_end,
+                             stats.games());
+    if (perf_profile) {
+      perf_profile->Display(std::cout, stats.games());
+    }
+  }
+}
+
+// Computes the statistics of the hands recorded in args.replay_file, which
+// must have been played in the game RULES, instead of simulating.
+template <typename RULES>
+void RunReplay(PokerSimulationArgs& args) {
+  std::unique_ptr<poker::holdem::HandHistoryReader> reader;
+  try {
+    reader = std::make_unique<poker::holdem::HandHistoryReader>(
+        args.replay_file);
+  } catch (const std::exception& err) {
+    std::cerr << "Error: " << err.what() << std::endl;
+    exit(1);
+  }
+  const poker::holdem::HandHistoryHeader& header = reader->header();
+  if (header.hole_cards != RULES::kHoleCards ||
+      header.low_rank != RULES::Ranking::kLowRank) {
+    std::cerr << "Error: " << args.replay_file
+              << " was recorded in a different game" << std::endl;
+    exit(1);
+  }
+  // The statistics are of the recorded table
+  args.players = header.players;
+  args.small_blind = header.small_blind;
+  args.big_blind = header.big_blind;
+  args.stack = header.stack;
+  std::cout << "Replaying " << args.players << " player hands" << std::endl;
+
+  Statistics<RULES> stats(args);
+  auto start = std::chrono::steady_clock::now();
+  uint64_t hands = 0;
+  try {
+    hands = poker::holdem::ReplayHandHistory(*reader, stats);
+  } catch (const std::exception& err) {
+    std::cerr << "Error: " << err.what() << std::endl;
+    exit(1);
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "Hands replayed: " << hands << " ("
+            << static_cast<uint64_t>(hands / elapsed.count()) << " hands/s)"
+            << std::endl;
+  stats.Display();
+}
+
+// Bytes of hand history text parsed per task by --import.
+constexpr size_t kImportChunkBytes = 16 << 20;
+
+// Computes the statistics of the ACPC hands in args.import_files.  The files
+// are mapped and split into chunks at line boundaries, and the chunks are
+// parsed on a work-stealing pool into a statistics shard per worker, merged
+// at the end as in RunSweep().
+void RunImport(PokerSimulationArgs& args) {
+  using Rules = poker::holdem::HoldemRules;
+  std::vector<std::unique_ptr<poker::MappedFile>> files;
+  std::vector<std::string_view> chunks;
+  uint64_t bytes = 0;
+  try {
+    for (const std::string& path : args.import_files) {
+      files.push_back(std::make_unique<poker::MappedFile>(path));
+      std::string_view text(files.back()->data(), files.back()->size());
+      for (std::string_view chunk :
+           poker::holdem::SplitAtLines(text, kImportChunkBytes)) {
+        chunks.push_back(chunk);
+      }
+      bytes += text.size();
+    }
+  } catch (const std::exception& err) {
+    std::cerr << "Error: " << err.what() << std::endl;
+    exit(1);
+  }
+  args.players = 0;
+  for (size_t i = 0; i < files.size() && args.players == 0; i++) {
+    args.players = poker::holdem::AcpcPlayerCount(
+        std::string_view(files[i]->data(), files[i]->size()));
+  }
+  if (args.players == 0) {
+    std::cerr << "Error: No hands to import" << std::endl;
+    exit(1);
+  }
+  std::cout << "Importing " << args.players << " player hands" << std::endl;
+
+  const poker::Stakes stakes = StakesFromArgs(args);
+  const poker::holdem::HandHistoryHeader header =
+      poker::holdem::MakeHandHistoryHeader<Rules>(args.players, stakes,
+                                                  false);
+  struct ImportShard {
+    ImportShard(PokerSimulationArgs& args,
+                const poker::holdem::HandHistoryHeader& header,
+                const poker::Stakes& stakes)
+        : stats(args), replay(header), parser(args.players, stakes) {}
+
+    Statistics<Rules> stats;
+    poker::holdem::HandReplay replay;
+    poker::holdem::AcpcHandParser parser;
+    uint64_t hands{};
+  };
+
+  poker::WorkStealingPool pool(args.threads);
+  std::vector<std::unique_ptr<ImportShard>> shards(pool.size());
+  std::atomic<int> chunks_done{};
+  std::mutex error_mutex;
+  std::string error;
+  ProgressBar progress_bar(static_cast<int>(chunks.size()), 50);
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < chunks.size(); i++) {
+    pool.Submit(i % pool.size(), [&, i](int worker) {
+      std::unique_ptr<ImportShard>& shard = shards[worker];
+      if (!shard) {
+        shard = std::make_unique<ImportShard>(args, header, stakes);
+      }
+      try {
+        shard->hands += poker::holdem::ImportAcpcHands(
+            chunks[i], shard->parser, shard->replay, shard->stats);
+      } catch (const std::exception& err) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (error.empty()) {
+          error = err.what();
+        }
+      }
+      int done = ++chunks_done;
+      if (worker == 0) {
+        progress_bar.Update(done);
+      }
+    });
+  }
+  pool.Run();
+  progress_bar.Update(static_cast<int>(chunks.size()));
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  if (!error.empty()) {
+    std::cerr << "Error: " << error << std::endl;
+    exit(1);
+  }
+
+  Statistics<Rules> stats(args);
+  uint64_t hands = 0;
+  for (std::unique_ptr<ImportShard>& shard : shards) {
+    if (shard) {
+      stats.Merge(shard->stats);
+      hands += shard->hands;
+    }
+  }
+  std::cout << "Hands imported: " << hands << " ("
+            << static_cast<uint64_t>(bytes / elapsed.count() / 1e6)
+            << " MB/s, " << static_cast<uint64_t>(hands / elapsed.count())
+            << " hands/s)" << std::endl;
+  stats.Display();
+}
+
+template <typename MODEL, typename RULES>
+void Run(PokerSimulationArgs& args) {
+  if (args.sweep()) {
+    RunSweep<MODEL, RULES>(args);
+  } else {
+    RunTable<MODEL, RULES>(args);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  PokerSimulationArgs args = ParseArgs(argc, argv);
+  args.Display();
 
   if (!std::filesystem::is_directory(args.output_dir)) {
     std::cerr << "Error: Invalid output directory '" << args.output_dir << "'"
@@ -47,14 +487,59 @@ int main(int argc, char* argv[]) {
     exit(1);
   }
 
-  ProgressBar progress_bar(args.iterations, 50);
-  for (int i = 0; i < args.iterations; i++) {
-    progress_bar.Update(i);
-    game.Play();
+  if (args.sweep() && args.perf_counters) {
+    std::cerr << "Warning: --perf-counters is not supported with a player "
+                 "count range" << std::endl;
   }
-  progress_bar.Update(args.iterations);
 
-  stats.Display();
+  if (!args.import_files.empty()) {
+    RunImport(args);
+    return 0;
+  }
+  if (!args.replay_file.empty()) {
+    switch (args.game_type) {
+    case PokerGameType::OMAHA:
+      RunReplay<poker::omaha::Rules>(args);
+      break;
+    case PokerGameType::SHORT_DECK:
+      RunReplay<poker::short_deck::Rules>(args);
+      break;
+    default:
+      RunReplay<poker::holdem::HoldemRules>(args);
+      break;
+    }
+    return 0;
+  }
+
+  // The other player models play from hold'em's two-card starting hand
+  // charts
+  if (args.game_type == PokerGameType::OMAHA &&
+      args.player_model != poker::holdem::PlayerModelShowdown::name()) {
+    std::cerr << "Error: Omaha only supports the showdown player model"
+              << std::endl;
+    exit(1);
+  }
+
+  bool found = poker::holdem::PlayerModelTypes::Visit(
+      args.player_model, [&args](auto tag) {
+        using Model = typename decltype(tag)::type;
+        switch (args.game_type) {
+        case PokerGameType::OMAHA:
+          Run<Model, poker::omaha::Rules>(args);
+          break;
+        case PokerGameType::SHORT_DECK:
+          Run<Model, poker::short_deck::Rules>(args);
+          break;
+        default:
+          Run<Model, poker::holdem::HoldemRules>(args);
+          break;
+        }
+      });
+  if (!found) {
+    std::cerr << "Error: Unrecognized player model '" << args.player_model
+              << "'" << std::endl;
+    exit(1);
+  }
 
   return 0;
 }
@@ -1,24 +1,51 @@
 #include "poker_simulation_args.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 
 #include <argparse/argparse.hpp>
 
+#include "hand_import.h"
+#include "poker.h"
+
 void PokerSimulationArgs::Display() const {
   std::cout << "Game type: ";
   if (game_type == PokerGameType::HOLDEM) {
     std::cout << "holdem\n";
+  } else if (game_type == PokerGameType::OMAHA) {
+    std::cout << "omaha\n";
+  } else if (game_type == PokerGameType::SHORT_DECK) {
+    std::cout << "short_deck\n";
   } else {
     std::cout << "?\n";
   }
-  std::cout << "Players: " << players << std::endl;
-  std::cout << "Iterations: " << iterations << std::endl;
+  if (sweep()) {
+    std::cout << "Players: " << players << "-" << players_sweep_max
+              << std::endl;
+    std::cout << "Threads: " << threads << std::endl;
+  } else {
+    std::cout << "Players: " << players << std::endl;
+  }
+  if (duration > 0) {
+    std::cout << "Duration: " << duration << "s (output margin "
+              << duration_margin << "s)" << std::endl;
+    if (iterations > 0) {
+      std::cout << "Iterations (max): " << iterations << std::endl;
+    }
+  } else {
+    std::cout << "Iterations: " << iterations << std::endl;
+  }
   if (output_dir.empty()) {
     std::cout << "Output directory: ." << std::endl;
   } else {
     std::cout << "Output directory: " << output_dir << std::endl;
   }
+  std::cout << "Blinds: " << small_blind << "/" << big_blind
+            << ", stack: " << stack << std::endl;
   std::cout << "Player model: " << player_model << std::endl;
   std::cout << "Statistics:";
   bool stats_output = false;
@@ -34,9 +61,108 @@ void PokerSimulationArgs::Display() const {
     std::cout << " hole-cards";
     stats_output = true;
   }
+  if (stats_hand_attributes) {
+    if (stats_output)
+      std::cout << ",";
+    std::cout << " hand-attributes";
+    stats_output = true;
+  }
+  if (stats_equity) {
+    if (stats_output)
+      std::cout << ",";
+    std::cout << " equity";
+    stats_output = true;
+  }
+  if (stats_export) {
+    if (stats_output)
+      std::cout << ",";
+    std::cout << " export";
+    stats_output = true;
+  }
   std::cout << std::endl;
+  if (batch) {
+    std::cout << "Engine: batch" << std::endl;
+  }
+  if (!history_file.empty()) {
+    std::cout << "Hand history: " << history_file
+              << (compress_history ? " (compressed)" : "") << std::endl;
+  }
+  if (!replay_file.empty()) {
+    std::cout << "Replay: " << replay_file << std::endl;
+  }
+  if (!import_files.empty()) {
+    std::cout << "Import:";
+    for (const std::string& file : import_files) {
+      std::cout << " " << file;
+    }
+    std::cout << std::endl << "Threads: " << threads << std::endl;
+  }
+  if (perf_counters_phases) {
+    std::cout << "Performance counters: main loop, phases" << std::endl;
+  } else if (perf_counters) {
+    std::cout << "Performance counters: main loop" << std::endl;
+  }
 }
 
+namespace {
+
+// Parses a duration such as "90", "90s", "15m" or "2h" into seconds.
+double ParseDuration(const std::string& str) {
+  size_t pos = 0;
+  double value = std::stod(str, &pos);
+  std::string suffix = str.substr(pos);
+  if (suffix.empty() || suffix == "s") {
+    return value;
+  } else if (suffix == "m") {
+    return value * 60;
+  } else if (suffix == "h") {
+    return value * 3600;
+  }
+  throw std::invalid_argument("Invalid duration suffix: " + suffix);
+}
+
+// Parses a player count ("6") or an inclusive range of counts ("2-10").
+void ParsePlayers(const std::string& str, PokerSimulationArgs& args) {
+  size_t pos = 0;
+  args.players = std::stoi(str, &pos);
+  args.players_sweep_max = 0;
+  if (pos < str.size()) {
+    if (str[pos] != '-') {
+      throw std::invalid_argument("Expected N or MIN-MAX");
+    }
+    std::string max_str = str.substr(pos + 1);
+    args.players_sweep_max = std::stoi(max_str, &pos);
+    if (pos != max_str.size() || args.players_sweep_max < args.players) {
+      throw std::invalid_argument("Expected N or MIN-MAX");
+    }
+  }
+  int max_players = std::max(args.players, args.players_sweep_max);
+  if (args.players < 2 || max_players > 10) {
+    throw std::invalid_argument("Player count must be between 2 and 10");
+  }
+}
+
+// Parses blinds given as "SMALL/BIG" (e.g. "1/2").
+void ParseBlinds(const std::string& str, PokerSimulationArgs& args) {
+  size_t pos = 0;
+  args.small_blind = std::stoi(str, &pos);
+  if (pos >= str.size() || str[pos] != '/') {
+    throw std::invalid_argument("Expected SMALL/BIG");
+  }
+  std::string big_str = str.substr(pos + 1);
+  args.big_blind = std::stoi(big_str, &pos);
+  if (pos != big_str.size()) {
+    throw std::invalid_argument("Expected SMALL/BIG");
+  }
+  if (args.small_blind < 0 || args.big_blind <= 0 ||
+      args.small_blind > args.big_blind) {
+    throw std::invalid_argument(
+        "Blinds must satisfy 0 <= small blind <= big blind, big blind > 0");
+  }
+}
+
+} // namespace
+
 PokerSimulationArgs ParseArgs(int argc, char *argv[]) {
   PokerSimulationArgs args;
   argparse::ArgumentParser program("poker_simulation");
@@ -44,20 +170,47 @@ PokerSimulationArgs ParseArgs(int argc, char *argv[]) {
   // Positional args
   std::string game_type_str;
   program.add_argument("game-type")
-    .help("Game to simulate (values: holdem)")
+    .help("Game to simulate (values: holdem, omaha, short_deck)")
     .store_into(game_type_str);
 
   // Optional args
+  std::string players_str;
   program.add_argument("-p", "--players")
-    .help("Number of players")
-    .default_value(10)
-    .store_into(args.players)
+    .help("Number of players, or a range (e.g. 2-10) to simulate every "
+          "player count in one run")
+    .default_value(std::string("10"))
+    .store_into(players_str);
+  program.add_argument("-j", "--threads")
+    .help("Worker threads for a player count range (default: all cores)")
+    .default_value(0)
+    .store_into(args.threads)
     .scan<'i', int>();
   program.add_argument("-i", "--iterations")
     .help("Number of iterations")
     .default_value(100'000'000)
     .store_into(args.iterations)
     .scan<'i', int>();
+  std::string duration_str;
+  program.add_argument("-t", "--duration")
+    .help("Run until this wall-clock budget is nearly spent (e.g. 90s, 15m, "
+          "2h) instead of for a fixed number of iterations")
+    .store_into(duration_str);
+  std::string duration_margin_str;
+  program.add_argument("--duration-margin")
+    .help("Part of the --duration budget reserved for writing output "
+          "(default: 5%)")
+    .store_into(duration_margin_str);
+  std::string blinds_str;
+  program.add_argument("--blinds")
+    .help("Small and big blind in chips")
+    .default_value(std::string("1/2"))
+    .store_into(blinds_str);
+  program.add_argument("--stack")
+    .help("Starting stack of every player in chips, at most " +
+          std::to_string(poker::kMaxStackBigBlinds) + " big blinds")
+    .default_value(200)
+    .store_into(args.stack)
+    .scan<'i', int>();
   program.add_argument("-d", "--output-dir")
     .help("Output directory name")
     .default_value(std::string("."))
@@ -81,6 +234,58 @@ PokerSimulationArgs ParseArgs(int argc, char *argv[]) {
     .default_value(false)
     .store_into(args.stats_hole_cards)
     .implicit_value(true);
+  program.add_argument("--stats:hand-attributes")
+    .help("Compute win rates by flop and turn hand attribute (draws, gap "
+          "connectors)")
+    .default_value(false)
+    .store_into(args.stats_hand_attributes)
+    .implicit_value(true);
+  program.add_argument("--stats:equity")
+    .help("Compute each hole hand's flop and turn equity, enumerated exactly "
+          "over the rest of the board (hold'em only)")
+    .default_value(false)
+    .store_into(args.stats_equity)
+    .implicit_value(true);
+  program.add_argument("--stats:export")
+    .help("Also write the collected counters to a binary columnar file "
+          "(statistics-NN-players.pkst)")
+    .default_value(false)
+    .store_into(args.stats_export)
+    .implicit_value(true);
+
+  program.add_argument("--batch")
+    .help("Play a batch of tables in lockstep (no betting, only folds)")
+    .default_value(false)
+    .store_into(args.batch)
+    .implicit_value(true);
+  program.add_argument("--perf-counters")
+    .help("Report hardware performance counters per hand (Linux only)")
+    .default_value(false)
+    .store_into(args.perf_counters)
+    .implicit_value(true);
+  program.add_argument("--perf-counters-phases")
+    .help("Also break performance counters down by game phase (adds overhead)")
+    .default_value(false)
+    .store_into(args.perf_counters_phases)
+    .implicit_value(true);
+  program.add_argument("--history")
+    .help("Record every hand to this file as a binary hand history")
+    .store_into(args.history_file);
+  program.add_argument("--history-compress")
+    .help("Compress the --history file in blocks with zlib")
+    .default_value(false)
+    .store_into(args.compress_history)
+    .implicit_value(true);
+  std::string import_str;
+  program.add_argument("--import")
+    .help("Compute the statistics of the hands in these comma-separated "
+          "ACPC format hand history files instead of simulating (stakes "
+          "default to the ACPC logs' 50/100 blinds and 20000 stacks)")
+    .store_into(import_str);
+  program.add_argument("--replay")
+    .help("Compute the statistics of the hands recorded in this hand history "
+          "instead of simulating")
+    .store_into(args.replay_file);
 
   try {
     program.parse_args(argc, argv);
@@ -93,11 +298,118 @@ PokerSimulationArgs ParseArgs(int argc, char *argv[]) {
 
   if (game_type_str == "holdem") {
     args.game_type = PokerGameType::HOLDEM;
+  } else if (game_type_str == "omaha") {
+    args.game_type = PokerGameType::OMAHA;
+  } else if (game_type_str == "short_deck") {
+    args.game_type = PokerGameType::SHORT_DECK;
   } else {
     std::cerr << "Unrecognized game type: " << game_type_str << "\n\n";
     std::cerr << program["game-type"] << std::endl;
     exit(1);
   }
+  if (args.game_type == PokerGameType::SHORT_DECK &&
+      (args.batch || args.stats_hand_attributes || args.stats_equity)) {
+    std::cerr << "Short deck doesn't support --batch, "
+                 "--stats:hand-attributes or --stats:equity" << std::endl;
+    exit(1);
+  }
+  if (args.game_type == PokerGameType::OMAHA &&
+      (args.batch || args.stats_hole_cards || args.stats_hand_attributes ||
+       args.stats_equity)) {
+    std::cerr << "Omaha doesn't support --batch, --stats:hole-cards, "
+                 "--stats:hand-attributes or --stats:equity" << std::endl;
+    exit(1);
+  }
+
+  if (args.perf_counters_phases) {
+    args.perf_counters = true;
+  }
+
+  try {
+    ParsePlayers(players_str, args);
+  }
+  catch (const std::exception& err) {
+    std::cerr << "Invalid player count '" << players_str << "': "
+              << err.what() << std::endl;
+    exit(1);
+  }
+  try {
+    ParseBlinds(blinds_str, args);
+  }
+  catch (const std::exception& err) {
+    std::cerr << "Invalid blinds '" << blinds_str << "': " << err.what()
+              << std::endl;
+    exit(1);
+  }
+  if (!import_str.empty()) {
+    // ACPC logs are played with their own stakes
+    const poker::Stakes acpc = poker::holdem::AcpcStakes();
+    if (!program.is_used("--blinds")) {
+      args.small_blind = acpc.small_blind;
+      args.big_blind = acpc.big_blind;
+    }
+    if (!program.is_used("--stack")) {
+      args.stack = acpc.stack;
+    }
+  }
+  if (args.stack <= 0) {
+    std::cerr << "Invalid stack: must be positive" << std::endl;
+    exit(1);
+  }
+  if (args.stack / args.big_blind > poker::kMaxStackBigBlinds) {
+    std::cerr << "Invalid stack: must be at most "
+              << poker::kMaxStackBigBlinds << " big blinds" << std::endl;
+    exit(1);
+  }
+  if (!args.history_file.empty() && (args.batch || args.sweep())) {
+    std::cerr << "--history doesn't support --batch or a player count range"
+              << std::endl;
+    exit(1);
+  }
+  if (!args.replay_file.empty() &&
+      (args.batch || args.sweep() || !args.history_file.empty())) {
+    std::cerr << "--replay doesn't support --batch, --history or a player "
+                 "count range" << std::endl;
+    exit(1);
+  }
+  for (size_t pos = 0; pos < import_str.size();) {
+    size_t comma = std::min(import_str.find(',', pos), import_str.size());
+    args.import_files.push_back(import_str.substr(pos, comma - pos));
+    pos = comma + 1;
+  }
+  if (!args.import_files.empty() &&
+      (args.game_type != PokerGameType::HOLDEM || args.batch ||
+       args.sweep() || !args.history_file.empty() ||
+       !args.replay_file.empty())) {
+    std::cerr << "--import only supports holdem, without --batch, "
+                 "--history, --replay or a player count range" << std::endl;
+    exit(1);
+  }
+  if (args.threads <= 0) {
+    args.threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  try {
+    if (!duration_str.empty()) {
+      args.duration = ParseDuration(duration_str);
+      if (args.duration <= 0) {
+        throw std::invalid_argument("Duration must be positive");
+      }
+      args.duration_margin = duration_margin_str.empty()
+          ? args.duration / 20 : ParseDuration(duration_margin_str);
+      if (args.duration_margin < 0 || args.duration_margin >= args.duration) {
+        throw std::invalid_argument(
+            "Duration margin must be smaller than the duration");
+      }
+      if (!program.is_used("--iterations")) {
+        args.iterations = 0;
+      }
+    }
+  }
+  catch (const std::exception& err) {
+    std::cerr << "Invalid duration: " << err.what() << std::endl;
+    exit(1);
+  }
 
   return args;
 }
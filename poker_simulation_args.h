@@ -2,6 +2,7 @@
 #define POKER_SIMULATION_ARGS_H
 
 #include <string>
+#include <vector>
 
 //
 // This file depends on github.com/p-ranav/argparse
@@ -10,17 +11,55 @@
 enum class PokerGameType {
   UNSPECIFIED = 0,
   HOLDEM = 1,
+  OMAHA = 2,
+  SHORT_DECK = 3,
 };
 
 struct PokerSimulationArgs {
   PokerGameType game_type = PokerGameType::UNSPECIFIED;
   int players = 10;
+  // If greater than `players`, every player count from `players` through
+  // `players_sweep_max` is simulated in one run (e.g. --players 2-10).
+  int players_sweep_max = 0;
+  // Worker threads used by sweep mode.
+  int threads = 1;
   int iterations = 100'000'000;
+  // Wall-clock budget in seconds (0 means run exactly `iterations` hands).
+  // When set, `iterations` is only a cap if it was given explicitly and is
+  // otherwise 0 (no cap).
+  double duration = 0;
+  // Seconds of `duration` reserved for writing output.  ParseArgs() sets it
+  // to 5% of `duration` unless --duration-margin is given; 0 reserves none.
+  double duration_margin = 0;
+  // Blinds and starting stack in chips (see poker::Stakes).
+  int small_blind = 1;
+  int big_blind = 2;
+  int stack = 200;
   std::string output_dir;
   std::string player_model;
   bool append_output = false;
   bool stats_winning_hand = false;
   bool stats_hole_cards = false;
+  bool stats_hand_attributes = false;
+  // Hold'em only: exact flop and turn equity of each hole hand.
+  bool stats_equity = false;
+  // Also write the counters as a binary columnar stats file (see
+  // stats_file.h).
+  bool stats_export = false;
+  // Play many tables in lockstep with BatchGame instead of one Game.
+  bool batch = false;
+  bool perf_counters = false;
+  bool perf_counters_phases = false;
+  // Binary hand history to record the simulated hands to (see
+  // hand_history.h), optionally zlib compressed.
+  std::string history_file;
+  bool compress_history = false;
+  // Hand history to compute the statistics of instead of simulating.
+  std::string replay_file;
+  // ACPC format hand histories (see hand_import.h) to compute the
+  // statistics of, on `threads` workers, instead of simulating.
+  std::vector<std::string> import_files;
+  bool sweep() const { return players_sweep_max > players; }
   void Display() const;
 };
 
@@ -1,13 +1,22 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <array>
 #include <iostream>
+#include <random>
 #include <sstream>
 #include <string>
+#include <vector>
 
+#include "card_mask.h"
 #include "cards.h"
 #include "cards.pb.h"
+#include "hand_attributes.h"
+#include "outs.h"
 #include "poker.h"
 #include "poker.pb.h"
+#include "sorting_network.h"
+#include "thread_pool.h"
 #include <google/protobuf/text_format.h>
 
 namespace {
@@ -28,6 +37,16 @@ protected:
     return true;
   }
 
+  uint64_t CardsMask(const std::vector<std::string>& input) {
+    std::vector<Card> cards;
+    EXPECT_TRUE(CardTextProtosToVector(input, cards));
+    uint64_t mask = 0;
+    for (const Card& card : cards) {
+      mask |= poker::CardToMask(card);
+    }
+    return mask;
+  }
+
   bool SetCommunityCards(std::vector<std::string> input) {
     std::vector<Card> community;
     if (!CardTextProtosToVector(input, community))
@@ -120,3 +139,268 @@ TEST_F(PokerTest, HandEvaluator) {
         "rank: QUEEN suit: DIAMONDS" }));
   EXPECT_EQ(ComputeHand(), "straight-flush AKQJT");
 }
+
+TEST_F(PokerTest, HandValueIndex) {
+  // Dense indices follow ascending sort code order
+  for (int i = 1; i < poker::kHandValueCount; i++) {
+    ASSERT_LT(poker::HandValueSortCode(i - 1), poker::HandValueSortCode(i));
+    ASSERT_EQ(poker::HandValueIndex(poker::HandValueSortCode(i)), i);
+  }
+  EXPECT_EQ(poker::HandValueIndex(0), -1);
+
+  // Every hand the evaluator produces has an index
+  std::mt19937 rng(42);
+  Deck deck;
+  std::vector<Card> community;
+  for (int i = 0; i < 20000; i++) {
+    deck.Shuffle(rng);
+    community.clear();
+    for (int j = 0; j < 5; j++) {
+      community.push_back(deck.DealCard());
+    }
+    he_.Reset(community);
+    hole_cards_ = { deck.DealCard(), deck.DealCard() };
+    poker::Hand hand = he_.Evaluate(hole_cards_);
+    ASSERT_GE(poker::HandValueIndex(hand.sort_code()), 0) << hand;
+  }
+}
+
+TEST_F(PokerTest, EvaluateCardMask) {
+  std::mt19937 rng(7);
+  Deck deck;
+  std::vector<Card> community;
+  for (int i = 0; i < 200000; i++) {
+    deck.Shuffle(rng);
+    community.clear();
+    uint64_t mask = 0;
+    for (int j = 0; j < 5; j++) {
+      community.push_back(deck.DealCard());
+      mask |= poker::CardToMask(community.back());
+    }
+    he_.Reset(community);
+    hole_cards_ = { deck.DealCard(), deck.DealCard() };
+    mask |= poker::CardToMask(hole_cards_[0]) |
+            poker::CardToMask(hole_cards_[1]);
+    poker::Hand hand = he_.Evaluate(hole_cards_);
+    ASSERT_EQ(poker::EvaluateCardMask(mask), hand.sort_code()) << hand;
+  }
+
+  // Card index and mask round trips
+  for (int index = 0; index < poker::kCardCount; index++) {
+    Card card = poker::IndexToCard(index);
+    ASSERT_EQ(poker::CardToIndex(card), index);
+    ASSERT_EQ(poker::CardToMask(card), poker::IndexToCardMask(index));
+  }
+}
+
+TEST_F(PokerTest, HandAttributes) {
+  // Open-ended straight draw and a flush draw
+  EXPECT_EQ(poker::HandAttributes(
+                CardsMask({"rank: NINE suit: HEARTS",
+                           "rank: EIGHT suit: HEARTS"}),
+                CardsMask({"rank: SEVEN suit: HEARTS", "rank: SIX suit: CLUBS",
+                           "rank: TWO suit: HEARTS"})),
+            poker::HAND_ATTR_OUTSIDE_STRAIGHT_DRAW |
+                poker::HAND_ATTR_FLUSH_DRAW);
+  // Gutshot, backdoor flush draw and a one gap connector
+  EXPECT_EQ(poker::HandAttributes(
+                CardsMask({"rank: NINE suit: SPADES",
+                           "rank: SEVEN suit: SPADES"}),
+                CardsMask({"rank: SIX suit: SPADES", "rank: FIVE suit: CLUBS",
+                           "rank: KING suit: HEARTS"})),
+            poker::HAND_ATTR_INSIDE_STRAIGHT_DRAW |
+                poker::HAND_ATTR_BACKDOOR_FLUSH_DRAW |
+                poker::HAND_ATTR_ONE_GAP_CONNECTOR);
+  // Double gutshot on the turn: 5-7-8-9-J needs a six or a ten
+  EXPECT_EQ(poker::HandAttributes(
+                CardsMask({"rank: JACK suit: SPADES",
+                           "rank: FIVE suit: CLUBS"}),
+                CardsMask({"rank: SEVEN suit: HEARTS",
+                           "rank: EIGHT suit: CLUBS",
+                           "rank: NINE suit: DIAMONDS",
+                           "rank: KING suit: HEARTS"})),
+            poker::HAND_ATTR_DOUBLE_INSIDE_STRAIGHT_DRAW);
+  // A wheel draw is one-ended; an ace and a four are two ranks apart
+  EXPECT_EQ(poker::HandAttributes(
+                CardsMask({"rank: ACE suit: SPADES", "rank: FOUR suit: CLUBS"}),
+                CardsMask({"rank: TWO suit: HEARTS", "rank: THREE suit: CLUBS",
+                           "rank: KING suit: DIAMONDS"})),
+            poker::HAND_ATTR_INSIDE_STRAIGHT_DRAW |
+                poker::HAND_ATTR_TWO_GAP_CONNECTOR);
+  // A draw on the board alone isn't the player's, and the river has none
+  uint64_t hole =
+      CardsMask({"rank: KING suit: SPADES", "rank: KING suit: CLUBS"});
+  EXPECT_EQ(poker::HandAttributes(
+                hole, CardsMask({"rank: NINE suit: HEARTS",
+                                 "rank: EIGHT suit: CLUBS",
+                                 "rank: SEVEN suit: DIAMONDS",
+                                 "rank: SIX suit: HEARTS"})),
+            0u);
+  EXPECT_EQ(poker::HandAttributes(
+                CardsMask({"rank: NINE suit: HEARTS",
+                           "rank: EIGHT suit: HEARTS"}),
+                CardsMask({"rank: SEVEN suit: HEARTS", "rank: SIX suit: CLUBS",
+                           "rank: TWO suit: HEARTS", "rank: KING suit: CLUBS",
+                           "rank: KING suit: SPADES"})),
+            0u);
+}
+
+TEST_F(PokerTest, Outs) {
+  // Nine hearts make a flush and three aces and three kings a pair; the
+  // cards that pair the board pair everyone.
+  uint64_t hole =
+      CardsMask({"rank: ACE suit: HEARTS", "rank: KING suit: HEARTS"});
+  uint64_t flop = CardsMask({"rank: TWO suit: HEARTS",
+                             "rank: SEVEN suit: HEARTS",
+                             "rank: NINE suit: CLUBS"});
+  poker::Outs outs = poker::ComputeOuts(hole, flop);
+  EXPECT_EQ(outs.count(), 15);
+  EXPECT_EQ(__builtin_popcountll(outs.unseen), 47);
+  EXPECT_EQ(outs.by_type[static_cast<int>(poker::HandType::FLUSH)], 9);
+  EXPECT_EQ(outs.by_type[static_cast<int>(poker::HandType::ONE_PAIR)],
+            3 + 3 + 3 + 3 + 2);
+  uint64_t ace = CardsMask({"rank: ACE suit: SPADES"});
+  EXPECT_NE(outs.outs & ace, 0u);
+  EXPECT_EQ(outs.next_strength[__builtin_ctzll(ace) / 16 * 13 +
+                               __builtin_ctzll(ace) % 16 - 2],
+            poker::EvaluateCardMask(hole | flop | ace));
+  // The ace of hearts is in the hand
+  EXPECT_EQ(outs.next_strength[2 * 13 + 12], 0);
+  EXPECT_EQ(outs.outs & CardsMask({"rank: NINE suit: HEARTS"}),
+            CardsMask({"rank: NINE suit: HEARTS"}));
+  EXPECT_EQ(outs.outs & CardsMask({"rank: NINE suit: SPADES"}), 0u);
+
+  // On a paired board the nines and kings make a full house; a deuce makes
+  // two pair on the board too
+  uint64_t kings =
+      CardsMask({"rank: KING suit: SPADES", "rank: KING suit: CLUBS"});
+  uint64_t paired = CardsMask({"rank: NINE suit: HEARTS",
+                               "rank: NINE suit: CLUBS",
+                               "rank: TWO suit: DIAMONDS"});
+  outs = poker::ComputeOuts(kings, paired);
+  EXPECT_NE(outs.outs & CardsMask({"rank: NINE suit: SPADES"}), 0u);
+  EXPECT_NE(outs.outs & CardsMask({"rank: KING suit: HEARTS"}), 0u);
+  EXPECT_EQ(outs.count(), 2 + 2);
+}
+
+TEST_F(PokerTest, ShortDeck) {
+  using poker::ShortDeckRanking;
+  std::mt19937 rng(3);
+  ShortDeck deck;
+  ASSERT_EQ(ShortDeck::kDeckSize, 36);
+  uint64_t dealt = 0;
+  deck.Shuffle(rng);
+  for (int i = 0; i < ShortDeck::kDeckSize; i++) {
+    const Card& card = deck.DealCard();
+    EXPECT_GE(card.rank(), Rank::SIX);
+    dealt |= poker::CardToMask(card);
+  }
+  EXPECT_EQ(__builtin_popcountll(dealt), 36);
+
+  auto evaluate = [](uint64_t cards) {
+    return poker::EvaluateCardMask<ShortDeckRanking>(cards);
+  };
+  auto type = [](int32_t sort_code) {
+    return poker::SortCodeHandType<ShortDeckRanking>(sort_code);
+  };
+  // A-6-7-8-9 is the lowest straight
+  int32_t wheel = evaluate(CardsMask({
+      "rank: ACE suit: SPADES", "rank: SIX suit: HEARTS",
+      "rank: SEVEN suit: CLUBS", "rank: EIGHT suit: CLUBS",
+      "rank: NINE suit: DIAMONDS"}));
+  int32_t six_high = evaluate(CardsMask({
+      "rank: TEN suit: SPADES", "rank: SIX suit: HEARTS",
+      "rank: SEVEN suit: CLUBS", "rank: EIGHT suit: CLUBS",
+      "rank: NINE suit: DIAMONDS"}));
+  int32_t trips = evaluate(CardsMask({
+      "rank: ACE suit: SPADES", "rank: ACE suit: HEARTS",
+      "rank: ACE suit: CLUBS", "rank: EIGHT suit: CLUBS",
+      "rank: NINE suit: DIAMONDS"}));
+  EXPECT_EQ(type(wheel), poker::HandType::STRAIGHT);
+  EXPECT_LT(wheel, six_high);
+  EXPECT_GT(wheel, trips);
+  // A flush beats a full house
+  int32_t flush = evaluate(CardsMask({
+      "rank: SIX suit: HEARTS", "rank: SEVEN suit: HEARTS",
+      "rank: EIGHT suit: HEARTS", "rank: TEN suit: HEARTS",
+      "rank: JACK suit: HEARTS"}));
+  int32_t full_house = evaluate(CardsMask({
+      "rank: ACE suit: SPADES", "rank: ACE suit: HEARTS",
+      "rank: ACE suit: CLUBS", "rank: KING suit: CLUBS",
+      "rank: KING suit: DIAMONDS"}));
+  EXPECT_EQ(type(flush), poker::HandType::FLUSH);
+  EXPECT_EQ(type(full_house), poker::HandType::FULL_HOUSE);
+  EXPECT_GT(flush, full_house);
+  EXPECT_EQ(poker::SortCodeToHand(
+                poker::StandardSortCode<ShortDeckRanking>(flush)).type(),
+            poker::HandType::FLUSH);
+
+  // Short-deck hands only differ from the standard ranking in the wheel and
+  // the flush category, and every one has a hand value
+  for (int i = 0; i < 20000; i++) {
+    deck.Shuffle(rng, 7);
+    uint64_t cards = 0;
+    for (int j = 0; j < 7; j++) {
+      cards |= poker::CardToMask(deck.DealCard());
+    }
+    int32_t sort_code = evaluate(cards);
+    ASSERT_GE(poker::HandValueIndex<ShortDeckRanking>(sort_code), 0);
+    int32_t standard = poker::EvaluateCardMask(cards);
+    if (type(sort_code) != poker::HandType::STRAIGHT &&
+        type(sort_code) != poker::HandType::STRAIGHT_FLUSH) {
+      ASSERT_EQ(poker::StandardSortCode<ShortDeckRanking>(sort_code),
+                standard);
+    }
+  }
+}
+
+// By the 0-1 principle a network sorts every input if it sorts every input of
+// zeros and ones.
+template <size_t N>
+void ExpectSortsBinaryInputs() {
+  for (uint32_t bits = 0; bits < (1u << N); bits++) {
+    std::array<int, N> values;
+    for (size_t i = 0; i < N; i++) {
+      values[i] = (bits >> i) & 1;
+    }
+    poker::NetworkSort(values, [](int lhs, int rhs) { return lhs > rhs; });
+    EXPECT_TRUE(std::is_sorted(values.begin(), values.end(),
+                               [](int lhs, int rhs) { return lhs > rhs; }))
+        << "N=" << N << " input=" << bits;
+  }
+}
+
+TEST_F(PokerTest, SortingNetwork) {
+  ExpectSortsBinaryInputs<2>();
+  ExpectSortsBinaryInputs<3>();
+  ExpectSortsBinaryInputs<4>();
+  ExpectSortsBinaryInputs<5>();
+  ExpectSortsBinaryInputs<6>();
+  ExpectSortsBinaryInputs<7>();
+  ExpectSortsBinaryInputs<8>();
+  ExpectSortsBinaryInputs<9>();
+  ExpectSortsBinaryInputs<10>();
+  EXPECT_EQ(poker::SortingNetwork<10>::kPairs.size, 32u);
+}
+
+TEST(ThreadPoolTest, RunsBatchesOnTheSameWorkers) {
+  poker::WorkStealingPool pool(4);
+  std::vector<int> done(4);
+  for (int batch = 1; batch <= 3; batch++) {
+    for (int task = 0; task < 100; task++) {
+      pool.Submit(task % pool.size(), [&, task](int worker) {
+        // Tasks may submit more work
+        if (task == 0) {
+          pool.Submit(worker, [&](int w) { done[w]++; });
+        }
+        done[worker]++;
+      });
+    }
+    pool.Run();
+    int total = 0;
+    for (int count : done) {
+      total += count;
+    }
+    EXPECT_EQ(total, 101 * batch);
+  }
+}
@@ -0,0 +1,32 @@
+#ifndef SHORT_DECK_H
+#define SHORT_DECK_H
+
+#include "card_mask.h"
+#include "cards.h"
+#include "holdem.h"
+
+namespace poker::short_deck {
+
+// Game rules policy (see holdem::HoldemRules) for short-deck (6+) hold'em:
+// no-limit hold'em dealt from the 36 cards six and up, where the wheel is
+// A-6-7-8-9 and a flush beats a full house (see ShortDeckRanking).  The
+// deck and the evaluator's straight and category constants are template
+// arguments, so the engine has no more branches than for hold'em.
+struct Rules {
+  using Deck = ::ShortDeck;
+  using Ranking = ShortDeckRanking;
+  static constexpr int kHoleCards = holdem::kHoleCards;
+  // 9 pairs, 36 suited and 36 offsuit hands
+  static constexpr int kHoleHandCount = Deck::kRankCount * Deck::kRankCount;
+  static constexpr bool kPotLimit = false;
+  using Showdown = holdem::CardMaskShowdown<Ranking>;
+};
+
+// Plays hands of no-limit short-deck hold'em at one table (see holdem::Game).
+template <typename RNG, typename STATS,
+          typename MODELS = holdem::PlayerModels>
+using Game = holdem::Game<RNG, STATS, MODELS, Rules>;
+
+} // namespace poker::short_deck
+
+#endif // SHORT_DECK_H
@@ -0,0 +1,132 @@
+#include "stats_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace poker::holdem {
+
+namespace {
+
+constexpr char kRankChars[] = "23456789TJQKA";
+constexpr int kAce = 14;
+
+// Bytes from the start of the file to the first column
+size_t DataOffset(size_t column_count) {
+  return sizeof(StatsFileHeader) + column_count * sizeof(StatsColumnEntry);
+}
+
+} // namespace
+
+StatsFileWriter::StatsFileWriter(const StatsFileHeader& header)
+  : header_(header) {
+  std::copy(std::begin(kStatsFileMagic), std::end(kStatsFileMagic),
+            header_.magic);
+  header_.version = kStatsFileVersion;
+}
+
+uint64_t* StatsFileWriter::AddColumn(StatsColumnId id, int round,
+                                     uint32_t rows, uint32_t columns) {
+  StatsColumnEntry entry{};
+  entry.id = static_cast<uint16_t>(id);
+  entry.round = round;
+  entry.rows = rows;
+  entry.columns = columns;
+  entries_.push_back(entry);
+  columns_.emplace_back(static_cast<size_t>(rows) * columns);
+  return columns_.back().data();
+}
+
+void StatsFileWriter::Write(const std::string& path) {
+  header_.column_count = entries_.size();
+  // Entries and columns are multiples of 8 bytes, so every column is
+  // aligned
+  uint64_t offset = DataOffset(entries_.size());
+  for (size_t i = 0; i < entries_.size(); i++) {
+    entries_[i].offset = offset;
+    offset += columns_[i].size() * sizeof(uint64_t);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throw std::runtime_error("Can't open stats file " + path);
+  }
+  out.write(reinterpret_cast<const char*>(&header_), sizeof(header_));
+  out.write(reinterpret_cast<const char*>(entries_.data()),
+            entries_.size() * sizeof(StatsColumnEntry));
+  for (const std::vector<uint64_t>& column : columns_) {
+    out.write(reinterpret_cast<const char*>(column.data()),
+              column.size() * sizeof(uint64_t));
+  }
+  if (!out.flush()) {
+    throw std::runtime_error("Error writing stats file " + path);
+  }
+}
+
+StatsFile::StatsFile(const std::string& path) : file_(path) {
+  header_ = reinterpret_cast<const StatsFileHeader*>(file_.data());
+  if (file_.size() < sizeof(StatsFileHeader) ||
+      !std::equal(std::begin(kStatsFileMagic), std::end(kStatsFileMagic),
+                  header_->magic) ||
+      header_->version != kStatsFileVersion) {
+    throw std::runtime_error(path + " isn't a version " +
+                             std::to_string(kStatsFileVersion) +
+                             " stats file");
+  }
+  // HoleHandName() indexes ranks from low_rank up, and every rank above
+  // low_rank adds its pair and a suited and an offsuit hand with each lower
+  // one, so n ranks make n * n hole hands
+  int ranks = kAce + 1 - header_->low_rank;
+  if (header_->low_rank < 2 || header_->low_rank > kAce ||
+      header_->hole_hand_count != static_cast<uint32_t>(ranks * ranks)) {
+    throw std::runtime_error("Corrupt stats file header " + path);
+  }
+  if (file_.size() < DataOffset(header_->column_count)) {
+    throw std::runtime_error("Truncated stats file " + path);
+  }
+  entries_ = reinterpret_cast<const StatsColumnEntry*>(
+      file_.data() + sizeof(StatsFileHeader));
+  for (int i = 0; i < header_->column_count; i++) {
+    const StatsColumnEntry& entry = entries_[i];
+    uint64_t bytes = static_cast<uint64_t>(entry.rows) * entry.columns *
+                     sizeof(uint64_t);
+    if (entry.offset % sizeof(uint64_t) != 0 ||
+        entry.offset < DataOffset(header_->column_count) ||
+        entry.offset > file_.size() || bytes > file_.size() - entry.offset) {
+      throw std::runtime_error("Corrupt stats file " + path);
+    }
+  }
+}
+
+StatsColumn StatsFile::column(StatsColumnId id, int round) const {
+  for (int i = 0; i < header_->column_count; i++) {
+    const StatsColumnEntry& entry = entries_[i];
+    if (entry.id == static_cast<uint16_t>(id) && entry.round == round) {
+      return {reinterpret_cast<const uint64_t*>(file_.data() + entry.offset),
+              entry.rows, entry.columns};
+    }
+  }
+  return {};
+}
+
+std::string StatsFile::HoleHandName(int hole_hand) const {
+  // Each rank from the ace down has its pair, then a suited and an offsuit
+  // hand with each lower rank
+  int index = hole_hand;
+  for (int rank1 = kAce; rank1 >= header_->low_rank; rank1--) {
+    if (index == 0) {
+      return {kRankChars[rank1 - 2], kRankChars[rank1 - 2]};
+    }
+    index--;
+    int lower = rank1 - header_->low_rank;
+    if (index < 2 * lower) {
+      int rank2 = rank1 - 1 - index / 2;
+      return {kRankChars[rank1 - 2], kRankChars[rank2 - 2],
+              index % 2 == 0 ? 's' : 'o'};
+    }
+    index -= 2 * lower;
+  }
+  throw std::out_of_range("No hole hand " + std::to_string(hole_hand));
+}
+
+} // namespace poker::holdem
@@ -0,0 +1,152 @@
+#ifndef STATS_FILE_H
+#define STATS_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+namespace poker::holdem {
+
+// A binary, columnar file of a simulation's statistics counters, for jobs
+// that process results downstream without parsing the CSV files (see
+// BasicStatistics::WriteStatsFile()).  StatsFile reads one by mapping it, so
+// loading a result set is a single mmap and the counters are read in place.
+//
+// A file is a StatsFileHeader, a directory of header.column_count
+// StatsColumnEntry, then the columns.  A column is a matrix of rows by
+// columns uint64_t counters stored row by row, starting at a multiple of 8
+// bytes.  Only the counters of the statistics the run collected are
+// present.  Integers are little-endian.
+constexpr char kStatsFileMagic[4] = {'P', 'K', 'S', 'T'};
+// Version 2 counts BEAT_MATRIX per pair of players and adds the tie and loss
+// columns.
+constexpr uint16_t kStatsFileVersion = 2;
+
+// Columns, and what their rows (and columns) are indexed by.  Hole hands are
+// indexed in the order AA, AKs, AKo, AQs, ..., KK, KQs, ... down to the
+// lowest rank's pair (see StatsFile::HoleHandName()).  Hand values are
+// indexed by HandValueIndex of the game's Ranking, and rounds as Round.
+enum class StatsColumnId : uint16_t {
+  // Hands in which each hole hand was dealt
+  HOLE_HAND_APPEARANCES = 1,
+  // Hands that ended uncontested in each round
+  UNCONTESTED = 2,
+  // Per round from the flop: pairs of players at showdown with the
+  // [stronger][weaker] hole hand
+  BEAT_MATRIX = 3,
+  // Per round from the flop: showdowns won or split by each hole hand
+  HOLE_HAND_WINS = 4,
+  // Per round from the flop: showdowns won with each hand value
+  HAND_VALUE_WINS = 5,
+  // Per round from the flop: showdowns won with each HandType
+  HAND_TYPE_WINS = 6,
+  // Per flop and turn: hands with each HandAttribute, and how many of them
+  // that player won
+  ATTRIBUTE_HANDS = 7,
+  ATTRIBUTE_WINS = 8,
+  // Per round from the flop: pairs of players at showdown whose hole hands
+  // tied, counted in both orders
+  TIE_MATRIX = 9,
+  // Per round from the flop: showdowns each hole hand split the pot in, and
+  // lost
+  HOLE_HAND_TIES = 10,
+  HOLE_HAND_LOSSES = 11,
+  // Per round from the flop: showdowns won outright (not split) by each hole
+  // hand, so HOLE_HAND_WINS less HOLE_HAND_TIES
+  HOLE_HAND_OUTRIGHT_WINS = 12,
+};
+
+struct StatsFileHeader {
+  char magic[4];
+  uint16_t version;
+  uint16_t column_count;
+  // Game and table of the run (see HandHistoryHeader)
+  uint8_t hole_cards;
+  uint8_t low_rank;
+  uint8_t players;
+  uint8_t reserved;
+  int32_t small_blind;
+  int32_t big_blind;
+  int32_t stack;
+  uint32_t hole_hand_count;
+  uint32_t hand_value_count;
+  // Hands the counters are of
+  uint64_t games;
+};
+static_assert(sizeof(StatsFileHeader) == 40, "Header layout is on disk");
+
+struct StatsColumnEntry {
+  uint16_t id;
+  // Round of per round columns, otherwise 0
+  uint8_t round;
+  uint8_t reserved;
+  uint32_t rows;
+  uint32_t columns;
+  uint32_t reserved2;
+  // From the start of the file
+  uint64_t offset;
+};
+static_assert(sizeof(StatsColumnEntry) == 24,
+              "Column entry layout is on disk");
+
+// Collects columns and writes them out as a stats file.
+class StatsFileWriter {
+public:
+  explicit StatsFileWriter(const StatsFileHeader& header);
+
+  // Adds a column of rows * columns zeroed counters and returns them, to be
+  // filled in row by row.  The pointer is valid until the next AddColumn().
+  uint64_t* AddColumn(StatsColumnId id, int round, uint32_t rows,
+                      uint32_t columns = 1);
+  // Writes the file.  Throws std::runtime_error if it can't be written.
+  void Write(const std::string& path);
+
+private:
+  StatsFileHeader header_;
+  std::vector<StatsColumnEntry> entries_;
+  std::vector<std::vector<uint64_t>> columns_;
+};
+
+// A column of a mapped StatsFile.
+struct StatsColumn {
+  const uint64_t* data{};
+  uint32_t rows{};
+  uint32_t columns{};
+
+  bool empty() const { return data == nullptr; }
+  size_t size() const { return static_cast<size_t>(rows) * columns; }
+  uint64_t operator[](size_t i) const { return data[i]; }
+  uint64_t operator()(uint32_t row, uint32_t column) const {
+    return data[static_cast<size_t>(row) * columns + column];
+  }
+};
+
+// A stats file mapped read-only.  Throws std::runtime_error if the file
+// can't be mapped or isn't a valid stats file.
+class StatsFile {
+public:
+  explicit StatsFile(const std::string& path);
+
+  const StatsFileHeader& header() const { return *header_; }
+  uint16_t column_count() const { return header_->column_count; }
+  const StatsColumnEntry& entry(int i) const { return entries_[i]; }
+
+  // Returns column id of round (0 for columns that aren't per round), or an
+  // empty column if the run didn't collect it.
+  StatsColumn column(StatsColumnId id, int round = 0) const;
+
+  // Returns the name of hole_hand (an index), such as "AKs", "AKo" or "TT".
+  std::string HoleHandName(int hole_hand) const;
+
+private:
+  MappedFile file_;
+  const StatsFileHeader* header_;
+  const StatsColumnEntry* entries_;
+};
+
+} // namespace poker::holdem
+
+#endif // STATS_FILE_H
@@ -0,0 +1,108 @@
+#include "thread_pool.h"
+
+#include <thread>
+#include <utility>
+
+namespace poker {
+
+WorkStealingPool::WorkStealingPool(int workers) {
+  for (int i = 0; i < workers; i++) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (int i = 1; i < workers; i++) {
+    threads_.emplace_back(&WorkStealingPool::WorkerThread, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkStealingPool::Submit(int worker, Task task) {
+  pending_++;
+  Queue& queue = *queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.tasks.push_back(std::move(task));
+}
+
+bool WorkStealingPool::Pop(int worker, Task* task) {
+  Queue& queue = *queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  *task = std::move(queue.tasks.front());
+  queue.tasks.pop_front();
+  return true;
+}
+
+bool WorkStealingPool::Steal(int worker, Task* task) {
+  for (int i = 1; i < size(); i++) {
+    Queue& queue = *queues_[(worker + i) % size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::WorkerLoop(int worker) {
+  Task task;
+  // pending_ counts queued and running tasks, so it only reaches zero once
+  // no task is left that could submit more work.
+  while (pending_ > 0) {
+    if (Pop(worker, &task) || Steal(worker, &task)) {
+      task(worker);
+      task = nullptr;
+      pending_--;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void WorkStealingPool::WorkerThread(int worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+    }
+    WorkerLoop(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      running_--;
+    }
+    done_.notify_one();
+  }
+}
+
+void WorkStealingPool::Run() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    running_ = static_cast<int>(threads_.size());
+  }
+  wake_.notify_all();
+  WorkerLoop(0);
+  // Tasks may still be running on other workers, and the caller may submit
+  // the next batch as soon as this returns
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [&] { return running_ == 0; });
+}
+
+} // namespace poker
@@ -0,0 +1,76 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace poker {
+
+// A fixed-size pool of workers, each with its own task deque.  A worker takes
+// tasks from the front of its own deque and, when that runs dry, steals from
+// the back of the other workers' deques, so workers that finish their share
+// early pick up work queued for slower ones.  Tasks are expected to be coarse
+// (thousands of hands), so a mutex per deque is cheap enough.
+//
+// The worker threads are started by the constructor and sleep between calls
+// to Run(), so a long-lived pool can run many small batches without paying
+// for thread creation each time.
+class WorkStealingPool {
+public:
+  // The task is passed the index of the worker running it, which callers can
+  // use to address per-worker state without locking.
+  using Task = std::function<void(int worker)>;
+
+  explicit WorkStealingPool(int workers);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  int size() const { return static_cast<int>(queues_.size()); }
+
+  // Queues task on worker's deque.  May be called before Run() or from a
+  // running task (typically with the running task's own worker index).
+  void Submit(int worker, Task task);
+
+  // Runs all submitted tasks, and any tasks they submit, to completion.  The
+  // calling thread acts as worker 0.  Not reentrant: called from one thread
+  // at a time, never from a task.
+  void Run();
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool Pop(int worker, Task* task);
+  bool Steal(int worker, Task* task);
+  void WorkerLoop(int worker);
+  // Body of the threads of workers 1 and up: WorkerLoop() once per Run()
+  void WorkerThread(int worker);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::atomic<int64_t> pending_{};
+
+  // Run() bumps generation_ to wake the workers, then waits until running_
+  // (the workers still in WorkerLoop()) drops back to zero
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  uint64_t generation_{};
+  int running_{};
+  bool stop_{};
+  std::vector<std::thread> threads_;
+};
+
+} // namespace poker
+
+#endif // THREAD_POOL_H